@@ -0,0 +1,84 @@
+# CMAKE generated file: DO NOT EDIT!
+# Generated by "Unix Makefiles" Generator, CMake Version 3.25
+
+# The generator used is:
+set(CMAKE_DEPENDS_GENERATOR "Unix Makefiles")
+
+# The top level Makefile was generated from the following files:
+set(CMAKE_MAKEFILE_DEPENDS
+  "CMakeCache.txt"
+  "/root/repo/src/CMakeLists.txt"
+  "CMakeFiles/3.25.1/CMakeCXXCompiler.cmake"
+  "CMakeFiles/3.25.1/CMakeSystem.cmake"
+  "/tmp/fhe_standin/OpenFHEConfig.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeCXXInformation.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeCommonLanguageInclude.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeGenericSystem.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeInitializeConfigs.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeLanguageInformation.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeParseImplicitLinkInfo.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeSystemSpecificInformation.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeSystemSpecificInitialize.cmake"
+  "/usr/share/cmake-3.25/Modules/CheckCXXSourceCompiles.cmake"
+  "/usr/share/cmake-3.25/Modules/CheckIncludeFileCXX.cmake"
+  "/usr/share/cmake-3.25/Modules/CheckLibraryExists.cmake"
+  "/usr/share/cmake-3.25/Modules/Compiler/CMakeCommonCompilerMacros.cmake"
+  "/usr/share/cmake-3.25/Modules/Compiler/GNU-CXX.cmake"
+  "/usr/share/cmake-3.25/Modules/Compiler/GNU.cmake"
+  "/usr/share/cmake-3.25/Modules/FindOpenMP.cmake"
+  "/usr/share/cmake-3.25/Modules/FindPackageHandleStandardArgs.cmake"
+  "/usr/share/cmake-3.25/Modules/FindPackageMessage.cmake"
+  "/usr/share/cmake-3.25/Modules/FindThreads.cmake"
+  "/usr/share/cmake-3.25/Modules/Internal/CheckSourceCompiles.cmake"
+  "/usr/share/cmake-3.25/Modules/Platform/Linux-GNU-CXX.cmake"
+  "/usr/share/cmake-3.25/Modules/Platform/Linux-GNU.cmake"
+  "/usr/share/cmake-3.25/Modules/Platform/Linux.cmake"
+  "/usr/share/cmake-3.25/Modules/Platform/UnixPaths.cmake"
+  )
+
+# The corresponding makefile is:
+set(CMAKE_MAKEFILE_OUTPUTS
+  "Makefile"
+  "CMakeFiles/cmake.check_cache"
+  )
+
+# Byproducts of CMake generate step:
+set(CMAKE_MAKEFILE_PRODUCTS
+  "CMakeFiles/CMakeDirectoryInformation.cmake"
+  )
+
+# Dependency information for all targets:
+set(CMAKE_DEPEND_INFO_FILES
+  "CMakeFiles/utils_ckks.dir/DependInfo.cmake"
+  "CMakeFiles/utils_bfv.dir/DependInfo.cmake"
+  "CMakeFiles/seeded_ckks.dir/DependInfo.cmake"
+  "CMakeFiles/memory_budget.dir/DependInfo.cmake"
+  "CMakeFiles/result_archive.dir/DependInfo.cmake"
+  "CMakeFiles/directory_watcher.dir/DependInfo.cmake"
+  "CMakeFiles/billing.dir/DependInfo.cmake"
+  "CMakeFiles/vectorutils.dir/DependInfo.cmake"
+  "CMakeFiles/aes_bitsliced.dir/DependInfo.cmake"
+  "CMakeFiles/aes_ni_ctr.dir/DependInfo.cmake"
+  "CMakeFiles/csprng.dir/DependInfo.cmake"
+  "CMakeFiles/communication_graph.dir/DependInfo.cmake"
+  "CMakeFiles/share_aggregator.dir/DependInfo.cmake"
+  "CMakeFiles/fixed_point_codec.dir/DependInfo.cmake"
+  "CMakeFiles/sha256.dir/DependInfo.cmake"
+  "CMakeFiles/x25519.dir/DependInfo.cmake"
+  "CMakeFiles/sharing.dir/DependInfo.cmake"
+  "CMakeFiles/rns_shares.dir/DependInfo.cmake"
+  "CMakeFiles/libaes.dir/DependInfo.cmake"
+  "CMakeFiles/setup_and_billing.dir/DependInfo.cmake"
+  "CMakeFiles/sharing_total_deviation.dir/DependInfo.cmake"
+  "CMakeFiles/sharing_benchmark.dir/DependInfo.cmake"
+  "CMakeFiles/keystream_benchmark.dir/DependInfo.cmake"
+  "CMakeFiles/vectorutils_benchmark.dir/DependInfo.cmake"
+  "CMakeFiles/round_pipeline.dir/DependInfo.cmake"
+  "CMakeFiles/upload_benchmark.dir/DependInfo.cmake"
+  "CMakeFiles/aggregation_benchmark.dir/DependInfo.cmake"
+  "CMakeFiles/streaming_billing.dir/DependInfo.cmake"
+  "CMakeFiles/monthly_billing.dir/DependInfo.cmake"
+  "CMakeFiles/premultiplied_billing.dir/DependInfo.cmake"
+  "CMakeFiles/archive_benchmark.dir/DependInfo.cmake"
+  "CMakeFiles/ingest_billing.dir/DependInfo.cmake"
+  )
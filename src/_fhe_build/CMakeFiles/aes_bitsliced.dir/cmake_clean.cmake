@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/aes_bitsliced.dir/aes_bitsliced.cpp.o"
+  "CMakeFiles/aes_bitsliced.dir/aes_bitsliced.cpp.o.d"
+  "libaes_bitsliced.a"
+  "libaes_bitsliced.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/aes_bitsliced.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/aes_ni_ctr.dir/aes_ni_ctr.cpp.o"
+  "CMakeFiles/aes_ni_ctr.dir/aes_ni_ctr.cpp.o.d"
+  "libaes_ni_ctr.a"
+  "libaes_ni_ctr.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/aes_ni_ctr.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/aggregation_benchmark.dir/aggregation_benchmark.cpp.o"
+  "CMakeFiles/aggregation_benchmark.dir/aggregation_benchmark.cpp.o.d"
+  "aggregation_benchmark"
+  "aggregation_benchmark.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/aggregation_benchmark.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
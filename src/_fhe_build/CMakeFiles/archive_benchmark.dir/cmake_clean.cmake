@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/archive_benchmark.dir/archive_benchmark.cpp.o"
+  "CMakeFiles/archive_benchmark.dir/archive_benchmark.cpp.o.d"
+  "archive_benchmark"
+  "archive_benchmark.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/archive_benchmark.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
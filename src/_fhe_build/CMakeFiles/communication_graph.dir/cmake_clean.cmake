@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/communication_graph.dir/communication_graph.cpp.o"
+  "CMakeFiles/communication_graph.dir/communication_graph.cpp.o.d"
+  "libcommunication_graph.a"
+  "libcommunication_graph.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/communication_graph.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/csprng.dir/csprng.cpp.o"
+  "CMakeFiles/csprng.dir/csprng.cpp.o.d"
+  "libcsprng.a"
+  "libcsprng.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/csprng.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
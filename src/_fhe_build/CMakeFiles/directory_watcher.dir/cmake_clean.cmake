@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/directory_watcher.dir/directory_watcher.cpp.o"
+  "CMakeFiles/directory_watcher.dir/directory_watcher.cpp.o.d"
+  "libdirectory_watcher.a"
+  "libdirectory_watcher.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/directory_watcher.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,3 @@
+file(REMOVE_RECURSE
+  "libdirectory_watcher.a"
+)
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/fixed_point_codec.dir/fixed_point_codec.cpp.o"
+  "CMakeFiles/fixed_point_codec.dir/fixed_point_codec.cpp.o.d"
+  "libfixed_point_codec.a"
+  "libfixed_point_codec.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/fixed_point_codec.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,3 @@
+file(REMOVE_RECURSE
+  "libfixed_point_codec.a"
+)
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/ingest_billing.dir/ingest_billing.cpp.o"
+  "CMakeFiles/ingest_billing.dir/ingest_billing.cpp.o.d"
+  "ingest_billing"
+  "ingest_billing.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/ingest_billing.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/keystream_benchmark.dir/keystream_benchmark.cpp.o"
+  "CMakeFiles/keystream_benchmark.dir/keystream_benchmark.cpp.o.d"
+  "keystream_benchmark"
+  "keystream_benchmark.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/keystream_benchmark.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
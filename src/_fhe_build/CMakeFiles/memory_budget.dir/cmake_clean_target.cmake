@@ -0,0 +1,3 @@
+file(REMOVE_RECURSE
+  "libmemory_budget.a"
+)
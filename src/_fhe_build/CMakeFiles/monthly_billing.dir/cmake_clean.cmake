@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/monthly_billing.dir/monthly_billing.cpp.o"
+  "CMakeFiles/monthly_billing.dir/monthly_billing.cpp.o.d"
+  "monthly_billing"
+  "monthly_billing.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/monthly_billing.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,26 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/src/premultiplied_billing.cpp" "CMakeFiles/premultiplied_billing.dir/premultiplied_billing.cpp.o" "gcc" "CMakeFiles/premultiplied_billing.dir/premultiplied_billing.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  "/root/repo/src/_fhe_build/CMakeFiles/billing.dir/DependInfo.cmake"
+  "/root/repo/src/_fhe_build/CMakeFiles/utils_bfv.dir/DependInfo.cmake"
+  "/root/repo/src/_fhe_build/CMakeFiles/seeded_ckks.dir/DependInfo.cmake"
+  "/root/repo/src/_fhe_build/CMakeFiles/utils_ckks.dir/DependInfo.cmake"
+  "/root/repo/src/_fhe_build/CMakeFiles/csprng.dir/DependInfo.cmake"
+  "/root/repo/src/_fhe_build/CMakeFiles/aes_bitsliced.dir/DependInfo.cmake"
+  "/root/repo/src/_fhe_build/CMakeFiles/aes_ni_ctr.dir/DependInfo.cmake"
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
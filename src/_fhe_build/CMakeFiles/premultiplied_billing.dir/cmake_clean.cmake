@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/premultiplied_billing.dir/premultiplied_billing.cpp.o"
+  "CMakeFiles/premultiplied_billing.dir/premultiplied_billing.cpp.o.d"
+  "premultiplied_billing"
+  "premultiplied_billing.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/premultiplied_billing.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
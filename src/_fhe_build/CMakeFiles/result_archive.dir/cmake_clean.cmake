@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/result_archive.dir/result_archive.cpp.o"
+  "CMakeFiles/result_archive.dir/result_archive.cpp.o.d"
+  "libresult_archive.a"
+  "libresult_archive.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/result_archive.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/rns_shares.dir/rns_shares.cpp.o"
+  "CMakeFiles/rns_shares.dir/rns_shares.cpp.o.d"
+  "librns_shares.a"
+  "librns_shares.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/rns_shares.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
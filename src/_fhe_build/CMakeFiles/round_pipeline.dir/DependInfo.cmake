@@ -0,0 +1,32 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/src/round_pipeline.cpp" "CMakeFiles/round_pipeline.dir/round_pipeline.cpp.o" "gcc" "CMakeFiles/round_pipeline.dir/round_pipeline.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  "/root/repo/src/_fhe_build/CMakeFiles/billing.dir/DependInfo.cmake"
+  "/root/repo/src/_fhe_build/CMakeFiles/sharing.dir/DependInfo.cmake"
+  "/root/repo/src/_fhe_build/CMakeFiles/utils_bfv.dir/DependInfo.cmake"
+  "/root/repo/src/_fhe_build/CMakeFiles/seeded_ckks.dir/DependInfo.cmake"
+  "/root/repo/src/_fhe_build/CMakeFiles/utils_ckks.dir/DependInfo.cmake"
+  "/root/repo/src/_fhe_build/CMakeFiles/csprng.dir/DependInfo.cmake"
+  "/root/repo/src/_fhe_build/CMakeFiles/aes_bitsliced.dir/DependInfo.cmake"
+  "/root/repo/src/_fhe_build/CMakeFiles/aes_ni_ctr.dir/DependInfo.cmake"
+  "/root/repo/src/_fhe_build/CMakeFiles/communication_graph.dir/DependInfo.cmake"
+  "/root/repo/src/_fhe_build/CMakeFiles/fixed_point_codec.dir/DependInfo.cmake"
+  "/root/repo/src/_fhe_build/CMakeFiles/share_aggregator.dir/DependInfo.cmake"
+  "/root/repo/src/_fhe_build/CMakeFiles/x25519.dir/DependInfo.cmake"
+  "/root/repo/src/_fhe_build/CMakeFiles/sha256.dir/DependInfo.cmake"
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/round_pipeline.dir/round_pipeline.cpp.o"
+  "CMakeFiles/round_pipeline.dir/round_pipeline.cpp.o.d"
+  "round_pipeline"
+  "round_pipeline.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/round_pipeline.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
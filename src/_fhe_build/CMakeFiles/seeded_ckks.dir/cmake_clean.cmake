@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/seeded_ckks.dir/seeded_ckks.cpp.o"
+  "CMakeFiles/seeded_ckks.dir/seeded_ckks.cpp.o.d"
+  "libseeded_ckks.a"
+  "libseeded_ckks.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/seeded_ckks.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/setup_and_billing.dir/client_setup_and_server_billing.cpp.o"
+  "CMakeFiles/setup_and_billing.dir/client_setup_and_server_billing.cpp.o.d"
+  "setup_and_billing"
+  "setup_and_billing.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/setup_and_billing.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/sha256.dir/sha256.cpp.o"
+  "CMakeFiles/sha256.dir/sha256.cpp.o.d"
+  "libsha256.a"
+  "libsha256.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/sha256.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
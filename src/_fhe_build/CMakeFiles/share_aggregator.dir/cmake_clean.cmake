@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/share_aggregator.dir/share_aggregator.cpp.o"
+  "CMakeFiles/share_aggregator.dir/share_aggregator.cpp.o.d"
+  "libshare_aggregator.a"
+  "libshare_aggregator.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/share_aggregator.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,3 @@
+file(REMOVE_RECURSE
+  "libshare_aggregator.a"
+)
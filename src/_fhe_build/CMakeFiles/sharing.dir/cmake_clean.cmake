@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/sharing.dir/sharing.cpp.o"
+  "CMakeFiles/sharing.dir/sharing.cpp.o.d"
+  "libsharing.a"
+  "libsharing.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/sharing.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
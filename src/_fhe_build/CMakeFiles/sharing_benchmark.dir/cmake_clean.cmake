@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/sharing_benchmark.dir/sharing_benchmark.cpp.o"
+  "CMakeFiles/sharing_benchmark.dir/sharing_benchmark.cpp.o.d"
+  "sharing_benchmark"
+  "sharing_benchmark.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/sharing_benchmark.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/sharing_total_deviation.dir/sharing_total_deviation.cpp.o"
+  "CMakeFiles/sharing_total_deviation.dir/sharing_total_deviation.cpp.o.d"
+  "sharing_total_deviation"
+  "sharing_total_deviation.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/sharing_total_deviation.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
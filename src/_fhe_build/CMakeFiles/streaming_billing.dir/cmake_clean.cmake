@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/streaming_billing.dir/streaming_billing.cpp.o"
+  "CMakeFiles/streaming_billing.dir/streaming_billing.cpp.o.d"
+  "streaming_billing"
+  "streaming_billing.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/streaming_billing.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/upload_benchmark.dir/upload_benchmark.cpp.o"
+  "CMakeFiles/upload_benchmark.dir/upload_benchmark.cpp.o.d"
+  "upload_benchmark"
+  "upload_benchmark.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/upload_benchmark.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/utils_bfv.dir/utils_bfv.cpp.o"
+  "CMakeFiles/utils_bfv.dir/utils_bfv.cpp.o.d"
+  "libutils_bfv.a"
+  "libutils_bfv.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/utils_bfv.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
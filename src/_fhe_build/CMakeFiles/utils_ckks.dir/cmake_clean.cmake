@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/utils_ckks.dir/utils_ckks.cpp.o"
+  "CMakeFiles/utils_ckks.dir/utils_ckks.cpp.o.d"
+  "libutils_ckks.a"
+  "libutils_ckks.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/utils_ckks.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
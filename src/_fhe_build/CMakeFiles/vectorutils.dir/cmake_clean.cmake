@@ -0,0 +1,9 @@
+file(REMOVE_RECURSE
+  "libvectorutils.a"
+  "libvectorutils.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang )
+  include(CMakeFiles/vectorutils.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/vectorutils_benchmark.dir/vectorutils_benchmark.cpp.o"
+  "CMakeFiles/vectorutils_benchmark.dir/vectorutils_benchmark.cpp.o.d"
+  "vectorutils_benchmark"
+  "vectorutils_benchmark.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/vectorutils_benchmark.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/x25519.dir/x25519.cpp.o"
+  "CMakeFiles/x25519.dir/x25519.cpp.o.d"
+  "libx25519.a"
+  "libx25519.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/x25519.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
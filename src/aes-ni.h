@@ -97,3 +97,21 @@ void aes128_dec(int8_t *cipherText,int8_t *plainText){
 
     _mm_storeu_si128((__m128i *) plainText, m);
 }
+
+
+// Per-instance key schedule. aes128_load_key stores the expanded key in a global,
+// so it only supports one key at a time; this function writes the round keys to
+// the caller's buffer instead. ks must have room for the 11 round keys of AES-128.
+static inline void aes128_expand_enc_key(const int8_t *enc_key, __m128i *ks){
+    ks[0]  = _mm_loadu_si128((const __m128i*) enc_key);
+	ks[1]  = AES_128_key_exp(ks[0], 0x01);
+	ks[2]  = AES_128_key_exp(ks[1], 0x02);
+	ks[3]  = AES_128_key_exp(ks[2], 0x04);
+	ks[4]  = AES_128_key_exp(ks[3], 0x08);
+	ks[5]  = AES_128_key_exp(ks[4], 0x10);
+	ks[6]  = AES_128_key_exp(ks[5], 0x20);
+	ks[7]  = AES_128_key_exp(ks[6], 0x40);
+	ks[8]  = AES_128_key_exp(ks[7], 0x80);
+	ks[9]  = AES_128_key_exp(ks[8], 0x1B);
+	ks[10] = AES_128_key_exp(ks[9], 0x36);
+}
@@ -0,0 +1,499 @@
+#include "aes_bitsliced.h"
+
+
+/*
+ *  The circuits below are the ones of BearSSL's aes_ct64, written as templates
+ *  over the word type W so that the same code runs on uint64_t and on SSE2/AVX2
+ *  vectors of uint64_t. Each 64-bit lane of W is an independent ct64 state
+ *  holding 4 blocks. BearSSL is distributed under the following license:
+ *
+ *  Copyright (c) 2016 Thomas Pornin <pornin@bolet.org>
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining
+ *  a copy of this software and associated documentation files (the
+ *  "Software"), to deal in the Software without restriction, including
+ *  without limitation the rights to use, copy, modify, merge, publish,
+ *  distribute, sublicense, and/or sell copies of the Software, and to
+ *  permit persons to whom the Software is furnished to do so, subject to
+ *  the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ *  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ *  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+typedef uint64_t u64x2 __attribute__ ((vector_size (16)));
+typedef uint64_t u64x4 __attribute__ ((vector_size (32)));
+
+
+
+template <typename W>
+static inline void set_lane(W& w, int lane, uint64_t x){
+    if constexpr (sizeof(W) == sizeof(uint64_t))
+        w = x;
+    else
+        w[lane] = x;
+}
+
+template <typename W>
+static inline uint64_t get_lane(const W& w, int lane){
+    if constexpr (sizeof(W) == sizeof(uint64_t))
+        return w;
+    else
+        return w[lane];
+}
+
+
+/**
+ *  Boyar-Peralta S-box circuit. Variables x* (input) and s* (output) are
+ *  numbered in "reverse" order (x0 is the high bit, x7 is the low bit).
+ */
+template <typename W>
+static inline void bitslice_sbox(W* q){
+    W x0, x1, x2, x3, x4, x5, x6, x7;
+    W y1, y2, y3, y4, y5, y6, y7, y8, y9;
+    W y10, y11, y12, y13, y14, y15, y16, y17, y18, y19;
+    W y20, y21;
+    W z0, z1, z2, z3, z4, z5, z6, z7, z8, z9;
+    W z10, z11, z12, z13, z14, z15, z16, z17;
+    W t0, t1, t2, t3, t4, t5, t6, t7, t8, t9;
+    W t10, t11, t12, t13, t14, t15, t16, t17, t18, t19;
+    W t20, t21, t22, t23, t24, t25, t26, t27, t28, t29;
+    W t30, t31, t32, t33, t34, t35, t36, t37, t38, t39;
+    W t40, t41, t42, t43, t44, t45, t46, t47, t48, t49;
+    W t50, t51, t52, t53, t54, t55, t56, t57, t58, t59;
+    W t60, t61, t62, t63, t64, t65, t66, t67;
+    W s0, s1, s2, s3, s4, s5, s6, s7;
+
+    x0 = q[7];
+    x1 = q[6];
+    x2 = q[5];
+    x3 = q[4];
+    x4 = q[3];
+    x5 = q[2];
+    x6 = q[1];
+    x7 = q[0];
+
+    // top linear transformation
+    y14 = x3 ^ x5;
+    y13 = x0 ^ x6;
+    y9 = x0 ^ x3;
+    y8 = x0 ^ x5;
+    t0 = x1 ^ x2;
+    y1 = t0 ^ x7;
+    y4 = y1 ^ x3;
+    y12 = y13 ^ y14;
+    y2 = y1 ^ x0;
+    y5 = y1 ^ x6;
+    y3 = y5 ^ y8;
+    t1 = x4 ^ y12;
+    y15 = t1 ^ x5;
+    y20 = t1 ^ x1;
+    y6 = y15 ^ x7;
+    y10 = y15 ^ t0;
+    y11 = y20 ^ y9;
+    y7 = x7 ^ y11;
+    y17 = y10 ^ y11;
+    y19 = y10 ^ y8;
+    y16 = t0 ^ y11;
+    y21 = y13 ^ y16;
+    y18 = x0 ^ y16;
+
+    // non-linear section
+    t2 = y12 & y15;
+    t3 = y3 & y6;
+    t4 = t3 ^ t2;
+    t5 = y4 & x7;
+    t6 = t5 ^ t2;
+    t7 = y13 & y16;
+    t8 = y5 & y1;
+    t9 = t8 ^ t7;
+    t10 = y2 & y7;
+    t11 = t10 ^ t7;
+    t12 = y9 & y11;
+    t13 = y14 & y17;
+    t14 = t13 ^ t12;
+    t15 = y8 & y10;
+    t16 = t15 ^ t12;
+    t17 = t4 ^ t14;
+    t18 = t6 ^ t16;
+    t19 = t9 ^ t14;
+    t20 = t11 ^ t16;
+    t21 = t17 ^ y20;
+    t22 = t18 ^ y19;
+    t23 = t19 ^ y21;
+    t24 = t20 ^ y18;
+
+    t25 = t21 ^ t22;
+    t26 = t21 & t23;
+    t27 = t24 ^ t26;
+    t28 = t25 & t27;
+    t29 = t28 ^ t22;
+    t30 = t23 ^ t24;
+    t31 = t22 ^ t26;
+    t32 = t31 & t30;
+    t33 = t32 ^ t24;
+    t34 = t23 ^ t33;
+    t35 = t27 ^ t33;
+    t36 = t24 & t35;
+    t37 = t36 ^ t34;
+    t38 = t27 ^ t36;
+    t39 = t29 & t38;
+    t40 = t25 ^ t39;
+
+    t41 = t40 ^ t37;
+    t42 = t29 ^ t33;
+    t43 = t29 ^ t40;
+    t44 = t33 ^ t37;
+    t45 = t42 ^ t41;
+    z0 = t44 & y15;
+    z1 = t37 & y6;
+    z2 = t33 & x7;
+    z3 = t43 & y16;
+    z4 = t40 & y1;
+    z5 = t29 & y7;
+    z6 = t42 & y11;
+    z7 = t45 & y17;
+    z8 = t41 & y10;
+    z9 = t44 & y12;
+    z10 = t37 & y3;
+    z11 = t33 & y4;
+    z12 = t43 & y13;
+    z13 = t40 & y5;
+    z14 = t29 & y2;
+    z15 = t42 & y9;
+    z16 = t45 & y14;
+    z17 = t41 & y8;
+
+    // bottom linear transformation
+    t46 = z15 ^ z16;
+    t47 = z10 ^ z11;
+    t48 = z5 ^ z13;
+    t49 = z9 ^ z10;
+    t50 = z2 ^ z12;
+    t51 = z2 ^ z5;
+    t52 = z7 ^ z8;
+    t53 = z0 ^ z3;
+    t54 = z6 ^ z7;
+    t55 = z16 ^ z17;
+    t56 = z12 ^ t48;
+    t57 = t50 ^ t53;
+    t58 = z4 ^ t46;
+    t59 = z3 ^ t54;
+    t60 = t46 ^ t57;
+    t61 = z14 ^ t57;
+    t62 = t52 ^ t58;
+    t63 = t49 ^ t58;
+    t64 = z4 ^ t59;
+    t65 = t61 ^ t62;
+    t66 = z1 ^ t63;
+    s0 = t59 ^ t63;
+    s6 = t56 ^ ~t62;
+    s7 = t48 ^ ~t60;
+    t67 = t64 ^ t65;
+    s3 = t53 ^ t66;
+    s4 = t51 ^ t66;
+    s5 = t47 ^ t65;
+    s1 = t64 ^ ~s3;
+    s2 = t55 ^ ~t67;
+
+    q[7] = s0;
+    q[6] = s1;
+    q[5] = s2;
+    q[4] = s3;
+    q[3] = s4;
+    q[2] = s5;
+    q[1] = s6;
+    q[0] = s7;
+}
+
+
+template <typename W>
+static inline void swapn(W& x, W& y, uint64_t cl, uint64_t ch, int s){
+    W a = x, b = y;
+    x = (a & cl) | ((b & cl) << s);
+    y = ((a & ch) >> s) | (b & ch);
+}
+
+/** Converts 8 words between the "interleaved" and the bitsliced representation (an involution) */
+template <typename W>
+static inline void ortho(W* q){
+    const uint64_t c2l = 0x5555555555555555ull, c2h = 0xAAAAAAAAAAAAAAAAull;
+    const uint64_t c4l = 0x3333333333333333ull, c4h = 0xCCCCCCCCCCCCCCCCull;
+    const uint64_t c8l = 0x0F0F0F0F0F0F0F0Full, c8h = 0xF0F0F0F0F0F0F0F0ull;
+
+    swapn(q[0], q[1], c2l, c2h, 1);
+    swapn(q[2], q[3], c2l, c2h, 1);
+    swapn(q[4], q[5], c2l, c2h, 1);
+    swapn(q[6], q[7], c2l, c2h, 1);
+
+    swapn(q[0], q[2], c4l, c4h, 2);
+    swapn(q[1], q[3], c4l, c4h, 2);
+    swapn(q[4], q[6], c4l, c4h, 2);
+    swapn(q[5], q[7], c4l, c4h, 2);
+
+    swapn(q[0], q[4], c8l, c8h, 4);
+    swapn(q[1], q[5], c8l, c8h, 4);
+    swapn(q[2], q[6], c8l, c8h, 4);
+    swapn(q[3], q[7], c8l, c8h, 4);
+}
+
+template <typename W>
+static inline void add_round_key(W* q, const uint64_t* sk){
+    for (int i = 0; i < 8; i++)
+        q[i] ^= sk[i];
+}
+
+template <typename W>
+static inline void shift_rows(W* q){
+    for (int i = 0; i < 8; i++){
+        W x = q[i];
+        q[i] = (x & 0x000000000000FFFFull)
+             | ((x & 0x00000000FFF00000ull) >> 4)
+             | ((x & 0x00000000000F0000ull) << 12)
+             | ((x & 0x0000FF0000000000ull) >> 8)
+             | ((x & 0x000000FF00000000ull) << 8)
+             | ((x & 0xF000000000000000ull) >> 12)
+             | ((x & 0x0FFF000000000000ull) << 4);
+    }
+}
+
+// a macro rather than a function, so that no W is passed by value (32-byte vectors change the ABI)
+#define ROTR32(x) (((x) << 32) | ((x) >> 32))
+
+template <typename W>
+static inline void mix_columns(W* q){
+    W q0 = q[0], q1 = q[1], q2 = q[2], q3 = q[3];
+    W q4 = q[4], q5 = q[5], q6 = q[6], q7 = q[7];
+    W r0 = (q0 >> 16) | (q0 << 48);
+    W r1 = (q1 >> 16) | (q1 << 48);
+    W r2 = (q2 >> 16) | (q2 << 48);
+    W r3 = (q3 >> 16) | (q3 << 48);
+    W r4 = (q4 >> 16) | (q4 << 48);
+    W r5 = (q5 >> 16) | (q5 << 48);
+    W r6 = (q6 >> 16) | (q6 << 48);
+    W r7 = (q7 >> 16) | (q7 << 48);
+
+    q[0] = q7 ^ r7 ^ r0 ^ ROTR32(q0 ^ r0);
+    q[1] = q0 ^ r0 ^ q7 ^ r7 ^ r1 ^ ROTR32(q1 ^ r1);
+    q[2] = q1 ^ r1 ^ r2 ^ ROTR32(q2 ^ r2);
+    q[3] = q2 ^ r2 ^ q7 ^ r7 ^ r3 ^ ROTR32(q3 ^ r3);
+    q[4] = q3 ^ r3 ^ q7 ^ r7 ^ r4 ^ ROTR32(q4 ^ r4);
+    q[5] = q4 ^ r4 ^ r5 ^ ROTR32(q5 ^ r5);
+    q[6] = q5 ^ r5 ^ r6 ^ ROTR32(q6 ^ r6);
+    q[7] = q6 ^ r6 ^ r7 ^ ROTR32(q7 ^ r7);
+}
+
+/** 10 rounds of AES-128 on a bitsliced state, with the expanded key skey[0, ..., 87] */
+template <typename W>
+static inline void bitslice_encrypt(const uint64_t* skey, W* q){
+    add_round_key(q, skey);
+    for (int u = 1; u < 10; u++){
+        bitslice_sbox(q);
+        shift_rows(q);
+        mix_columns(q);
+        add_round_key(q, skey + (u << 3));
+    }
+    bitslice_sbox(q);
+    shift_rows(q);
+    add_round_key(q, skey + (10 << 3));
+}
+
+
+static inline uint32_t dec32le(const uint8_t* b){
+    return (uint32_t) b[0] | ((uint32_t) b[1] << 8) | ((uint32_t) b[2] << 16) | ((uint32_t) b[3] << 24);
+}
+
+static inline void enc32le(uint8_t* b, uint32_t x){
+    b[0] = x & 0xff;
+    b[1] = (x >> 8) & 0xff;
+    b[2] = (x >> 16) & 0xff;
+    b[3] = (x >> 24) & 0xff;
+}
+
+// spreads the 4 words of one block over two 64-bit words
+static void interleave_in(uint64_t* q0, uint64_t* q1, const uint32_t* w){
+    uint64_t x0 = w[0], x1 = w[1], x2 = w[2], x3 = w[3];
+    x0 |= (x0 << 16);
+    x1 |= (x1 << 16);
+    x2 |= (x2 << 16);
+    x3 |= (x3 << 16);
+    x0 &= 0x0000FFFF0000FFFFull;
+    x1 &= 0x0000FFFF0000FFFFull;
+    x2 &= 0x0000FFFF0000FFFFull;
+    x3 &= 0x0000FFFF0000FFFFull;
+    x0 |= (x0 << 8);
+    x1 |= (x1 << 8);
+    x2 |= (x2 << 8);
+    x3 |= (x3 << 8);
+    x0 &= 0x00FF00FF00FF00FFull;
+    x1 &= 0x00FF00FF00FF00FFull;
+    x2 &= 0x00FF00FF00FF00FFull;
+    x3 &= 0x00FF00FF00FF00FFull;
+    *q0 = x0 | (x2 << 8);
+    *q1 = x1 | (x3 << 8);
+}
+
+static void interleave_out(uint32_t* w, uint64_t q0, uint64_t q1){
+    uint64_t x0 = q0 & 0x00FF00FF00FF00FFull;
+    uint64_t x1 = q1 & 0x00FF00FF00FF00FFull;
+    uint64_t x2 = (q0 >> 8) & 0x00FF00FF00FF00FFull;
+    uint64_t x3 = (q1 >> 8) & 0x00FF00FF00FF00FFull;
+    x0 |= (x0 >> 8);
+    x1 |= (x1 >> 8);
+    x2 |= (x2 >> 8);
+    x3 |= (x3 >> 8);
+    x0 &= 0x0000FFFF0000FFFFull;
+    x1 &= 0x0000FFFF0000FFFFull;
+    x2 &= 0x0000FFFF0000FFFFull;
+    x3 &= 0x0000FFFF0000FFFFull;
+    w[0] = (uint32_t) x0 | (uint32_t) (x0 >> 16);
+    w[1] = (uint32_t) x1 | (uint32_t) (x1 >> 16);
+    w[2] = (uint32_t) x2 | (uint32_t) (x2 >> 16);
+    w[3] = (uint32_t) x3 | (uint32_t) (x3 >> 16);
+}
+
+
+static uint32_t sub_word(uint32_t x){
+    uint64_t q[8] = {x, 0, 0, 0, 0, 0, 0, 0};
+    ortho(q);
+    bitslice_sbox(q);
+    ortho(q);
+    return (uint32_t) q[0];
+}
+
+void aes128_bs_load_key(const uint8_t* key, AESBitslicedKey* bs_key){
+    static const uint8_t rcon[] = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1B, 0x36};
+
+    uint32_t skey[44];
+    for (int i = 0; i < 4; i++)
+        skey[i] = dec32le(key + 4 * i);
+
+    uint32_t tmp = skey[3];
+    for (int i = 4; i < 44; i++){
+        if (0 == i % 4){
+            tmp = (tmp << 24) | (tmp >> 8);
+            tmp = sub_word(tmp) ^ rcon[i / 4 - 1];
+        }
+        tmp ^= skey[i - 4];
+        skey[i] = tmp;
+    }
+
+    for (int i = 0, j = 0; i < 44; i += 4, j += 2){
+        uint64_t q[8];
+        interleave_in(&q[0], &q[4], skey + i);
+        q[1] = q[0];
+        q[2] = q[0];
+        q[3] = q[0];
+        q[5] = q[4];
+        q[6] = q[4];
+        q[7] = q[4];
+        ortho(q);
+        bs_key->comp_skey[j + 0] = (q[0] & 0x1111111111111111ull) | (q[1] & 0x2222222222222222ull)
+                                 | (q[2] & 0x4444444444444444ull) | (q[3] & 0x8888888888888888ull);
+        bs_key->comp_skey[j + 1] = (q[4] & 0x1111111111111111ull) | (q[5] & 0x2222222222222222ull)
+                                 | (q[6] & 0x4444444444444444ull) | (q[7] & 0x8888888888888888ull);
+    }
+}
+
+static void skey_expand(uint64_t* skey, const uint64_t* comp_skey){
+    for (int u = 0, v = 0; u < 22; u++, v += 4){
+        uint64_t x0, x1, x2, x3;
+        x0 = x1 = x2 = x3 = comp_skey[u];
+        x0 &= 0x1111111111111111ull;
+        x1 &= 0x2222222222222222ull;
+        x2 &= 0x4444444444444444ull;
+        x3 &= 0x8888888888888888ull;
+        x1 >>= 1;
+        x2 >>= 2;
+        x3 >>= 3;
+        skey[v + 0] = (x0 << 4) - x0;
+        skey[v + 1] = (x1 << 4) - x1;
+        skey[v + 2] = (x2 << 4) - x2;
+        skey[v + 3] = (x3 << 4) - x3;
+    }
+}
+
+
+/** Encrypts up to 4 * (number of lanes of W) blocks with one pass of the circuit */
+template <typename W>
+static void enc_pass(const uint64_t* skey, const uint8_t* in, uint8_t* out, int nblocks){
+    const int lanes = sizeof(W) / sizeof(uint64_t);
+    W q[8];
+
+    for (int l = 0; l < lanes; l++){
+        uint32_t w[16] = {0};
+        for (int b = 0; b < 4 && 4 * l + b < nblocks; b++){
+            for (int k = 0; k < 4; k++)
+                w[4 * b + k] = dec32le(in + 16 * (4 * l + b) + 4 * k);
+        }
+        uint64_t a[8];
+        for (int i = 0; i < 4; i++)
+            interleave_in(&a[i], &a[i + 4], w + 4 * i);
+        for (int i = 0; i < 8; i++)
+            set_lane(q[i], l, a[i]);
+    }
+
+    ortho(q);
+    bitslice_encrypt(skey, q);
+    ortho(q);
+
+    for (int l = 0; l < lanes; l++){
+        uint64_t a[8];
+        for (int i = 0; i < 8; i++)
+            a[i] = get_lane(q[i], l);
+        uint32_t w[16];
+        for (int i = 0; i < 4; i++)
+            interleave_out(w + 4 * i, a[i], a[i + 4]);
+        for (int b = 0; b < 4 && 4 * l + b < nblocks; b++){
+            for (int k = 0; k < 4; k++)
+                enc32le(out + 16 * (4 * l + b) + 4 * k, w[4 * b + k]);
+        }
+    }
+}
+
+// the whole circuit is inlined, so that the u64x4 words are kept in AVX2 registers
+__attribute__((target("avx2"), flatten))
+static void enc_pass_avx2(const uint64_t* skey, const uint8_t* in, uint8_t* out){
+    enc_pass<u64x4>(skey, in, out, 16);
+}
+
+static void enc_pass_sse2(const uint64_t* skey, const uint8_t* in, uint8_t* out){
+    enc_pass<u64x2>(skey, in, out, 8);
+}
+
+static bool cpu_supports_avx2(){
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+static const bool use_avx2 = cpu_supports_avx2();
+
+int aes128_bs_parallel_blocks(){
+    return use_avx2 ? 16 : 8;
+}
+
+void aes128_bs_enc_blocks(const AESBitslicedKey* bs_key, const uint8_t* in, uint8_t* out, int nblocks){
+    uint64_t skey[88];
+    skey_expand(skey, bs_key->comp_skey);
+
+    const int parallel_blocks = aes128_bs_parallel_blocks();
+    int i = 0;
+    for (; i + parallel_blocks <= nblocks; i += parallel_blocks){
+        if (use_avx2)
+            enc_pass_avx2(skey, in + 16 * i, out + 16 * i);
+        else
+            enc_pass_sse2(skey, in + 16 * i, out + 16 * i);
+    }
+    // the remaining blocks only need as many 64-bit lanes as groups of 4 blocks
+    for (; i < nblocks; i += 4)
+        enc_pass<uint64_t>(skey, in + 16 * i, out + 16 * i, nblocks - i < 4 ? nblocks - i : 4);
+}
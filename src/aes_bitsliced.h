@@ -0,0 +1,44 @@
+/**
+ *  Constant-time bitsliced AES-128 encryption, for hosts without AES-NI.
+ *
+ *  Follows the "ct64" representation of BearSSL: each 64-bit word holds one bit
+ *  of every byte of 4 blocks, and the S-box is the Boyar-Peralta circuit, so
+ *  there are no table lookups and no secret-dependent branches. The words are
+ *  kept in SSE2 (8 blocks at a time) or, if the CPU supports it, AVX2 (16 blocks
+ *  at a time) registers.
+ *
+ *  Produces the same output as tiny-AES and AES-NI for the same key.
+ */
+
+#ifndef __AES_BITSLICED
+#define __AES_BITSLICED
+
+#include <cstdint>
+
+
+/**
+ *  Number of blocks encrypted by one pass of the bitsliced circuit: 16 if the
+ *  CPU supports AVX2, 8 otherwise. Chosen at runtime, so the library is built
+ *  for any x86-64 host.
+ */
+int aes128_bs_parallel_blocks();
+
+
+/**
+ *  Compressed bitsliced key schedule of AES-128 (11 round keys), 176 bytes like the
+ *  byte-oriented schedule. It is expanded on the stack by aes128_bs_enc_blocks.
+ */
+struct AESBitslicedKey
+{
+    uint64_t comp_skey[22];
+};
+
+void aes128_bs_load_key(const uint8_t* key, AESBitslicedKey* bs_key);
+
+/**
+ *  out[i*16, ..., (i+1)*16 - 1] = AES.enc(in[i*16, ..., (i+1)*16 - 1]) for i < nblocks.
+ *  in and out may alias. Blocks are processed aes128_bs_parallel_blocks() at a time.
+ */
+void aes128_bs_enc_blocks(const AESBitslicedKey* bs_key, const uint8_t* in, uint8_t* out, int nblocks);
+
+#endif
@@ -0,0 +1,126 @@
+#include "aes_ni_ctr.h"
+
+#include <immintrin.h>
+
+// key expansion of aes-ni.h, compiled for AES-NI only
+#pragma GCC push_options
+#pragma GCC target("aes,sse4.1")
+#include "aes-ni.h"
+#pragma GCC pop_options
+
+
+bool cpu_supports_aesni(){
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("aes") && __builtin_cpu_supports("sse4.1");
+}
+
+bool cpu_supports_vaes_avx512(){
+    __builtin_cpu_init();
+    return cpu_supports_aesni() && __builtin_cpu_supports("vaes") && __builtin_cpu_supports("avx512f");
+}
+
+bool cpu_supports_vaes_avx2(){
+    __builtin_cpu_init();
+    return cpu_supports_aesni() && __builtin_cpu_supports("vaes") && __builtin_cpu_supports("avx2");
+}
+
+
+__attribute__((target("aes,sse4.1")))
+void aes128_ni_load_key(const uint8_t* key, AESNIKey* ni_key){
+    aes128_expand_enc_key((const int8_t*) key, (__m128i*) ni_key->round_keys);
+}
+
+
+__attribute__((target("aes,sse4.1")))
+void aes128_ni_ctr_blocks(const AESNIKey* ni_key, uint64_t round, uint64_t first_block, int nblocks, uint8_t* out){
+    const __m128i* ks = (const __m128i*) ni_key->round_keys;
+    __m128i k[11];
+    for (int r = 0; r < 11; r++)
+        k[r] = _mm_load_si128(ks + r);
+
+    __m128i ctr = _mm_set_epi64x((int64_t) round, (int64_t) first_block);
+    const __m128i one = _mm_set_epi64x(0, 1);
+
+    int i = 0;
+    // 8 independent blocks hide the latency of aesenc
+    for (; i + 8 <= nblocks; i += 8){
+        __m128i b[8];
+        for (int j = 0; j < 8; j++){
+            b[j] = _mm_xor_si128(ctr, k[0]);
+            ctr = _mm_add_epi64(ctr, one);
+        }
+        for (int r = 1; r < 10; r++){
+            for (int j = 0; j < 8; j++)
+                b[j] = _mm_aesenc_si128(b[j], k[r]);
+        }
+        for (int j = 0; j < 8; j++)
+            _mm_storeu_si128((__m128i*) (out + 16 * (i + j)), _mm_aesenclast_si128(b[j], k[10]));
+    }
+    for (; i < nblocks; i++){
+        __m128i m = ctr;
+        DO_ENC_BLOCK(m, k);
+        _mm_storeu_si128((__m128i*) (out + 16 * i), m);
+        ctr = _mm_add_epi64(ctr, one);
+    }
+}
+
+
+__attribute__((target("vaes,avx512f,aes,sse4.1")))
+void aes128_vaes512_ctr_blocks(const AESNIKey* ni_key, uint64_t round, uint64_t first_block, int nblocks, uint8_t* out){
+    const __m128i* ks = (const __m128i*) ni_key->round_keys;
+    __m512i k[11];
+    for (int r = 0; r < 11; r++)
+        k[r] = _mm512_maskz_broadcast_i32x4(0xFFFF, _mm_load_si128(ks + r));
+
+    // lane pairs (2j, 2j+1) hold the counter block first_block + j
+    int64_t r64 = (int64_t) round, b64 = (int64_t) first_block;
+    __m512i ctr = _mm512_set_epi64(r64, b64 + 3, r64, b64 + 2, r64, b64 + 1, r64, b64);
+    const __m512i four = _mm512_set_epi64(0, 4, 0, 4, 0, 4, 0, 4);
+
+    int i = 0;
+    for (; i + 16 <= nblocks; i += 16){
+        __m512i b[4];
+        for (int j = 0; j < 4; j++){
+            b[j] = _mm512_xor_si512(ctr, k[0]);
+            ctr = _mm512_add_epi64(ctr, four);
+        }
+        for (int r = 1; r < 10; r++){
+            for (int j = 0; j < 4; j++)
+                b[j] = _mm512_aesenc_epi128(b[j], k[r]);
+        }
+        for (int j = 0; j < 4; j++)
+            _mm512_storeu_si512((void*) (out + 16 * (i + 4 * j)), _mm512_aesenclast_epi128(b[j], k[10]));
+    }
+    if (i < nblocks)
+        aes128_ni_ctr_blocks(ni_key, round, first_block + i, nblocks - i, out + 16 * i);
+}
+
+
+__attribute__((target("vaes,avx2,aes,sse4.1")))
+void aes128_vaes256_ctr_blocks(const AESNIKey* ni_key, uint64_t round, uint64_t first_block, int nblocks, uint8_t* out){
+    const __m128i* ks = (const __m128i*) ni_key->round_keys;
+    __m256i k[11];
+    for (int r = 0; r < 11; r++)
+        k[r] = _mm256_broadcastsi128_si256(_mm_load_si128(ks + r));
+
+    int64_t r64 = (int64_t) round, b64 = (int64_t) first_block;
+    __m256i ctr = _mm256_set_epi64x(r64, b64 + 1, r64, b64);
+    const __m256i two = _mm256_set_epi64x(0, 2, 0, 2);
+
+    int i = 0;
+    for (; i + 8 <= nblocks; i += 8){
+        __m256i b[4];
+        for (int j = 0; j < 4; j++){
+            b[j] = _mm256_xor_si256(ctr, k[0]);
+            ctr = _mm256_add_epi64(ctr, two);
+        }
+        for (int r = 1; r < 10; r++){
+            for (int j = 0; j < 4; j++)
+                b[j] = _mm256_aesenc_epi128(b[j], k[r]);
+        }
+        for (int j = 0; j < 4; j++)
+            _mm256_storeu_si256((__m256i*) (out + 16 * (i + 2 * j)), _mm256_aesenclast_epi128(b[j], k[10]));
+    }
+    if (i < nblocks)
+        aes128_ni_ctr_blocks(ni_key, round, first_block + i, nblocks - i, out + 16 * i);
+}
@@ -0,0 +1,42 @@
+/**
+ *  AES-128 CTR keystream kernels based on the AES instructions.
+ *
+ *  Counter block i is (first_block + i || round), both 64-bit little-endian, which
+ *  is the layout of CSPRNG::keystream_blocks. The counters are built and
+ *  incremented in vector registers, so no plaintext buffer is needed.
+ *  - aes128_ni_ctr_blocks:     AES-NI, one block per instruction, 8 blocks in flight.
+ *  - aes128_vaes512_ctr_blocks: VAES on 512-bit registers, 4 blocks per instruction.
+ *  - aes128_vaes256_ctr_blocks: VAES on 256-bit registers, 2 blocks per instruction.
+ *
+ *  Each kernel is compiled for its own instruction set only, so this file can be
+ *  linked in binaries that run on any x86-64 host; check the cpu_supports_*
+ *  functions before calling a kernel.
+ */
+
+#ifndef __AES_NI_CTR
+#define __AES_NI_CTR
+
+#include <cstdint>
+
+
+struct AESNIKey
+{
+    alignas(16) int8_t round_keys[11 * 16];
+};
+
+bool cpu_supports_aesni();
+
+bool cpu_supports_vaes_avx512();
+
+bool cpu_supports_vaes_avx2();
+
+
+void aes128_ni_load_key(const uint8_t* key, AESNIKey* ni_key);
+
+void aes128_ni_ctr_blocks(const AESNIKey* ni_key, uint64_t round, uint64_t first_block, int nblocks, uint8_t* out);
+
+void aes128_vaes512_ctr_blocks(const AESNIKey* ni_key, uint64_t round, uint64_t first_block, int nblocks, uint8_t* out);
+
+void aes128_vaes256_ctr_blocks(const AESNIKey* ni_key, uint64_t round, uint64_t first_block, int nblocks, uint8_t* out);
+
+#endif
@@ -0,0 +1,202 @@
+/**
+ *  Round totals (total deviation, numbers of P2P consumers and prosumers) with
+ *  the pairwise masking of the sharing subsystem vs the FHE aggregation of
+ *  fhe_round_totals, for 150, 1000 and 10000 clients, e.g.
+ *      ./aggregation_benchmark --threads 4 --scheme ckks
+ *
+ *  For every number of clients it reports, per round,
+ *  - the client time and upload size, per client,
+ *  - the server time to compute and decode or decrypt the totals,
+ *  and, for the masking, the one-time setup of the pairwise keys.
+ *
+ *  Encrypting 10000 clients takes long, so the FHE uploads of N_SAMPLE_CLIENTS
+ *  clients are encrypted and reused cyclically: the server still adds one
+ *  ciphertext per client, and the totals are checked against the same data.
+ */
+
+#include "billing.h"
+#include "sharing.h"
+
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <random>
+#include <cmath>
+#include <cassert>
+
+
+static const int N_SAMPLE_CLIENTS = 4;
+
+struct AggregationSettings
+{
+    int threads = 1;
+    BillingScheme scheme = BILLING_CKKS;
+};
+
+struct SyntheticClient
+{
+    std::vector<double> deviations;
+    std::vector<double> consumer; // participation masks, as in client_participation
+    std::vector<double> prosumer;
+};
+
+
+AggregationSettings parse_arguments(int argc, char* argv[])
+{
+    AggregationSettings settings;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string option = argv[i];
+        std::string value = argv[i + 1];
+        if (option == "--threads")
+            settings.threads = stoi(value);
+        else if (option == "--scheme")
+            settings.scheme = parse_billing_scheme(value);
+        else
+            throw std::invalid_argument("unknown option " + option);
+    }
+    return settings;
+}
+
+SyntheticClient random_client(std::mt19937_64& rng)
+{
+    std::uniform_real_distribution<double> deviation(-2.0, 2.0);
+    std::uniform_int_distribution<int> role(0, 2); // 0: consumer, 1: prosumer, 2: not accepted
+    SyntheticClient client = {std::vector<double>(TIMESLOTS), std::vector<double>(TIMESLOTS, 0.0), std::vector<double>(TIMESLOTS, 0.0)};
+    for (int t = 0; t < TIMESLOTS; t++)
+    {
+        client.deviations[t] = std::nearbyint(deviation(rng) * 1e4) / 1e4;
+        int r = role(rng);
+        if (0 == r)
+            client.consumer[t] = 1;
+        else if (1 == r)
+            client.prosumer[t] = 1;
+    }
+    return client;
+}
+
+// largest |x[i] - y[i]|
+double max_abs_difference(const std::vector<double>& x, const std::vector<double>& y)
+{
+    double diff = 0.0;
+    for (unsigned int i = 0; i < x.size(); i++)
+        diff = std::max(diff, std::fabs(x[i] - y[i]));
+    return diff;
+}
+
+
+void aggregation_experiment(const AggregationSettings& settings)
+{
+    CryptoContext<DCRTPoly> cc = billing_crypto_context(settings.scheme);
+    auto keys = cc->KeyGen();
+
+    std::mt19937_64 rng(1);
+    std::vector<SyntheticClient> samples;
+    for (int i = 0; i < N_SAMPLE_CLIENTS; i++)
+        samples.push_back(random_client(rng));
+
+    // FHE uploads of the sample clients
+    std::vector<Ciphertext<DCRTPoly>> sample_deviations, sample_consumers, sample_prosumers;
+    auto encryption_begin = std::chrono::high_resolution_clock::now();
+    for (const SyntheticClient& client : samples)
+    {
+        std::vector<double> accepted(TIMESLOTS), consumption_promise(TIMESLOTS), supply_promise(TIMESLOTS);
+        for (int t = 0; t < TIMESLOTS; t++)
+        {
+            accepted[t] = client.consumer[t] + client.prosumer[t];
+            consumption_promise[t] = client.consumer[t];
+            supply_promise[t] = client.prosumer[t];
+        }
+        sample_deviations.push_back(encrypt_billing(client.deviations, BFV_DATA_SCALE, cc, keys.publicKey, settings.scheme));
+        auto [ct_consumer, ct_prosumer] = client_participation(cc, keys.publicKey, accepted, consumption_promise, supply_promise, settings.scheme);
+        sample_consumers.push_back(ct_consumer);
+        sample_prosumers.push_back(ct_prosumer);
+    }
+    auto encryption_end = std::chrono::high_resolution_clock::now();
+    double fhe_client_us = std::chrono::duration<double, std::micro>(encryption_end - encryption_begin).count() / N_SAMPLE_CLIENTS;
+    size_t fhe_upload_bytes = ciphertext_bytes(sample_deviations[0], cc) + ciphertext_bytes(sample_consumers[0], cc)
+                            + ciphertext_bytes(sample_prosumers[0], cc);
+
+    for (int n_clients : {150, 1000, 10000})
+    {
+        // expected totals
+        RoundTotals expected = {std::vector<double>(TIMESLOTS, 0.0), std::vector<double>(TIMESLOTS, 0.0), std::vector<double>(TIMESLOTS, 0.0)};
+        for (int i = 0; i < n_clients; i++)
+        {
+            const SyntheticClient& client = samples[i % N_SAMPLE_CLIENTS];
+            for (int t = 0; t < TIMESLOTS; t++)
+            {
+                expected.totalDeviation[t] += client.deviations[t];
+                expected.totalConsumers[t] += client.consumer[t];
+                expected.totalProsumers[t] += client.prosumer[t];
+            }
+        }
+
+        // masking: the three vectors of a client are masked as one vector of 3 * TIMESLOTS slots
+        auto setup_begin = std::chrono::high_resolution_clock::now();
+        SharingKeys sharing_keys = setup(harary_graph(n_clients, log_degree(n_clients)));
+        auto setup_end = std::chrono::high_resolution_clock::now();
+        FixedPointCodec codec(MODULUS, n_clients);
+        std::vector<std::vector<double>> values(N_SAMPLE_CLIENTS);
+        for (int i = 0; i < N_SAMPLE_CLIENTS; i++)
+        {
+            values[i] = samples[i].deviations;
+            values[i].insert(values[i].end(), samples[i].consumer.begin(), samples[i].consumer.end());
+            values[i].insert(values[i].end(), samples[i].prosumer.begin(), samples[i].prosumer.end());
+        }
+        std::vector<uint32_t> shares((size_t) n_clients * 3 * TIMESLOTS);
+        auto sharing_begin = std::chrono::high_resolution_clock::now();
+        #pragma omp parallel for num_threads(settings.threads) schedule(dynamic, 16)
+        for (int i = 0; i < n_clients; i++)
+            generate_masked_vector(i, 0, values[i % N_SAMPLE_CLIENTS].data(), 3 * TIMESLOTS, codec, sharing_keys,
+                                   shares.data() + (size_t) i * 3 * TIMESLOTS);
+        auto sharing_end = std::chrono::high_resolution_clock::now();
+        ShareAggregator aggregator(3 * TIMESLOTS, MODULUS);
+        aggregator.add_share_matrix(shares.data(), n_clients);
+        std::vector<double> sums = codec.decode(aggregator);
+        auto masking_end = std::chrono::high_resolution_clock::now();
+        delete_csprngs(sharing_keys);
+
+        double masking_error = max_abs_difference(std::vector<double>(sums.begin(), sums.begin() + TIMESLOTS), expected.totalDeviation);
+        assert(masking_error < 1e-6 * n_clients);
+        assert(0 == max_abs_difference(std::vector<double>(sums.begin() + TIMESLOTS, sums.begin() + 2 * TIMESLOTS), expected.totalConsumers));
+
+        // FHE: one ciphertext per client and quantity
+        std::vector<Ciphertext<DCRTPoly>> ct_deviations(n_clients), ct_consumers(n_clients), ct_prosumers(n_clients);
+        for (int i = 0; i < n_clients; i++)
+        {
+            ct_deviations[i] = sample_deviations[i % N_SAMPLE_CLIENTS];
+            ct_consumers[i] = sample_consumers[i % N_SAMPLE_CLIENTS];
+            ct_prosumers[i] = sample_prosumers[i % N_SAMPLE_CLIENTS];
+        }
+        auto fhe_begin = std::chrono::high_resolution_clock::now();
+        RoundTotals totals = fhe_round_totals(cc, keys.secretKey, ct_deviations, ct_consumers, ct_prosumers, settings.threads, settings.scheme);
+        auto fhe_end = std::chrono::high_resolution_clock::now();
+
+        double fhe_error = max_abs_difference(totals.totalDeviation, expected.totalDeviation);
+        assert(fhe_error < 1e-4);
+        assert(0 == max_abs_difference(totals.totalConsumers, expected.totalConsumers));
+        assert(0 == max_abs_difference(totals.totalProsumers, expected.totalProsumers));
+
+        // Display results
+        std::cout << "nr_clients: " << n_clients << ", "
+                  << "threads: " << settings.threads
+                  << " -> masking: setup " << std::chrono::duration_cast<std::chrono::microseconds>(setup_end - setup_begin).count() << " us"
+                  << ", client " << std::chrono::duration<double, std::micro>(sharing_end - sharing_begin).count() / n_clients << " us"
+                  << ", upload " << 3 * TIMESLOTS * sizeof(uint32_t) << " B"
+                  << ", server " << std::chrono::duration_cast<std::chrono::microseconds>(masking_end - sharing_end).count() << " us"
+                  << ", max error " << masking_error
+                  << "; fhe (" << billing_scheme_name(settings.scheme) << "): client " << fhe_client_us << " us"
+                  << ", upload " << fhe_upload_bytes / 1024.0 << " KiB"
+                  << ", server " << std::chrono::duration_cast<std::chrono::microseconds>(fhe_end - fhe_begin).count() << " us"
+                  << ", max error " << fhe_error
+                  << std::endl;
+    }
+}
+
+
+int main(int argc, char* argv[])
+{
+    aggregation_experiment(parse_arguments(argc, argv));
+    return 0;
+}
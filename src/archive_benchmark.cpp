@@ -0,0 +1,155 @@
+/**
+ *  Result archive: write throughput of ArchiveWriter and point-lookup latency
+ *  of ArchiveReader, for millions of records, e.g.
+ *      ./archive_benchmark --records 2000000 --bytes 512 --clients 10000
+ *
+ *  Record i is the result of client i % clients in round i / clients. The
+ *  payloads are synthetic (a billing ciphertext is megabytes, so millions of
+ *  them would not fit on a disk): each starts with its client and round, which
+ *  the lookups check. Reports
+ *  - the appends per second and MiB/s, including the final flush,
+ *  - the time to open the archive (load and sort the index),
+ *  - the mean, median and 99th percentile of the latency of random lookups
+ *    that read the first and last word of the payload.
+ *  The archive is removed at the end, unless --keep 1.
+ */
+
+#include "result_archive.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <cstring>
+#include <cassert>
+#include <algorithm>
+#include <cstdio>
+
+
+struct ArchiveSettings
+{
+    uint64_t records = 2000000;
+    size_t bytes = 512;
+    uint32_t clients = 10000;
+    size_t batch_kib = 1024;
+    int lookups = 100000;
+    std::string path = "archive_benchmark.archive";
+    bool keep = false;
+};
+
+
+ArchiveSettings parse_arguments(int argc, char* argv[])
+{
+    ArchiveSettings settings;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string option = argv[i];
+        std::string value = argv[i + 1];
+        if (option == "--records")
+            settings.records = stoull(value);
+        else if (option == "--bytes")
+            settings.bytes = stoull(value);
+        else if (option == "--clients")
+            settings.clients = stoul(value);
+        else if (option == "--batch")
+            settings.batch_kib = stoull(value);
+        else if (option == "--lookups")
+            settings.lookups = stoi(value);
+        else if (option == "--path")
+            settings.path = value;
+        else if (option == "--keep")
+            settings.keep = stoi(value);
+        else
+            throw std::invalid_argument("unknown option " + option);
+    }
+    if (settings.bytes < 2 * sizeof(uint32_t))
+        throw std::invalid_argument("--bytes must hold the client and the round");
+    return settings;
+}
+
+
+void archive_experiment(const ArchiveSettings& settings)
+{
+    std::remove(settings.path.c_str());
+    std::remove(archive_index_path(settings.path).c_str());
+
+    // Write
+    std::vector<uint8_t> payload(settings.bytes, 0xA5);
+    auto write_begin = std::chrono::high_resolution_clock::now();
+    uint64_t data_bytes = 0;
+    {
+        ArchiveWriter writer(settings.path, settings.batch_kib * 1024);
+        for (uint64_t i = 0; i < settings.records; i++)
+        {
+            uint32_t client = i % settings.clients, round = i / settings.clients;
+            memcpy(payload.data(), &client, sizeof(client));
+            memcpy(payload.data() + sizeof(client), &round, sizeof(round));
+            writer.append(client, round, payload.data(), payload.size());
+        }
+        writer.flush();
+        data_bytes = writer.data_bytes();
+    }
+    auto write_end = std::chrono::high_resolution_clock::now();
+    double write_s = std::chrono::duration<double>(write_end - write_begin).count();
+
+    // Open
+    auto open_begin = std::chrono::high_resolution_clock::now();
+    ArchiveReader reader(settings.path);
+    auto open_end = std::chrono::high_resolution_clock::now();
+    assert(reader.size() == settings.records);
+
+    // Point lookups
+    std::mt19937_64 rng(1);
+    std::uniform_int_distribution<uint64_t> record(0, settings.records - 1);
+    std::vector<double> latencies_ns(settings.lookups);
+    uint64_t checksum = 0;
+    for (int l = 0; l < settings.lookups; l++)
+    {
+        uint64_t i = record(rng);
+        uint32_t client = i % settings.clients, round = i / settings.clients;
+        auto lookup_begin = std::chrono::high_resolution_clock::now();
+        ArchiveRecord result = reader.lookup(client, round);
+        uint32_t stored_client, stored_round;
+        memcpy(&stored_client, result.data, sizeof(stored_client));
+        memcpy(&stored_round, result.data + sizeof(stored_client), sizeof(stored_round));
+        checksum += result.data[result.size - 1];
+        auto lookup_end = std::chrono::high_resolution_clock::now();
+        latencies_ns[l] = std::chrono::duration<double, std::nano>(lookup_end - lookup_begin).count();
+        if (stored_client != client || stored_round != round || result.size != settings.bytes)
+            throw std::runtime_error("wrong record for client " + std::to_string(client) + " and round " + std::to_string(round));
+    }
+    assert(nullptr == reader.lookup(settings.clients, 0).data);
+    assert(checksum == (uint64_t) 0xA5 * settings.lookups);
+
+    double mean_ns = 0.0;
+    for (double latency : latencies_ns)
+        mean_ns += latency / settings.lookups;
+    std::sort(latencies_ns.begin(), latencies_ns.end());
+
+    // Display results
+    std::cout << "records: " << settings.records << ", "
+              << "bytes: " << settings.bytes << ", "
+              << "batch: " << settings.batch_kib << " KiB"
+              << " -> write: " << settings.records / write_s << " records/s"
+              << ", " << data_bytes / write_s / 1024.0 / 1024.0 << " MiB/s"
+              << ", archive " << data_bytes / 1024.0 / 1024.0 << " MiB"
+              << "; open: " << std::chrono::duration_cast<std::chrono::microseconds>(open_end - open_begin).count() << " us"
+              << "; lookup: mean " << mean_ns << " ns"
+              << ", median " << latencies_ns[settings.lookups / 2] << " ns"
+              << ", p99 " << latencies_ns[settings.lookups * 99 / 100] << " ns"
+              << std::endl;
+
+    if (!settings.keep)
+    {
+        std::remove(settings.path.c_str());
+        std::remove(archive_index_path(settings.path).c_str());
+    }
+}
+
+
+int main(int argc, char* argv[])
+{
+    archive_experiment(parse_arguments(argc, argv));
+    return 0;
+}
@@ -0,0 +1,1542 @@
+#include "billing.h"
+
+#include <cassert>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <unordered_map>
+#include <memory>
+#include <algorithm>
+#include <cmath>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "vectorutils.hpp"
+#include "billing_tools.hpp"
+
+
+/**
+ * Load the context data
+ *  
+ * Returns a tuple with plaintext vectors containing
+ * - the total deviation,
+ * - the trading price,
+ * - the retail price,
+ * - the feed_in_tarif,
+ * - the number of consumers, and
+ * - the number of prosumers.
+ * 
+ * Each vector contains data for the entire round.
+ */
+std::tuple<vector<double>,
+ 		   vector<double>,
+		   vector<double>,
+		   vector<double>,
+		   vector<double>>
+context_setup()
+{
+	return load_context_file(data_directory() + "/context.csv");
+}
+/* 	END definition of function context_setup  */
+
+std::string data_directory()
+{
+	return DATA_DIR + "/" + std::to_string(TIMESLOTS) + "_ts_" + std::to_string(NR_CLIENTS) + "_clients";
+}
+
+std::tuple<vector<double>,
+ 		   vector<double>,
+		   vector<double>,
+		   vector<double>,
+		   vector<double>>
+load_context_file(const std::string &fname)
+{
+	std::cout << fname << std::endl;
+
+	ifstream inputFile(fname);
+	if (!inputFile.is_open()) {
+		throw std::invalid_argument("cannot open specified file");
+	}
+	std::string line;
+
+	// Skip header line
+	getline(inputFile, line);
+
+	// Feed-in tarif
+	getline(inputFile, line);
+	std::vector<double> feedInTarif = parseToDoubles(line);
+	assert(feedInTarif.size() == TIMESLOTS);
+
+	// Trading prices
+	getline(inputFile, line);
+	std::vector<double> tradingPrice = parseToDoubles(line);
+	assert(tradingPrice.size() == TIMESLOTS);
+
+	// Total consumers
+	getline(inputFile, line);
+	std::vector<double> totalConsumers = parseToDoubles(line);
+	assert(totalConsumers.size() == TIMESLOTS);
+
+	// Total prosumers
+	getline(inputFile, line);
+	std::vector<double> totalProsumers = parseToDoubles(line);
+	assert(totalProsumers.size() == TIMESLOTS);
+
+	// Total deviation
+	getline(inputFile, line);
+	std::vector<double> totalDeviation = parseToDoubles(line);
+	assert(totalDeviation.size() == TIMESLOTS);
+
+	return {
+		feedInTarif,
+		tradingPrice,
+		totalProsumers,
+		totalConsumers,
+		totalDeviation
+	};
+}
+/* 	END definition of function load_context_file  */
+
+/**
+ * Loads client data from file.
+ * 
+ * Returns:
+ * - client's consumptions,
+ * - ... supplies, 
+ * - ... consumption_promise, 
+ * - ... supply_promise, 
+ * - ... retailPrice, 
+ * - ... accepted, 
+ * - ... deviations, 
+ * - ... expected bill, 
+ * - ... expected reward.
+ * 
+ * The last two values can be used in the experimentation phase to
+ * check the output of the server is correct.
+ */
+std::tuple<
+	std::vector<double>,
+	std::vector<double>,
+	std::vector<double>,
+	std::vector<double>,
+	std::vector<double>,
+	std::vector<double>,
+	std::vector<double>,
+	std::vector<double>,
+	std::vector<double>
+>
+load_client_data(int clientID)
+{
+	return load_client_file(data_directory() + "/user_" + std::to_string(clientID) + ".csv");
+}
+/* 	END definition of function load_client_data  */
+
+std::tuple<
+	std::vector<double>,
+	std::vector<double>,
+	std::vector<double>,
+	std::vector<double>,
+	std::vector<double>,
+	std::vector<double>,
+	std::vector<double>,
+	std::vector<double>,
+	std::vector<double>
+>
+load_client_file(const std::string &fname)
+{
+	std::cout << fname << std::endl;
+
+	ifstream inputFile(fname);
+	if (!inputFile.is_open()) {
+		throw std::invalid_argument("cannot open specified file");
+	}
+	std::string line;
+
+	// Skip header line
+	getline(inputFile, line);
+
+	// Retail price
+	getline(inputFile, line);
+	std::vector<double> retailPrice = parseToDoubles(line);
+	assert(retailPrice.size() == TIMESLOTS);
+
+	// Consumption promise
+	getline(inputFile, line);
+	std::vector<double> consumption_promise = parseToDoubles(line);
+	assert(consumption_promise.size() == TIMESLOTS);
+
+	// Supply promise
+	getline(inputFile, line);
+	std::vector<double> supply_promise = parseToDoubles(line);
+	assert(supply_promise.size() == TIMESLOTS);
+
+	// Consumption
+	getline(inputFile, line);
+	std::vector<double> consumptions = parseToDoubles(line);
+	assert(consumptions.size() == TIMESLOTS);
+
+	// Supply
+	getline(inputFile, line);
+	std::vector<double> supplies = parseToDoubles(line);
+	assert(supplies.size() == TIMESLOTS);
+	
+	// Individual deviation
+	getline(inputFile, line);
+	std::vector<double> deviations = parseToDoubles(line);
+	assert(deviations.size() == TIMESLOTS);
+
+	// Trading accepted
+	getline(inputFile, line);
+	std::vector<double> accepted = parseToDoubles(line);
+	assert(accepted.size() == TIMESLOTS);
+
+	// Expected bill
+	getline(inputFile, line);
+	std::vector<double> expectedBill = parseToDoubles(line);
+	assert(expectedBill.size() == TIMESLOTS);
+
+	// Expected reward
+	getline(inputFile, line);
+	std::vector<double> expectedReward = parseToDoubles(line);
+	assert(expectedReward.size() == TIMESLOTS);
+
+	inputFile.close();
+
+	return {
+		consumptions,
+		supplies,
+		consumption_promise,
+		supply_promise,
+		retailPrice,
+		accepted,
+		deviations,
+		expectedBill,
+		expectedReward
+	};
+}
+/* 	END definition of function load_client_file  */
+
+
+const char* billing_scheme_name(BillingScheme scheme)
+{
+	return (BILLING_CKKS == scheme) ? "ckks" : "bfv";
+}
+
+BillingScheme parse_billing_scheme(const std::string& name)
+{
+	if ("ckks" == name)
+		return BILLING_CKKS;
+	if ("bfv" == name)
+		return BILLING_BFV;
+	throw std::invalid_argument("unknown billing scheme " + name);
+}
+
+CryptoContext<DCRTPoly> billing_crypto_context(BillingScheme scheme)
+{
+	if (BILLING_CKKS == scheme)
+	{
+		CCParams<CryptoContextCKKSRNS> parameters = generate_parameters_ckks(N_TIME_SLOTS);
+		return generate_crypto_context_ckks(parameters);
+	}
+
+	// bill = consumption * price (+ supplement of the same size), at scale BFV_BILL_SCALE
+	double max_bill = 2 * MAX_ENERGY_PER_TIMESLOT * MAX_PRICE * BFV_BILL_SCALE;
+	CCParams<CryptoContextBFVRNS> parameters = generate_parameters_bfv(plaintext_modulus_for(max_bill), BFV_BILLING_DEPTH);
+	return generate_crypto_context_bfv(parameters);
+}
+
+// packs msg, scaled by bfv_scale in BFV
+static Plaintext encode_billing(const vector<double>& msg, double bfv_scale, CryptoContext<DCRTPoly>& cc, BillingScheme scheme)
+{
+	if (BILLING_CKKS == scheme)
+		return cc->MakeCKKSPackedPlaintext(msg);
+	return pack_integers(msg, bfv_scale, cc);
+}
+
+Ciphertext<DCRTPoly> encrypt_billing(const vector<double>& msg, double bfv_scale, CryptoContext<DCRTPoly>& cc,
+                                     const PublicKey<DCRTPoly>& pk, BillingScheme scheme)
+{
+	return cc->Encrypt(pk, encode_billing(msg, bfv_scale, cc, scheme));
+}
+
+std::vector<double> decrypt_billing(
+	CryptoContext<DCRTPoly> &cc,
+	const PrivateKey<DCRTPoly> &sk,
+	const Ciphertext<DCRTPoly> &ctxt,
+	BillingScheme scheme,
+	double bfv_scale,
+	int n_values
+)
+{
+	if (nullptr == ctxt)
+		return std::vector<double>(n_values, 0.0);
+	if (BILLING_BFV == scheme)
+		return decrypt_integers(ctxt, bfv_scale, n_values, cc, sk);
+	Plaintext ptxt;
+	cc->Decrypt(sk, ctxt, &ptxt);
+	ptxt->SetLength(n_values);
+	return ptxt->GetRealPackedValue();
+}
+
+
+// 1 in the time slots where the deviation is <= 0, 0 elsewhere
+static vector<double> deviation_signs(const vector<double>& deviations)
+{
+	vector<double> sign_deviations(TIMESLOTS);
+	for (int i = 0; i < TIMESLOTS; i++)
+	{
+		if (deviations[i] <= 0)
+			sign_deviations[i] = 1;
+		else
+			sign_deviations[i] = 0;
+	}
+	return sign_deviations;
+}
+
+
+/**
+ * Definition of function client_setup.
+ * 
+ * Receives
+ *  - the cryptographic context,
+ *	- the client's public key,
+ *  - the client's consumption data,
+ *  - ... supply data
+ *  - ... deviation data,
+ *  - ... accepted for p2p-trading data,
+ *  - the scheme,
+ *  - whether the client can supply energy (public, e.g., from its contract).
+ *
+ * Returns a tuple with ciphertexts encrypting 
+ * - the consumptions, 
+ * - the supplies (null if the client cannot supply energy),
+ * - the deviations,
+ * - the signs of the deviations (marking negative or positive),
+ * - mask indicating when client was accepted for p2p-trading.
+ */
+std::tuple<
+	Ciphertext<DCRTPoly>,
+	Ciphertext<DCRTPoly>,
+	Ciphertext<DCRTPoly>,
+	Ciphertext<DCRTPoly>,
+	Ciphertext<DCRTPoly>
+>
+client_setup(
+	CryptoContext<DCRTPoly> &cc, 
+	const PublicKey<DCRTPoly> &ckks_pk,
+	std::vector<double> consumptions,
+	std::vector<double> supplies,
+	std::vector<double> deviations,
+	std::vector<double> accepted,
+	BillingScheme scheme,
+	bool can_supply
+)
+{
+	// Compute signs of individual deviations
+	vector<double> sign_deviations = deviation_signs(deviations);
+
+	// Encrypt the secret data
+	Ciphertext<DCRTPoly> ct_consump = encrypt_billing(consumptions, BFV_DATA_SCALE, cc, ckks_pk, scheme);
+	Ciphertext<DCRTPoly> ct_supplies = can_supply ? encrypt_billing(supplies, BFV_DATA_SCALE, cc, ckks_pk, scheme) : nullptr;
+	Ciphertext<DCRTPoly> ct_deviations = encrypt_billing(deviations, BFV_DATA_SCALE, cc, ckks_pk, scheme);
+	Ciphertext<DCRTPoly> ct_signs = encrypt_billing(sign_deviations, 1, cc, ckks_pk, scheme);
+	Ciphertext<DCRTPoly> ct_accepted = encrypt_billing(accepted, 1, cc, ckks_pk, scheme);
+
+	return {
+		ct_consump, 
+		ct_supplies, 
+		ct_deviations, 
+		ct_signs,
+		ct_accepted
+	};
+}
+/* 	END definition of function client_setup  */
+
+
+/**
+ * Online part of client_setup: the encryptions of zero are taken from pool,
+ * which should hold CLIENT_ENCRYPTIONS of them. The data is only encoded
+ * and added to them.
+ */
+std::tuple<
+	Ciphertext<DCRTPoly>,
+	Ciphertext<DCRTPoly>,
+	Ciphertext<DCRTPoly>,
+	Ciphertext<DCRTPoly>,
+	Ciphertext<DCRTPoly>
+>
+client_setup(
+	ZeroEncryptionPool &pool,
+	std::vector<double> consumptions,
+	std::vector<double> supplies,
+	std::vector<double> deviations,
+	std::vector<double> accepted
+)
+{
+	// Compute signs of individual deviations
+	vector<double> sign_deviations = deviation_signs(deviations);
+
+	return {
+		pool.encrypt(consumptions),
+		pool.encrypt(supplies),
+		pool.encrypt(deviations),
+		pool.encrypt(sign_deviations),
+		pool.encrypt(accepted)
+	};
+}
+/* 	END definition of function client_setup  */
+
+
+std::tuple<
+	SeededCiphertext,
+	SeededCiphertext,
+	SeededCiphertext,
+	SeededCiphertext,
+	SeededCiphertext
+>
+client_setup_seeded(
+	CryptoContext<DCRTPoly> &cc,
+	const PrivateKey<DCRTPoly> &ckks_sk,
+	std::vector<double> consumptions,
+	std::vector<double> supplies,
+	std::vector<double> deviations,
+	std::vector<double> accepted
+)
+{
+	// Compute signs of individual deviations
+	vector<double> sign_deviations = deviation_signs(deviations);
+
+	return {
+		pack_and_encrypt_seeded(consumptions, cc, ckks_sk),
+		pack_and_encrypt_seeded(supplies, cc, ckks_sk),
+		pack_and_encrypt_seeded(deviations, cc, ckks_sk),
+		pack_and_encrypt_seeded(sign_deviations, cc, ckks_sk),
+		pack_and_encrypt_seeded(accepted, cc, ckks_sk)
+	};
+}
+/* 	END definition of function client_setup_seeded  */
+
+
+/**
+ * client_setup in premultiplied upload mode: the masks are applied in the
+ * clear, before the encryption.
+ */
+PremultipliedUploads client_setup_premultiplied(
+	CryptoContext<DCRTPoly> &cc,
+	const PublicKey<DCRTPoly> &ckks_pk,
+	const std::vector<double> &consumptions,
+	const std::vector<double> &supplies,
+	const std::vector<double> &deviations,
+	const std::vector<double> &accepted,
+	BillingScheme scheme,
+	bool can_supply
+)
+{
+	// Compute signs of individual deviations
+	vector<double> sign_deviations = deviation_signs(deviations);
+
+	vector<double> rejected(TIMESLOTS), nonNegAccepted(TIMESLOTS);
+	for (int i = 0; i < TIMESLOTS; i++)
+	{
+		rejected[i] = 1 - accepted[i];
+		nonNegAccepted[i] = (1 - sign_deviations[i]) * accepted[i];
+	}
+
+	PremultipliedUploads uploads;
+	uploads.consumptionAccepted = encrypt_billing(consumptions * accepted, BFV_DATA_SCALE, cc, ckks_pk, scheme);
+	uploads.consumptionRejected = encrypt_billing(consumptions * rejected, BFV_DATA_SCALE, cc, ckks_pk, scheme);
+	if (can_supply)
+	{
+		uploads.suppliesAccepted = encrypt_billing(supplies * accepted, BFV_DATA_SCALE, cc, ckks_pk, scheme);
+		uploads.suppliesRejected = encrypt_billing(supplies * rejected, BFV_DATA_SCALE, cc, ckks_pk, scheme);
+	}
+	uploads.nonNegAccepted = encrypt_billing(nonNegAccepted, 1, cc, ckks_pk, scheme);
+	uploads.deviations = encrypt_billing(deviations, BFV_DATA_SCALE, cc, ckks_pk, scheme);
+	return uploads;
+}
+/* 	END definition of function client_setup_premultiplied  */
+
+
+std::tuple<
+	Ciphertext<DCRTPoly>,
+	Ciphertext<DCRTPoly>
+>
+client_participation(
+	CryptoContext<DCRTPoly> &cc,
+	const PublicKey<DCRTPoly> &publickey,
+	const std::vector<double> &accepted,
+	const std::vector<double> &consumption_promise,
+	const std::vector<double> &supply_promise,
+	BillingScheme scheme
+)
+{
+	vector<double> consumer(TIMESLOTS, 0.0);
+	vector<double> prosumer(TIMESLOTS, 0.0);
+	for (int i = 0; i < TIMESLOTS; i++)
+	{
+		if (accepted[i] && consumption_promise[i] > supply_promise[i])
+			consumer[i] = 1;
+		else if (accepted[i] && supply_promise[i] > consumption_promise[i])
+			prosumer[i] = 1;
+	}
+
+	return {
+		encrypt_billing(consumer, 1, cc, publickey, scheme),
+		encrypt_billing(prosumer, 1, cc, publickey, scheme)
+	};
+}
+/* 	END definition of function client_participation  */
+
+
+Ciphertext<DCRTPoly> sum_ciphertexts(
+	CryptoContext<DCRTPoly> &cc,
+	const std::vector<Ciphertext<DCRTPoly>> &ctxts,
+	int n_threads
+)
+{
+	int n = ctxts.size();
+	if (0 == n)
+		throw std::invalid_argument("cannot sum an empty set of ciphertexts");
+#ifdef _OPENMP
+	if (n_threads <= 0)
+		n_threads = omp_get_max_threads();
+#else
+	n_threads = 1;
+#endif
+	n_threads = std::min(n_threads, n);
+
+	// each thread sums a contiguous range
+	std::vector<Ciphertext<DCRTPoly>> partial(n_threads);
+	#pragma omp parallel for num_threads(n_threads) schedule(static)
+	for (int t = 0; t < n_threads; t++)
+	{
+		int begin = (int64_t) n * t / n_threads;
+		int end = (int64_t) n * (t + 1) / n_threads;
+		Ciphertext<DCRTPoly> sum = ctxts[begin]->Clone();
+		for (int i = begin + 1; i < end; i++)
+			cc->EvalAddInPlace(sum, ctxts[i]);
+		partial[t] = sum;
+	}
+
+	// tree reduction of the partial sums
+	for (int stride = 1; stride < n_threads; stride *= 2)
+	{
+		#pragma omp parallel for num_threads(n_threads) schedule(static)
+		for (int t = 0; t < n_threads - stride; t += 2 * stride)
+			cc->EvalAddInPlace(partial[t], partial[t + stride]);
+	}
+	return partial[0];
+}
+/* 	END definition of function sum_ciphertexts  */
+
+
+RoundTotals fhe_round_totals(
+	CryptoContext<DCRTPoly> &cc,
+	const PrivateKey<DCRTPoly> &sk,
+	const std::vector<Ciphertext<DCRTPoly>> &ct_deviations,
+	const std::vector<Ciphertext<DCRTPoly>> &ct_consumers,
+	const std::vector<Ciphertext<DCRTPoly>> &ct_prosumers,
+	int n_threads,
+	BillingScheme scheme
+)
+{
+	RoundTotals totals = {
+		decrypt_billing(cc, sk, sum_ciphertexts(cc, ct_deviations, n_threads), scheme, BFV_DATA_SCALE),
+		decrypt_billing(cc, sk, sum_ciphertexts(cc, ct_consumers, n_threads), scheme, 1),
+		decrypt_billing(cc, sk, sum_ciphertexts(cc, ct_prosumers, n_threads), scheme, 1)
+	};
+	for (int i = 0; i < TIMESLOTS; i++)
+	{
+		totals.totalDeviation[i] = std::nearbyint(totals.totalDeviation[i] * BFV_DATA_SCALE) / BFV_DATA_SCALE;
+		totals.totalConsumers[i] = std::nearbyint(totals.totalConsumers[i]);
+		totals.totalProsumers[i] = std::nearbyint(totals.totalProsumers[i]);
+	}
+	return totals;
+}
+/* 	END definition of function fhe_round_totals  */
+
+
+std::tuple<
+	std::vector<double>,
+	std::vector<double>,
+	std::vector<double>
+>
+server_setup(std::vector<double> totalDeviation)
+{
+	// Create total deviation masks
+	vector<double> maskTotalDevZero(totalDeviation.size(), 0.0);
+	vector<double> maskTotalDevNegative(totalDeviation.size(), 0.0);
+	vector<double> maskTotalDevPositive(totalDeviation.size(), 0.0);
+	for (unsigned int i = 0; i < totalDeviation.size(); i++)
+	{
+		if (totalDeviation[i] == 0)
+			maskTotalDevZero[i] = 1;
+		else if (totalDeviation[i] > 0)
+			maskTotalDevPositive[i] = 1;
+		else // total_deviation[i] < 0
+			maskTotalDevNegative[i] = 1;
+	}
+
+	return {
+		maskTotalDevPositive,
+		maskTotalDevZero,
+		maskTotalDevNegative
+	};
+}
+
+/*	END definition of function server_setup	*/
+
+
+BillingPlan plan_billing(
+	const std::vector<double> &totalP2PConsumers,
+	const std::vector<double> &totalP2PProsumers,
+	const std::vector<double> &maskTotalDevPositive,
+	const std::vector<double> &maskTotalDevNegative
+)
+{
+	auto any_nonzero = [](const std::vector<double> &v) {
+		return std::any_of(v.begin(), v.end(), [](double x) { return 0 != x; });
+	};
+
+	BillingPlan plan;
+	plan.p2p = any_nonzero(totalP2PConsumers) || any_nonzero(totalP2PProsumers);
+	plan.supplement = plan.p2p && any_nonzero(maskTotalDevNegative);
+	plan.penalty = plan.p2p && any_nonzero(maskTotalDevPositive);
+	return plan;
+}
+
+
+BillingOps &BillingOps::operator+=(const BillingOps &other)
+{
+	encodings += other.encodings;
+	encryptions += other.encryptions;
+	mults += other.mults;
+	plain_mults += other.plain_mults;
+	additions += other.additions;
+	relinearizations += other.relinearizations;
+	peak_bytes = std::max(peak_bytes, other.peak_bytes);
+	return *this;
+}
+
+
+// the counts follow encode_round_plaintexts, encode_tariff_plaintexts and server_billing
+BillingOps round_encoding_ops(const BillingPlan &plan)
+{
+	BillingOps ops;
+	ops.encodings = 1 + (plan.p2p ? 2 : 0) + plan.supplement + 2 * plan.penalty; // feedInTarif; ones, tradingPrice; masks, rewardPenalty
+	ops.encryptions = plan.penalty;
+	return ops;
+}
+
+BillingOps tariff_encoding_ops(const BillingPlan &plan)
+{
+	BillingOps ops;
+	ops.encodings = 1 + plan.supplement; // retailPrice, billSupplement
+	ops.encryptions = plan.supplement;
+	return ops;
+}
+
+BillingOps client_billing_ops(const BillingPlan &plan, bool can_supply)
+{
+	BillingOps ops;
+	if (!plan.p2p)
+	{
+		// retail price and feed-in tarif only
+		ops.plain_mults = 1 + can_supply;
+		return ops;
+	}
+	// rejected; nonNegDevSigns and nonNegAccepted
+	bool non_neg = plan.supplement || plan.penalty;
+	ops.additions = 1 + non_neg;
+	ops.mults = non_neg;
+	ops.relinearizations = non_neg;
+
+	// bill: retail, P2P, supplement
+	ops.plain_mults = 2 + plan.supplement;
+	ops.mults += 2 + plan.supplement;
+	ops.additions += 1 + plan.supplement;
+	ops.relinearizations += 1;
+
+	// reward: feed-in, P2P, penalty; the penalty alone without supplies
+	if (can_supply)
+	{
+		ops.plain_mults += 2 + plan.penalty;
+		ops.mults += 2 + plan.penalty;
+		ops.additions += 1 + plan.penalty;
+		ops.relinearizations += 1;
+	}
+	else if (plan.penalty)
+	{
+		ops.plain_mults += 1;
+		ops.mults += 1;
+		ops.relinearizations += 1;
+	}
+	return ops;
+}
+
+
+BillingOps premultiplied_billing_ops(const BillingPlan &plan, bool can_supply)
+{
+	BillingOps ops;
+	if (!plan.p2p)
+	{
+		// retail price and feed-in tarif of the rejected terms only
+		ops.plain_mults = 1 + can_supply;
+		return ops;
+	}
+	// bill: retail, P2P, supplement
+	ops.plain_mults = 2 + plan.supplement;
+	ops.additions = 1 + plan.supplement;
+
+	// reward: feed-in, P2P, penalty; the penalty alone without supplies
+	if (can_supply)
+	{
+		ops.plain_mults += 2 + plan.penalty;
+		ops.additions += 1 + plan.penalty;
+	}
+	else
+		ops.plain_mults += plan.penalty;
+	return ops;
+}
+
+
+// an encrypted plaintext was encoded, then encrypted
+static void count_encoding(BillingOps &ops, const Plaintext &pt)
+{
+	ops.encodings += (nullptr != pt);
+}
+
+static void count_encoding(BillingOps &ops, const Ciphertext<DCRTPoly> &ct)
+{
+	ops.encodings += (nullptr != ct);
+	ops.encryptions += (nullptr != ct);
+}
+
+BillingOps encoding_ops(const RoundPlaintexts &round)
+{
+	BillingOps ops;
+	for (const Plaintext &pt : {round.ones, round.tradingPrice, round.feedInTarif, round.maskTotalDevNegative,
+	                            round.maskTotalDevPositive, round.maskedPenalty})
+		count_encoding(ops, pt);
+	count_encoding(ops, round.rewardPenalty);
+	return ops;
+}
+
+BillingOps encoding_ops(const TariffPlaintexts &tariff)
+{
+	BillingOps ops;
+	count_encoding(ops, tariff.retailPrice);
+	count_encoding(ops, tariff.maskedSupplement);
+	count_encoding(ops, tariff.billSupplement);
+	return ops;
+}
+
+
+static size_t plaintext_bytes_or_0(const Plaintext &pt)
+{
+	return (nullptr != pt) ? plaintext_bytes(pt) : 0;
+}
+
+size_t plaintexts_bytes(const RoundPlaintexts &round, const CryptoContext<DCRTPoly> &cc)
+{
+	size_t bytes = 0;
+	for (const Plaintext &pt : {round.ones, round.tradingPrice, round.feedInTarif, round.maskTotalDevNegative,
+	                            round.maskTotalDevPositive, round.maskedPenalty})
+		bytes += plaintext_bytes_or_0(pt);
+	if (nullptr != round.rewardPenalty)
+		bytes += ciphertext_bytes(round.rewardPenalty, cc);
+	return bytes;
+}
+
+size_t plaintexts_bytes(const TariffPlaintexts &tariff, const CryptoContext<DCRTPoly> &cc)
+{
+	size_t bytes = plaintext_bytes_or_0(tariff.retailPrice) + plaintext_bytes_or_0(tariff.maskedSupplement);
+	if (nullptr != tariff.billSupplement)
+		bytes += ciphertext_bytes(tariff.billSupplement, cc);
+	return bytes;
+}
+
+
+/**
+ * Encodes the plaintexts of server_billing shared by all the clients of a round,
+ * for the branches of plan.
+ */
+RoundPlaintexts encode_round_plaintexts(
+	CryptoContext<DCRTPoly> &cc,
+	const PublicKey<DCRTPoly> &publickey,
+	const std::vector<double> &tradingPrice,
+	const std::vector<double> &feedInTarif,
+	const std::vector<double> &totalP2PProsumers,
+	const std::vector<double> &totalDeviation,
+	const std::vector<double> &maskTotalDevPositive,
+	const std::vector<double> &maskTotalDevNegative,
+	BillingScheme scheme,
+	const BillingPlan &plan
+)
+{
+	RoundPlaintexts round;
+	round.plan = plan;
+	round.feedInTarif = encode_billing(feedInTarif, BFV_DATA_SCALE, cc, scheme);
+	if (!plan.p2p)
+		return round;
+
+	// BFV has no batch size: all the slots of the ring are used
+	unsigned int n_slots = (BILLING_CKKS == scheme) ? cc->GetEncodingParams()->GetBatchSize() : cc->GetRingDimension();
+	round.ones = encode_billing(vector<double>(n_slots, 1.0), 1, cc, scheme);
+	round.tradingPrice = encode_billing(tradingPrice, BFV_DATA_SCALE, cc, scheme);
+	if (plan.supplement)
+		round.maskTotalDevNegative = encode_billing(maskTotalDevNegative, 1, cc, scheme);
+	if (plan.penalty)
+	{
+		round.maskTotalDevPositive = encode_billing(maskTotalDevPositive, 1, cc, scheme);
+
+		// penalty of the prosumers with a positive deviation when TD > 0; see server_billing
+		vector<double> rewardPenalty_pt = ((feedInTarif - tradingPrice) / totalP2PProsumers) * totalDeviation;
+		round.rewardPenalty = encrypt_billing(rewardPenalty_pt, BFV_BILL_SCALE, cc, publickey, scheme);
+	}
+	return round;
+}
+/* 	END definition of function encode_round_plaintexts  */
+
+
+/**
+ * Encodes the plaintexts of server_billing that depend on the retail price, for
+ * the branches of plan.
+ */
+TariffPlaintexts encode_tariff_plaintexts(
+	CryptoContext<DCRTPoly> &cc,
+	const PublicKey<DCRTPoly> &publickey,
+	const std::vector<double> &tradingPrice,
+	const std::vector<double> &retailPrice,
+	const std::vector<double> &totalP2PConsumers,
+	const std::vector<double> &totalDeviation,
+	BillingScheme scheme,
+	const BillingPlan &plan
+)
+{
+	TariffPlaintexts tariff;
+	tariff.retailPrice = encode_billing(retailPrice, BFV_DATA_SCALE, cc, scheme);
+	if (plan.supplement)
+	{
+		// supplement of the consumers with a positive deviation when TD < 0; see server_billing
+		vector<double> billSupplement_pt = ((retailPrice - tradingPrice) / totalP2PConsumers) * totalDeviation;
+		tariff.billSupplement = encrypt_billing(billSupplement_pt, BFV_BILL_SCALE, cc, publickey, scheme);
+	}
+	return tariff;
+}
+/* 	END definition of function encode_tariff_plaintexts  */
+
+
+// (difference / total) * totalDeviation in the slots of mask, 0 elsewhere
+static vector<double> masked_share(
+	const std::vector<double> &difference,
+	const std::vector<double> &total,
+	const std::vector<double> &totalDeviation,
+	const std::vector<double> &mask
+)
+{
+	vector<double> share(difference.size(), 0.0);
+	for (unsigned int i = 0; i < share.size(); i++)
+		if (0 != mask[i])
+			share[i] = difference[i] / total[i] * totalDeviation[i];
+	return share;
+}
+
+
+/**
+ * Encodes the plaintexts of server_billing of premultiplied uploads shared by
+ * all the clients of a round, for the branches of plan.
+ */
+RoundPlaintexts encode_premultiplied_round_plaintexts(
+	CryptoContext<DCRTPoly> &cc,
+	const std::vector<double> &tradingPrice,
+	const std::vector<double> &feedInTarif,
+	const std::vector<double> &totalP2PProsumers,
+	const std::vector<double> &totalDeviation,
+	const std::vector<double> &maskTotalDevPositive,
+	BillingScheme scheme,
+	const BillingPlan &plan
+)
+{
+	RoundPlaintexts round;
+	round.plan = plan;
+	round.feedInTarif = encode_billing(feedInTarif, BFV_DATA_SCALE, cc, scheme);
+	if (!plan.p2p)
+		return round;
+
+	round.tradingPrice = encode_billing(tradingPrice, BFV_DATA_SCALE, cc, scheme);
+	if (plan.penalty)
+		round.maskedPenalty = encode_billing(masked_share(feedInTarif - tradingPrice, totalP2PProsumers, totalDeviation, maskTotalDevPositive),
+		                                     BFV_BILL_SCALE, cc, scheme);
+	return round;
+}
+/* 	END definition of function encode_premultiplied_round_plaintexts  */
+
+
+/**
+ * Encodes the plaintexts of server_billing of premultiplied uploads that depend
+ * on the retail price, for the branches of plan.
+ */
+TariffPlaintexts encode_premultiplied_tariff_plaintexts(
+	CryptoContext<DCRTPoly> &cc,
+	const std::vector<double> &tradingPrice,
+	const std::vector<double> &retailPrice,
+	const std::vector<double> &totalP2PConsumers,
+	const std::vector<double> &totalDeviation,
+	const std::vector<double> &maskTotalDevNegative,
+	BillingScheme scheme,
+	const BillingPlan &plan
+)
+{
+	TariffPlaintexts tariff;
+	tariff.retailPrice = encode_billing(retailPrice, BFV_DATA_SCALE, cc, scheme);
+	if (plan.supplement)
+		tariff.maskedSupplement = encode_billing(masked_share(retailPrice - tradingPrice, totalP2PConsumers, totalDeviation, maskTotalDevNegative),
+		                                         BFV_BILL_SCALE, cc, scheme);
+	return tariff;
+}
+/* 	END definition of function encode_premultiplied_tariff_plaintexts  */
+
+
+uint64_t tariff_fingerprint(const std::vector<double> &retailPrice)
+{
+	// FNV-1a over the bytes of the entries
+	uint64_t h = 14695981039346656037ull;
+	for (double price : retailPrice)
+	{
+		uint64_t bits;
+		memcpy(&bits, &price, sizeof(bits));
+		for (int b = 0; b < 8; b++)
+		{
+			h ^= (bits >> (8 * b)) & 0xff;
+			h *= 1099511628211ull;
+		}
+	}
+	return h;
+}
+
+
+std::vector<TariffGroup> group_by_tariff(const std::vector<std::vector<double>> &retailPrices)
+{
+	std::vector<TariffGroup> groups;
+	std::unordered_map<uint64_t, std::vector<int>> groups_of_fingerprint;
+	for (unsigned int client = 0; client < retailPrices.size(); client++)
+	{
+		std::vector<int>& candidates = groups_of_fingerprint[tariff_fingerprint(retailPrices[client])];
+		bool grouped = false;
+		for (int g : candidates)
+		{
+			if (groups[g].retailPrice == retailPrices[client])
+			{
+				groups[g].clients.push_back(client);
+				grouped = true;
+				break;
+			}
+		}
+		if (!grouped)
+		{
+			candidates.push_back(groups.size());
+			groups.push_back({retailPrices[client], {(int) client}});
+		}
+	}
+	return groups;
+}
+
+
+/**
+ * 	Definition of function server_billing:
+ *
+ *  Receives
+ *  * Cryptographic properties, i.e.,
+ *	  - the cryptographic context,
+ *	  - the public key.
+ *
+ *  * Context information (for all timeslots)
+ *    - trading prices, 
+ *    - retail prices,
+ *    - feed-in tarifs,
+ *    - number of P2P-consumers,
+ *    - number of P2P-prosumers.
+ * 
+ *  * Deviation information (for all timeslots)
+ *    - total deviation,
+ *    - bits masking timeslots with positive deviation,
+ *    - ... with zero deviation,
+ *    - ... with negative deviation.
+ * 
+ *  * Encrypted client information (for all timeslots)
+ * 	  - consumption,
+ *    - supplies,
+ *    - deviations,
+ *    - masks indicating timeslots in which they had a non-negative deviation,
+ *    - masks indicating timeslots they were accepted for p2p trading.
+ *
+ *	Returns two ciphertexts encrypting the bill and the reward, respectively, 
+ *  for this client, for each time slot.
+ * 
+ *	All ciphertexts are encrypted under the client's key
+ */
+std::tuple<Ciphertext<DCRTPoly>,
+		   Ciphertext<DCRTPoly>>
+server_billing(
+	// Cryptographic properties/values
+	CryptoContext<DCRTPoly> &cc,
+	PublicKey<DCRTPoly> publickey,
+
+	// Context information
+	std::vector<double> tradingPrice,
+	std::vector<double> retailPrice,
+	std::vector<double> feedInTarif,
+	std::vector<double> totalP2PConsumers,
+	std::vector<double> totalP2PProsumers,
+
+	// Deviation information
+	std::vector<double> totalDeviation,
+	std::vector<double>	maskTotalDevPositive,
+	std::vector<double>	maskTotalDevZero,
+	std::vector<double>	maskTotalDevNegative,
+
+	// Encrypted client information
+	Ciphertext<DCRTPoly> consumption,
+	Ciphertext<DCRTPoly> supplies,
+	Ciphertext<DCRTPoly> deviations,
+	Ciphertext<DCRTPoly> negDevSigns,
+	Ciphertext<DCRTPoly> accepted,
+	BillingScheme scheme,
+	BillingOps *ops,
+	BillingRelinearization relinearization
+)
+{
+	// the branches that are zero for the whole round are pruned
+	BillingPlan plan = plan_billing(totalP2PConsumers, totalP2PProsumers, maskTotalDevPositive, maskTotalDevNegative);
+	RoundPlaintexts round = encode_round_plaintexts(cc, publickey, tradingPrice, feedInTarif, totalP2PProsumers,
+	                                                totalDeviation, maskTotalDevPositive, maskTotalDevNegative, scheme, plan);
+	TariffPlaintexts tariff = encode_tariff_plaintexts(cc, publickey, tradingPrice, retailPrice, totalP2PConsumers, totalDeviation, scheme, plan);
+	if (ops)
+	{
+		*ops += encoding_ops(round);
+		*ops += encoding_ops(tariff);
+	}
+
+	return server_billing(cc, round, tariff, std::move(consumption), std::move(supplies), std::move(deviations),
+	                      std::move(negDevSigns), std::move(accepted), ops, relinearization);
+}
+
+
+/**
+ *  The homomorphic operations of server_billing, added to ops (if it is not
+ *  null) as they are evaluated, so that the counts are those of the circuit
+ *  that ran. With RELINEARIZE_PRODUCTS, mult relinearises every product and
+ *  relinearize_output has nothing left to do. Every ciphertext made is kept
+ *  track of until it is freed, and ops->peak_bytes is the most bytes of them
+ *  alive when one is made.
+ */
+struct CountingEvaluator
+{
+	CryptoContext<DCRTPoly> &cc;
+	BillingOps *ops;
+	BillingRelinearization relinearization;
+	std::vector<std::weak_ptr<CiphertextImpl<DCRTPoly>>> made = {};
+
+	Ciphertext<DCRTPoly> measured(Ciphertext<DCRTPoly> ct)
+	{
+		if (!ops)
+			return ct;
+		made.push_back(ct);
+		size_t live_bytes = 0;
+		for (const auto &weak : made)
+			if (Ciphertext<DCRTPoly> alive = weak.lock())
+				live_bytes += ciphertext_bytes(alive, cc);
+		ops->peak_bytes = std::max(ops->peak_bytes, live_bytes);
+		return ct;
+	}
+
+	Ciphertext<DCRTPoly> plain_mult(ConstCiphertext<DCRTPoly> x, const Plaintext &y)
+	{
+		if (ops) ops->plain_mults++;
+		return measured(cc->EvalMult(x, y));
+	}
+
+	Ciphertext<DCRTPoly> mult(ConstCiphertext<DCRTPoly> x, ConstCiphertext<DCRTPoly> y)
+	{
+		if (ops) ops->mults++;
+		Ciphertext<DCRTPoly> product = measured(cc->EvalMultNoRelin(x, y));
+		if (RELINEARIZE_PRODUCTS == relinearization)
+			relinearize(product);
+		return product;
+	}
+
+	Ciphertext<DCRTPoly> sub(const Plaintext &x, ConstCiphertext<DCRTPoly> y)
+	{
+		if (ops) ops->additions++;
+		return measured(cc->EvalSub(x, y));
+	}
+
+	void add(Ciphertext<DCRTPoly> &x, ConstCiphertext<DCRTPoly> y)
+	{
+		if (ops) ops->additions++;
+		cc->EvalAddInPlace(x, y);
+	}
+
+	void relinearize(Ciphertext<DCRTPoly> &x)
+	{
+		if (ops) ops->relinearizations++;
+		cc->RelinearizeInPlace(x);
+	}
+
+	void relinearize_output(Ciphertext<DCRTPoly> &x)
+	{
+		if (RELINEARIZE_OUTPUTS == relinearization)
+			relinearize(x);
+	}
+};
+
+
+/**
+ *	server_billing, with the plaintexts encoded by encode_round_plaintexts and
+ *	encode_tariff_plaintexts. Does not encode anything, so the plaintexts can be
+ *	shared by all the clients of a round, or of a tariff group.
+ */
+std::tuple<Ciphertext<DCRTPoly>,
+		   Ciphertext<DCRTPoly>>
+server_billing(
+	CryptoContext<DCRTPoly> &cc,
+	const RoundPlaintexts &round,
+	const TariffPlaintexts &tariff,
+
+	// Encrypted client information
+	Ciphertext<DCRTPoly> consumption,
+	Ciphertext<DCRTPoly> supplies,
+	Ciphertext<DCRTPoly> deviations,
+	Ciphertext<DCRTPoly> negDevSigns,
+	Ciphertext<DCRTPoly> accepted,
+	BillingOps *ops,
+	BillingRelinearization relinearization
+)
+{
+	// The bill is completed before the reward is started, and every ciphertext is
+	// released after its last use (the uploads too, if the caller moved them in),
+	// so that few ciphertexts are alive at once; ops->peak_bytes measures them.
+	// Only the branches of round.plan are evaluated; see client_billing_ops.
+	const BillingPlan &plan = round.plan;
+	bool can_supply = (nullptr != supplies);
+	deviations.reset(); // only used by the aggregation of the total deviation
+	CountingEvaluator eval = {cc, ops, relinearization};
+
+	// CASE: No client accepted for P2P trading in this round -> everyone pays/gets retail price
+	if (!plan.p2p)
+	{
+		Ciphertext<DCRTPoly> bill_ct = eval.plain_mult(consumption, tariff.retailPrice);
+		Ciphertext<DCRTPoly> reward_ct = can_supply ? eval.plain_mult(supplies, round.feedInTarif) : nullptr;
+		return {bill_ct, reward_ct};
+	}
+	if (plan.supplement && nullptr == tariff.billSupplement)
+		throw std::logic_error("the tariff plaintexts were encoded without the supplement of the round plan");
+
+	// Create rejected; a dual to the accepted mask
+	Ciphertext<DCRTPoly> rejected = eval.sub(round.ones, accepted);
+
+	// Every output is a sum of ciphertext * ciphertext products, which, with
+	// RELINEARIZE_OUTPUTS, are left unrelinearised (3 elements) and added, so that
+	// each output is relinearised once. The products of an output are at the same level and scale:
+	// (ciphertext * plaintext) * mask, with mask one of rejected, accepted and
+	// nonNegAccepted = nonNegDevSigns * accepted, so the additions do not adjust
+	// them, and each output is rescaled once, by the multiplication or the
+	// decryption that follows it.
+	Ciphertext<DCRTPoly> nonNegAccepted;
+	if (plan.supplement || plan.penalty)
+	{
+		nonNegAccepted = eval.mult(eval.sub(round.ones, negDevSigns), accepted);
+		eval.relinearize_output(nonNegAccepted);
+	}
+	negDevSigns.reset();
+
+	// BILL
+	// CASE: User not accepted for P2P trading -> they pay retail price
+	Ciphertext<DCRTPoly> bill_ct = eval.mult(eval.plain_mult(consumption, tariff.retailPrice), rejected);
+
+	// CASE: User was accepted for P2P trading
+	eval.add(bill_ct, eval.mult(eval.plain_mult(consumption, round.tradingPrice), accepted)); // baseBill
+	consumption.reset();
+
+	// CASE: TD == 0
+	    // consumer <- baseBill
+
+	// CASE: TD < 0
+		// demand > supply
+
+		// CASE: indiv dev <= 0
+			// consumer <- baseBill
+		
+		// CASE: indiv dev > 0
+			// consumer gets a billSupplement; buy their portion of what was used too much against retail price.
+			// bill = (consumption - TD / nr_p2p_consumers) * tradingPrice + TD / nr_p2p_consumers * retailPrice
+			//      = consumption * tradingPrice + TD / nr_p2p_consumers * (retailPrice - tradingPrice)
+			//      = baseBill + TD / nr_p2p_consumers * (retail_price - trading price)
+			// hence,
+			// supplement = TD / nr_p2p_consumers * (retail_price - trading price)
+
+			// (encoded and encrypted by encode_tariff_plaintexts; pruned if TD >= 0 in all the time slots)
+			if (plan.supplement)
+				eval.add(bill_ct, eval.mult(eval.plain_mult(tariff.billSupplement, round.maskTotalDevNegative), nonNegAccepted));
+
+	// CASE: TD > 0
+		// demand < supply
+		// consumers <- baseBill
+
+	// Aggregating P2P and no-P2P cases
+	eval.relinearize_output(bill_ct);
+
+	// REWARD
+	// CASE: User cannot supply energy -> the supply terms are 0, only the penalty is left
+	if (!can_supply && !plan.penalty)
+		return {bill_ct, nullptr};
+	Ciphertext<DCRTPoly> reward_ct;
+	if (can_supply)
+	{
+		// CASE: User not accepted for P2P trading -> they get the feed-in tarif
+		reward_ct = eval.mult(eval.plain_mult(supplies, round.feedInTarif), rejected);
+
+		// CASE: User was accepted for P2P trading
+		eval.add(reward_ct, eval.mult(eval.plain_mult(supplies, round.tradingPrice), accepted)); // baseReward
+	}
+	rejected.reset();
+	supplies.reset();
+
+	// CASE: TD == 0
+		// prosumer <- baseReward
+
+	// CASE: TD < 0
+		// demand > supply
+		// prosumer <- baseReward
+
+	// CASE: TD > 0
+		// demand < supply
+
+		// CASE: indiv dev <= 0
+			// prosumers <- baseReward
+
+		// CASE: indiv dev > 0
+			// prosumers get a penalty; they sell their portion of what was produced too much against feedin tarif
+			// reward = (supply - TD / nr_p2p_prosumers) * tradingPrice + TD / nr_p2p_prosumers * feedInTarif
+			//        = supply * tradingPrice + (TD / nr_p2p_prosumers * (feedInTarif - tradingPrice)
+			//        = baseReward + (TD / nr_p2p_prosumers * (feedInTarif - tradingPrice)
+			// hence,
+			// penalty = (TD / nr_p2p_prosumers * (feedInTarif - tradingPrice)
+			//
+			// Note that the penalty is negative, since feedInTarif is assumed to be < tradingPrice
+			// (encoded and encrypted by encode_round_plaintexts; pruned if TD <= 0 in all the time slots)
+			if (plan.penalty)
+			{
+				Ciphertext<DCRTPoly> penalty_ct = eval.mult(eval.plain_mult(round.rewardPenalty, round.maskTotalDevPositive), nonNegAccepted);
+				if (nullptr == reward_ct)
+					reward_ct = penalty_ct;
+				else
+					eval.add(reward_ct, penalty_ct);
+			}
+
+	// Aggregating P2P and no-P2P cases
+	eval.relinearize_output(reward_ct);
+
+	return {bill_ct, reward_ct};
+}
+
+
+/**
+ *	server_billing of premultiplied uploads: the bill is
+ *	consumptionRejected * retailPrice + consumptionAccepted * tradingPrice
+ *	+ nonNegAccepted * maskedSupplement, and the reward mirrors it with the
+ *	feed-in tarif and the penalty; see server_billing above for the cases.
+ */
+std::tuple<Ciphertext<DCRTPoly>,
+		   Ciphertext<DCRTPoly>>
+server_billing(
+	CryptoContext<DCRTPoly> &cc,
+	const RoundPlaintexts &round,
+	const TariffPlaintexts &tariff,
+	const PremultipliedUploads &uploads,
+	BillingOps *ops
+)
+{
+	const BillingPlan &plan = round.plan;
+	bool can_supply = (nullptr != uploads.suppliesRejected);
+	CountingEvaluator eval = {cc, ops, RELINEARIZE_OUTPUTS};
+
+	// CASE: No client accepted for P2P trading in this round -> everyone pays/gets retail price
+	Ciphertext<DCRTPoly> bill_ct = eval.plain_mult(uploads.consumptionRejected, tariff.retailPrice);
+	Ciphertext<DCRTPoly> reward_ct = can_supply ? eval.plain_mult(uploads.suppliesRejected, round.feedInTarif) : nullptr;
+	if (!plan.p2p)
+		return {bill_ct, reward_ct};
+	if (plan.supplement && nullptr == tariff.maskedSupplement)
+		throw std::logic_error("the tariff plaintexts were not encoded for premultiplied uploads");
+	if (plan.penalty && nullptr == round.maskedPenalty)
+		throw std::logic_error("the round plaintexts were not encoded for premultiplied uploads");
+
+	// BILL
+	eval.add(bill_ct, eval.plain_mult(uploads.consumptionAccepted, round.tradingPrice)); // baseBill
+	if (plan.supplement)
+		eval.add(bill_ct, eval.plain_mult(uploads.nonNegAccepted, tariff.maskedSupplement));
+
+	// REWARD; without supplies, only the penalty is left
+	if (can_supply)
+		eval.add(reward_ct, eval.plain_mult(uploads.suppliesAccepted, round.tradingPrice)); // baseReward
+	if (plan.penalty)
+	{
+		Ciphertext<DCRTPoly> penalty_ct = eval.plain_mult(uploads.nonNegAccepted, round.maskedPenalty);
+		if (nullptr == reward_ct)
+			reward_ct = penalty_ct;
+		else
+			eval.add(reward_ct, penalty_ct);
+	}
+
+	return {bill_ct, reward_ct};
+}
+
+
+int streaming_group_size(const CryptoContext<DCRTPoly> &cc, BillingScheme scheme)
+{
+	// BFV rotations are within the rows of N / 2 slots
+	int n_slots = (BILLING_CKKS == scheme) ? cc->GetEncodingParams()->GetBatchSize() : cc->GetRingDimension() / 2;
+	return n_slots / TIMESLOTS;
+}
+
+
+std::vector<int32_t> streaming_rotation_indices(int group_size)
+{
+	// the fields are rotated to the left into the first block, and the running bill to the right by one block
+	return {FIELD_SUPPLY * group_size, FIELD_SIGN * group_size, FIELD_ACCEPTED * group_size, -group_size};
+}
+
+
+Ciphertext<DCRTPoly> client_setup_timeslot(
+	CryptoContext<DCRTPoly> &cc,
+	const PublicKey<DCRTPoly> &ckks_pk,
+	int position,
+	int group_size,
+	double consumption,
+	double supply,
+	double deviation,
+	double accepted,
+	BillingScheme scheme
+)
+{
+	if (position < 0 || position >= group_size)
+		throw std::out_of_range("position " + std::to_string(position) + " out of a group of " + std::to_string(group_size));
+
+	// in BFV, the readings are scaled as in client_setup, the sign and the acceptance are not
+	double data_scale = (BILLING_BFV == scheme) ? BFV_DATA_SCALE : 1;
+	vector<double> fields(TIMESLOT_FIELDS * group_size, 0.0);
+	fields[FIELD_CONSUMPTION * group_size + position] = consumption * data_scale;
+	fields[FIELD_SUPPLY * group_size + position] = supply * data_scale;
+	fields[FIELD_DEVIATION * group_size + position] = deviation * data_scale;
+	fields[FIELD_SIGN * group_size + position] = (deviation <= 0) ? 1 : 0; // see deviation_signs
+	fields[FIELD_ACCEPTED * group_size + position] = accepted;
+	return encrypt_billing(fields, 1, cc, ckks_pk, scheme);
+}
+/* 	END definition of function client_setup_timeslot  */
+
+
+// a time slot has either a supplement or a penalty, depending on the sign of its total deviation
+static BillingPlan timeslot_plan(double totalDeviation)
+{
+	BillingPlan plan;
+	plan.supplement = totalDeviation < 0;
+	plan.penalty = totalDeviation > 0;
+	return plan;
+}
+
+RoundPlaintexts encode_timeslot_plaintexts(
+	CryptoContext<DCRTPoly> &cc,
+	const PublicKey<DCRTPoly> &publickey,
+	int group_size,
+	double tradingPrice,
+	double feedInTarif,
+	double totalP2PProsumers,
+	double totalDeviation,
+	BillingScheme scheme
+)
+{
+	// the prices are 0 outside of the first block, which clears the other fields of the uploads
+	vector<double> totalDeviation_v(group_size, totalDeviation);
+	auto [maskTotalDevPositive, maskTotalDevZero, maskTotalDevNegative] = server_setup(totalDeviation_v);
+	return encode_round_plaintexts(cc, publickey, vector<double>(group_size, tradingPrice), vector<double>(group_size, feedInTarif),
+	                               vector<double>(group_size, totalP2PProsumers), totalDeviation_v,
+	                               maskTotalDevPositive, maskTotalDevNegative, scheme, timeslot_plan(totalDeviation));
+}
+/* 	END definition of function encode_timeslot_plaintexts  */
+
+
+TariffPlaintexts encode_timeslot_tariff_plaintexts(
+	CryptoContext<DCRTPoly> &cc,
+	const PublicKey<DCRTPoly> &publickey,
+	double tradingPrice,
+	const std::vector<double> &retailPrices,
+	double totalP2PConsumers,
+	double totalDeviation,
+	BillingScheme scheme
+)
+{
+	size_t n_members = retailPrices.size();
+	return encode_tariff_plaintexts(cc, publickey, vector<double>(n_members, tradingPrice), retailPrices,
+	                                vector<double>(n_members, totalP2PConsumers), vector<double>(n_members, totalDeviation),
+	                                scheme, timeslot_plan(totalDeviation));
+}
+/* 	END definition of function encode_timeslot_tariff_plaintexts  */
+
+
+void fold_timeslot(
+	CryptoContext<DCRTPoly> &cc,
+	RunningBill &running,
+	int group_size,
+	const RoundPlaintexts &round,
+	const TariffPlaintexts &tariff,
+	const std::vector<Ciphertext<DCRTPoly>> &uploads
+)
+{
+	if (uploads.empty() || (int) uploads.size() > group_size)
+		throw std::invalid_argument(std::to_string(uploads.size()) + " uploads for a group of " + std::to_string(group_size));
+
+	// the clients of the group are in different slots, so their uploads add up into one ciphertext
+	Ciphertext<DCRTPoly> fields = uploads[0]->Clone();
+	for (size_t i = 1; i < uploads.size(); i++)
+		cc->EvalAddInPlace(fields, uploads[i]);
+
+	// Every field is rotated into the first block. The other slots hold the other
+	// fields, but every product of server_billing has a factor that is 0 there.
+	auto field = [&](TimeslotField f) { return cc->EvalRotate(fields, f * group_size); };
+	auto [bill, reward] = server_billing(cc, round, tariff, fields, field(FIELD_SUPPLY), nullptr, field(FIELD_SIGN), field(FIELD_ACCEPTED));
+
+	// the time slots billed before move up one block
+	if (0 == running.n_timeslots)
+	{
+		running.bill = bill;
+		running.reward = reward;
+	}
+	else
+	{
+		running.bill = cc->EvalRotate(running.bill, -group_size);
+		cc->EvalAddInPlace(running.bill, bill);
+		running.reward = cc->EvalRotate(running.reward, -group_size);
+		cc->EvalAddInPlace(running.reward, reward);
+	}
+	running.n_timeslots++;
+}
+/* 	END definition of function fold_timeslot  */
+
+
+std::tuple<Ciphertext<DCRTPoly>,
+		   Ciphertext<DCRTPoly>>
+finalise_bill(const RunningBill &running)
+{
+	if (running.n_timeslots != TIMESLOTS)
+		throw std::logic_error(std::to_string(running.n_timeslots) + " of the " + std::to_string(TIMESLOTS) + " time slots were billed");
+	return {running.bill, running.reward};
+}
+/* 	END definition of function finalise_bill  */
+
+
+std::vector<std::vector<double>> decrypt_group_billing(
+	CryptoContext<DCRTPoly> &cc,
+	const PrivateKey<DCRTPoly> &sk,
+	const Ciphertext<DCRTPoly> &ctxt,
+	int group_size,
+	int n_members,
+	BillingScheme scheme
+)
+{
+	vector<double> values = decrypt_billing(cc, sk, ctxt, scheme, BFV_BILL_SCALE, TIMESLOTS * group_size);
+
+	// the last time slot folded is in the first block
+	vector<vector<double>> billing(n_members, vector<double>(TIMESLOTS));
+	for (int p = 0; p < n_members; p++)
+		for (int t = 0; t < TIMESLOTS; t++)
+			billing[p][t] = values[(TIMESLOTS - 1 - t) * group_size + p];
+	return billing;
+}
+/* 	END definition of function decrypt_group_billing  */
+
+
+BillAccumulator::BillAccumulator(const CryptoContext<DCRTPoly>& cc, int days_per_ciphertext, BillingScheme scheme)
+	: cc(cc), scheme(scheme), days_per_ciphertext(days_per_ciphertext)
+{
+	// BFV rotations are within the rows of N / 2 slots
+	int n_slots = (BILLING_CKKS == scheme) ? cc->GetEncodingParams()->GetBatchSize() : cc->GetRingDimension() / 2;
+	if (days_per_ciphertext < 1 || days_per_ciphertext * TIMESLOTS > n_slots)
+		throw std::invalid_argument("cannot pack " + std::to_string(days_per_ciphertext) + " days in " + std::to_string(n_slots) + " slots");
+}
+
+std::vector<int32_t> BillAccumulator::rotation_indices(int days_per_ciphertext)
+{
+	// negative indices rotate to the right
+	std::vector<int32_t> indices;
+	for (int block = 1; block < days_per_ciphertext; block++)
+		indices.push_back(-block * TIMESLOTS);
+	return indices;
+}
+
+// ctxt rotated into the given block of days
+static Ciphertext<DCRTPoly> in_block(const CryptoContext<DCRTPoly>& cc, const Ciphertext<DCRTPoly>& ctxt, int block)
+{
+	// the slots of a day after TIMESLOTS are 0, so the rotation only moves the day into its block
+	return (0 == block) ? ctxt : cc->EvalRotate(ctxt, -block * TIMESLOTS);
+}
+
+// whether x and y are at the same level and scale
+static bool same_level_and_scale(const Ciphertext<DCRTPoly>& x, const Ciphertext<DCRTPoly>& y)
+{
+	return x->GetLevel() == y->GetLevel() && x->GetNoiseScaleDeg() == y->GetNoiseScaleDeg();
+}
+
+void BillAccumulator::add_day(const Ciphertext<DCRTPoly>& bill_ct, const Ciphertext<DCRTPoly>& reward_ct)
+{
+	if (n_days > 0 && (!same_level_and_scale(bill_ct, bill) || (nullptr != reward_ct && nullptr != reward && !same_level_and_scale(reward_ct, reward))))
+		throw std::invalid_argument("day " + std::to_string(n_days) + " is not at the level and scale of the previous days");
+
+	// the accumulators are added into in place, and must not share the ciphertexts of the caller
+	int block = n_days % days_per_ciphertext;
+	Ciphertext<DCRTPoly> day_bill = in_block(cc, bill_ct, block);
+	if (0 == n_days)
+		bill = day_bill->Clone();
+	else
+		cc->EvalAddInPlace(bill, day_bill);
+
+	// a null reward (no supplies and no penalty) adds nothing, and the reward
+	// stays null until a day has one
+	if (nullptr != reward_ct)
+	{
+		Ciphertext<DCRTPoly> day_reward = in_block(cc, reward_ct, block);
+		if (nullptr == reward)
+			reward = day_reward->Clone();
+		else
+			cc->EvalAddInPlace(reward, day_reward);
+	}
+	n_days++;
+}
+
+size_t BillAccumulator::memory_bytes() const
+{
+	if (0 == n_days)
+		return 0;
+	return ciphertext_bytes(bill, cc) + ((nullptr != reward) ? ciphertext_bytes(reward, cc) : 0);
+}
+
+std::tuple<Ciphertext<DCRTPoly>,
+		   Ciphertext<DCRTPoly>>
+BillAccumulator::close() const
+{
+	if (0 == n_days)
+		throw std::logic_error("no day was added to the billing period");
+	return {bill, reward};
+}
+
+std::vector<std::vector<double>> BillAccumulator::decrypt(const PrivateKey<DCRTPoly>& sk, const Ciphertext<DCRTPoly>& ctxt)
+{
+	int n_blocks = std::min(n_days, days_per_ciphertext);
+	std::vector<double> values = decrypt_billing(cc, sk, ctxt, scheme, BFV_BILL_SCALE, n_blocks * TIMESLOTS);
+	std::vector<std::vector<double>> blocks(n_blocks);
+	for (int block = 0; block < n_blocks; block++)
+		blocks[block].assign(values.begin() + block * TIMESLOTS, values.begin() + (block + 1) * TIMESLOTS);
+	return blocks;
+}
@@ -0,0 +1,699 @@
+/**
+ *  Billing of the P2P energy trading: loading of the context and client data,
+ *  client-side encryption and server-side computation of the encrypted bills
+ *  and rewards under CKKS.
+ */
+
+#ifndef __BILLING
+#define __BILLING
+
+#include <vector>
+#include <tuple>
+#include <string>
+#include <cstdint>
+
+#include "utils_ckks.h"
+#include "utils_bfv.h"
+#include "seeded_ckks.h"
+
+// Experiment settings
+static const int DAYS = 1;
+static const int TIMESLOTS_PER_DAY = 24;
+static const int TIMESLOTS = DAYS * TIMESLOTS_PER_DAY;
+static const int NR_CLIENTS = 150;
+static const int N_TIME_SLOTS = 1024; // should be a power of two, greater than TIMESLOTS
+static const std::string DATA_DIR = "../../../energy-billing-data-generation/data";
+
+
+/**
+ *  Scheme used by client_setup and server_billing, selected at runtime.
+ *  - BILLING_CKKS: approximate arithmetic on the real values.
+ *  - BILLING_BFV: exact arithmetic on fixed-point integers. The data has
+ *    4 decimals (see parseToDoubles), so energies and prices are scaled by
+ *    BFV_DATA_SCALE, and bills, rewards and the plaintexts added to them by
+ *    BFV_BILL_SCALE. The plaintext modulus is sized for the largest bill.
+ */
+enum BillingScheme { BILLING_CKKS, BILLING_BFV };
+
+static const double BFV_DATA_SCALE = 1e4;
+static const double BFV_BILL_SCALE = BFV_DATA_SCALE * BFV_DATA_SCALE;
+static const double MAX_ENERGY_PER_TIMESLOT = 100.0; // kWh
+static const double MAX_PRICE = 10.0; // per kWh
+static const int BFV_BILLING_DEPTH = 2; // signs * accepted, then * supplement
+
+const char* billing_scheme_name(BillingScheme scheme);
+
+// "ckks" or "bfv"; throws std::invalid_argument otherwise
+BillingScheme parse_billing_scheme(const std::string& name);
+
+/** Crypto context of the scheme, with the features used by the billing */
+CryptoContext<DCRTPoly> billing_crypto_context(BillingScheme scheme);
+
+/** Encrypts msg with the encoding of the scheme; in BFV, msg is scaled by bfv_scale */
+Ciphertext<DCRTPoly> encrypt_billing(
+	const std::vector<double> &msg,
+	double bfv_scale,
+	CryptoContext<DCRTPoly> &cc,
+	const PublicKey<DCRTPoly> &pk,
+	BillingScheme scheme = BILLING_CKKS
+);
+
+/**
+ *  Bills or rewards of the first n_values slots of ctxt, in money units. Other
+ *  values encrypted in BFV are decrypted with their own scale, e.g. BFV_DATA_SCALE.
+ *  A null ctxt, e.g. a pruned reward, is decrypted as 0.
+ */
+std::vector<double> decrypt_billing(
+	CryptoContext<DCRTPoly> &cc,
+	const PrivateKey<DCRTPoly> &sk,
+	const Ciphertext<DCRTPoly> &ctxt,
+	BillingScheme scheme = BILLING_CKKS,
+	double bfv_scale = BFV_BILL_SCALE,
+	int n_values = TIMESLOTS
+);
+
+
+std::tuple<std::vector<double>,
+ 		   std::vector<double>,
+		   std::vector<double>,
+		   std::vector<double>,
+		   std::vector<double>>
+context_setup();
+
+// <DATA_DIR>/<TIMESLOTS>_ts_<NR_CLIENTS>_clients, with context.csv and the user_<id>.csv
+std::string data_directory();
+
+/** context_setup and load_client_data of a given file, e.g., one that just arrived */
+std::tuple<std::vector<double>,
+ 		   std::vector<double>,
+		   std::vector<double>,
+		   std::vector<double>,
+		   std::vector<double>>
+load_context_file(const std::string &fname);
+
+std::tuple<
+	std::vector<double>,
+	std::vector<double>,
+	std::vector<double>,
+	std::vector<double>,
+	std::vector<double>,
+	std::vector<double>,
+	std::vector<double>,
+	std::vector<double>,
+	std::vector<double>
+>
+load_client_data(int clientID);
+
+std::tuple<
+	std::vector<double>,
+	std::vector<double>,
+	std::vector<double>,
+	std::vector<double>,
+	std::vector<double>,
+	std::vector<double>,
+	std::vector<double>,
+	std::vector<double>,
+	std::vector<double>
+>
+load_client_file(const std::string &fname);
+
+std::tuple<
+	Ciphertext<DCRTPoly>,
+	Ciphertext<DCRTPoly>,
+	Ciphertext<DCRTPoly>,
+	Ciphertext<DCRTPoly>,
+	Ciphertext<DCRTPoly>
+>
+client_setup(
+	CryptoContext<DCRTPoly> &cc, 
+	const PublicKey<DCRTPoly> &ckks_pk,
+	std::vector<double> consumptions,
+	std::vector<double> supplies,
+	std::vector<double> deviations,
+	std::vector<double> accepted,
+	BillingScheme scheme = BILLING_CKKS,
+	bool can_supply = true
+);
+
+// number of encryptions made by client_setup; one less if the client cannot
+// supply energy (can_supply = false), since its supplies are then not encrypted
+static const int CLIENT_ENCRYPTIONS = 5;
+
+/** client_setup with the encryptions of zero of pool, filled offline */
+std::tuple<
+	Ciphertext<DCRTPoly>,
+	Ciphertext<DCRTPoly>,
+	Ciphertext<DCRTPoly>,
+	Ciphertext<DCRTPoly>,
+	Ciphertext<DCRTPoly>
+>
+client_setup(
+	ZeroEncryptionPool &pool,
+	std::vector<double> consumptions,
+	std::vector<double> supplies,
+	std::vector<double> deviations,
+	std::vector<double> accepted
+);
+
+/**
+ *  client_setup in secret-key upload mode: the data is encrypted under ckks_sk,
+ *  with the random part of each ciphertext expanded from a seed, so each upload
+ *  is about half of a public-key ciphertext. The server recovers the ciphertexts
+ *  of client_setup with expand_ciphertext.
+ */
+std::tuple<
+	SeededCiphertext,
+	SeededCiphertext,
+	SeededCiphertext,
+	SeededCiphertext,
+	SeededCiphertext
+>
+client_setup_seeded(
+	CryptoContext<DCRTPoly> &cc,
+	const PrivateKey<DCRTPoly> &ckks_sk,
+	std::vector<double> consumptions,
+	std::vector<double> supplies,
+	std::vector<double> deviations,
+	std::vector<double> accepted
+);
+
+/**
+ *  Uploads of client_setup_premultiplied. The client knows its data in the
+ *  clear, so it multiplies the terms of the billing formula by the masks
+ *  itself, and server_billing is left with plaintext products and additions.
+ */
+struct PremultipliedUploads
+{
+	Ciphertext<DCRTPoly> consumptionAccepted; // consumption * accepted
+	Ciphertext<DCRTPoly> consumptionRejected; // consumption * (1 - accepted)
+	Ciphertext<DCRTPoly> suppliesAccepted;    // null if the client cannot supply energy
+	Ciphertext<DCRTPoly> suppliesRejected;
+	Ciphertext<DCRTPoly> nonNegAccepted;      // (deviation > 0) * accepted
+	Ciphertext<DCRTPoly> deviations;          // for the aggregation of the total deviation
+};
+
+// number of encryptions made by client_setup_premultiplied; two less if the
+// client cannot supply energy
+static const int PREMULTIPLIED_CLIENT_ENCRYPTIONS = 6;
+
+PremultipliedUploads client_setup_premultiplied(
+	CryptoContext<DCRTPoly> &cc,
+	const PublicKey<DCRTPoly> &ckks_pk,
+	const std::vector<double> &consumptions,
+	const std::vector<double> &supplies,
+	const std::vector<double> &deviations,
+	const std::vector<double> &accepted,
+	BillingScheme scheme = BILLING_CKKS,
+	bool can_supply = true
+);
+
+/**
+ *  Participation of a client in the P2P trading, for the FHE aggregation of the
+ *  round totals: encryptions of the masks of the time slots in which it is
+ *  accepted as a consumer (it promised to consume more than it supplies) and
+ *  as a prosumer (it promised to supply more than it consumes).
+ */
+std::tuple<
+	Ciphertext<DCRTPoly>,
+	Ciphertext<DCRTPoly>
+>
+client_participation(
+	CryptoContext<DCRTPoly> &cc,
+	const PublicKey<DCRTPoly> &publickey,
+	const std::vector<double> &accepted,
+	const std::vector<double> &consumption_promise,
+	const std::vector<double> &supply_promise,
+	BillingScheme scheme = BILLING_CKKS
+);
+
+/**
+ *  Slot-wise sum of ctxts. Each of the n_threads threads (0: all of them) adds
+ *  a contiguous range of ctxts, then the partial sums are added pairwise in a
+ *  tree. Only n_threads ciphertexts are allocated.
+ */
+Ciphertext<DCRTPoly> sum_ciphertexts(
+	CryptoContext<DCRTPoly> &cc,
+	const std::vector<Ciphertext<DCRTPoly>> &ctxts,
+	int n_threads = 0
+);
+
+/** Round totals given to server_setup and server_billing */
+struct RoundTotals
+{
+	std::vector<double> totalDeviation;
+	std::vector<double> totalConsumers;
+	std::vector<double> totalProsumers;
+};
+
+/**
+ *  FHE aggregation of the round totals, instead of the pairwise masking of the
+ *  deviations and the counts of context.csv: adds the ct_deviations of
+ *  client_setup and the masks of client_participation of all the clients, and
+ *  decrypts the sums. The deviations are rounded to the 4 decimals of the data
+ *  and the counts to integers, so that CKKS noise does not turn a zero total
+ *  deviation into a nonzero one in server_setup.
+ */
+RoundTotals fhe_round_totals(
+	CryptoContext<DCRTPoly> &cc,
+	const PrivateKey<DCRTPoly> &sk,
+	const std::vector<Ciphertext<DCRTPoly>> &ct_deviations,
+	const std::vector<Ciphertext<DCRTPoly>> &ct_consumers,
+	const std::vector<Ciphertext<DCRTPoly>> &ct_prosumers,
+	int n_threads = 0,
+	BillingScheme scheme = BILLING_CKKS
+);
+
+std::tuple<
+	std::vector<double>,
+	std::vector<double>,
+	std::vector<double>
+>
+server_setup(std::vector<double> totalDeviation);
+
+/**
+ *  Branches of server_billing that can be nonzero in a round, known from public
+ *  information before the evaluation. The plaintexts and the operations of the
+ *  other branches are skipped. The default is the full circuit.
+ */
+struct BillingPlan
+{
+	bool p2p = true;        // some client is accepted for P2P trading
+	bool supplement = true; // P2P consumers may pay a supplement (TD < 0 in some time slot)
+	bool penalty = true;    // P2P prosumers may get a penalty (TD > 0 in some time slot)
+};
+
+/** Plan of a round, from the round totals and the masks of server_setup */
+BillingPlan plan_billing(
+	const std::vector<double> &totalP2PConsumers,
+	const std::vector<double> &totalP2PProsumers,
+	const std::vector<double> &maskTotalDevPositive,
+	const std::vector<double> &maskTotalDevNegative
+);
+
+/** Homomorphic operations of the billing */
+struct BillingOps
+{
+	int encodings = 0;
+	int encryptions = 0;
+	int mults = 0;       // ciphertext * ciphertext, not relinearised
+	int plain_mults = 0; // ciphertext * plaintext
+	int additions = 0;   // additions and subtractions
+	int relinearizations = 0; // key switches; a relinearisation per mult would take mults
+	size_t peak_bytes = 0; // most bytes of the ciphertexts made by server_billing alive at once; += keeps the largest
+
+	int total() const { return encodings + encryptions + mults + plain_mults + additions + relinearizations; }
+	BillingOps &operator+=(const BillingOps &other);
+};
+
+/**
+ *  When server_billing relinearises its ciphertext * ciphertext products.
+ *  - RELINEARIZE_OUTPUTS: the products of the bill, and of the reward, are added
+ *    unrelinearised and each sum is relinearised once.
+ *  - RELINEARIZE_PRODUCTS: every product is relinearised as it is made, which is
+ *    only kept to measure what the first one saves.
+ */
+enum BillingRelinearization { RELINEARIZE_OUTPUTS, RELINEARIZE_PRODUCTS };
+
+/**
+ *  Operations that encode_round_plaintexts, encode_tariff_plaintexts, and
+ *  server_billing for a client, are expected to evaluate with plan. For a
+ *  client that cannot supply energy, only the penalty of the reward is
+ *  computed. These are a reference to check the operations measured by
+ *  server_billing against.
+ */
+BillingOps round_encoding_ops(const BillingPlan &plan);
+BillingOps tariff_encoding_ops(const BillingPlan &plan);
+BillingOps client_billing_ops(const BillingPlan &plan, bool can_supply = true);
+
+/** Operations of server_billing for a client with premultiplied uploads */
+BillingOps premultiplied_billing_ops(const BillingPlan &plan, bool can_supply = true);
+
+/**
+ *  Plaintexts of server_billing that are the same for all the clients of a round.
+ *  rewardPenalty is encrypted, since it is multiplied by a ciphertext. The
+ *  plaintexts of the branches pruned by plan are left null.
+ */
+struct RoundPlaintexts
+{
+	Plaintext ones;
+	Plaintext tradingPrice;
+	Plaintext feedInTarif;
+	Plaintext maskTotalDevNegative;
+	Plaintext maskTotalDevPositive;
+	Ciphertext<DCRTPoly> rewardPenalty;
+	Plaintext maskedPenalty; // rewardPenalty * maskTotalDevPositive, for premultiplied uploads
+	BillingPlan plan;
+};
+
+/**
+ *  Plaintexts of server_billing that only depend on the retail price of the
+ *  client, hence are the same for all the clients of a tariff group.
+ */
+struct TariffPlaintexts
+{
+	Plaintext retailPrice;
+	Ciphertext<DCRTPoly> billSupplement;
+	Plaintext maskedSupplement; // billSupplement * maskTotalDevNegative, for premultiplied uploads
+};
+
+/** Encodings and encryptions made to encode the plaintexts, counted from those that are set */
+BillingOps encoding_ops(const RoundPlaintexts &round);
+BillingOps encoding_ops(const TariffPlaintexts &tariff);
+
+/** Bytes of the plaintexts, and of the encrypted plaintexts, that are set */
+size_t plaintexts_bytes(const RoundPlaintexts &round, const CryptoContext<DCRTPoly> &cc);
+size_t plaintexts_bytes(const TariffPlaintexts &tariff, const CryptoContext<DCRTPoly> &cc);
+
+// number of CKKS encodings made by encode_round_plaintexts and encode_tariff_plaintexts
+static const int ROUND_ENCODINGS = 6;
+static const int TARIFF_ENCODINGS = 2;
+
+RoundPlaintexts encode_round_plaintexts(
+	CryptoContext<DCRTPoly> &cc,
+	const PublicKey<DCRTPoly> &publickey,
+	const std::vector<double> &tradingPrice,
+	const std::vector<double> &feedInTarif,
+	const std::vector<double> &totalP2PProsumers,
+	const std::vector<double> &totalDeviation,
+	const std::vector<double> &maskTotalDevPositive,
+	const std::vector<double> &maskTotalDevNegative,
+	BillingScheme scheme = BILLING_CKKS,
+	const BillingPlan &plan = BillingPlan()
+);
+
+// plan must be the one of the RoundPlaintexts the tariff is billed with
+TariffPlaintexts encode_tariff_plaintexts(
+	CryptoContext<DCRTPoly> &cc,
+	const PublicKey<DCRTPoly> &publickey,
+	const std::vector<double> &tradingPrice,
+	const std::vector<double> &retailPrice,
+	const std::vector<double> &totalP2PConsumers,
+	const std::vector<double> &totalDeviation,
+	BillingScheme scheme = BILLING_CKKS,
+	const BillingPlan &plan = BillingPlan()
+);
+
+
+/**
+ *  Plaintexts of server_billing of premultiplied uploads: the supplement and
+ *  the penalty are multiplied by their masks in the clear, and nothing is
+ *  encrypted. Only feedInTarif, tradingPrice and maskedPenalty, and retailPrice
+ *  and maskedSupplement, are set.
+ */
+RoundPlaintexts encode_premultiplied_round_plaintexts(
+	CryptoContext<DCRTPoly> &cc,
+	const std::vector<double> &tradingPrice,
+	const std::vector<double> &feedInTarif,
+	const std::vector<double> &totalP2PProsumers,
+	const std::vector<double> &totalDeviation,
+	const std::vector<double> &maskTotalDevPositive,
+	BillingScheme scheme = BILLING_CKKS,
+	const BillingPlan &plan = BillingPlan()
+);
+
+TariffPlaintexts encode_premultiplied_tariff_plaintexts(
+	CryptoContext<DCRTPoly> &cc,
+	const std::vector<double> &tradingPrice,
+	const std::vector<double> &retailPrice,
+	const std::vector<double> &totalP2PConsumers,
+	const std::vector<double> &totalDeviation,
+	const std::vector<double> &maskTotalDevNegative,
+	BillingScheme scheme = BILLING_CKKS,
+	const BillingPlan &plan = BillingPlan()
+);
+
+/**
+ *  Clients with the same retail price vector. Their retail-dependent plaintexts
+ *  are encoded once per round, and they are billed as one batch.
+ */
+struct TariffGroup
+{
+	std::vector<double> retailPrice;
+	std::vector<int> clients;
+};
+
+/** Hash of the bits of the entries of retailPrice */
+uint64_t tariff_fingerprint(const std::vector<double> &retailPrice);
+
+/**
+ *  Groups the clients 0, ..., retailPrices.size()-1 by retail price. Clients are
+ *  grouped only if their retail prices are equal, not just their fingerprints.
+ *  Groups are sorted by first client, and the clients of each group are sorted.
+ */
+std::vector<TariffGroup> group_by_tariff(const std::vector<std::vector<double>> &retailPrices);
+
+
+std::tuple<Ciphertext<DCRTPoly>,
+		   Ciphertext<DCRTPoly>>
+server_billing(
+	// Cryptographic properties/values
+	CryptoContext<DCRTPoly> &cc,
+	PublicKey<DCRTPoly> publickey,
+
+	// Context information
+	std::vector<double> tradingPrice,
+	std::vector<double> retailPrice,
+	std::vector<double> feedInTarif,
+	std::vector<double> totalP2PConsumers,
+	std::vector<double> totalP2PProsumers,
+
+	// Deviation information
+	std::vector<double> totalDeviation,
+	std::vector<double>	maskTotalDevPositive,
+	std::vector<double>	maskTotalDevZero,
+	std::vector<double>	maskTotalDevNegative,
+
+	// Encrypted client information
+	Ciphertext<DCRTPoly> consumption,
+	Ciphertext<DCRTPoly> supplies,
+	Ciphertext<DCRTPoly> deviations,
+	Ciphertext<DCRTPoly> negDevSigns,
+	Ciphertext<DCRTPoly> accepted,
+	BillingScheme scheme = BILLING_CKKS,
+	BillingOps *ops = nullptr,
+	BillingRelinearization relinearization = RELINEARIZE_OUTPUTS
+);
+
+/**
+ *  server_billing with the plaintexts already encoded, e.g., once per tariff
+ *  group. Only the branches of round.plan are evaluated. If supplies is null
+ *  (the client cannot supply energy), the supply terms of the reward are not
+ *  computed: the reward is its penalty, or null without one (decrypt_billing
+ *  decrypts it as 0). With RELINEARIZE_OUTPUTS, the products of
+ *  the bill, and of the reward, are added before they are relinearised, with
+ *  one relinearisation per result and one for the masks they share.
+ *  If ops is not null, the operations are added to it as they are evaluated,
+ *  and the ciphertexts made are measured while they are alive.
+ */
+std::tuple<Ciphertext<DCRTPoly>,
+		   Ciphertext<DCRTPoly>>
+server_billing(
+	CryptoContext<DCRTPoly> &cc,
+	const RoundPlaintexts &round,
+	const TariffPlaintexts &tariff,
+
+	// Encrypted client information
+	Ciphertext<DCRTPoly> consumption,
+	Ciphertext<DCRTPoly> supplies,
+	Ciphertext<DCRTPoly> deviations,
+	Ciphertext<DCRTPoly> negDevSigns,
+	Ciphertext<DCRTPoly> accepted,
+	BillingOps *ops = nullptr,
+	BillingRelinearization relinearization = RELINEARIZE_OUTPUTS
+);
+
+
+/**
+ *  server_billing of premultiplied uploads, with the plaintexts of
+ *  encode_premultiplied_round_plaintexts and encode_premultiplied_tariff_plaintexts.
+ *  Only multiplies ciphertexts by plaintexts, so it consumes one level and needs
+ *  no relinearisation keys. If ops is not null, the operations are added to it.
+ */
+std::tuple<Ciphertext<DCRTPoly>,
+		   Ciphertext<DCRTPoly>>
+server_billing(
+	CryptoContext<DCRTPoly> &cc,
+	const RoundPlaintexts &round,
+	const TariffPlaintexts &tariff,
+	const PremultipliedUploads &uploads,
+	BillingOps *ops = nullptr
+);
+
+/**
+ *  Streaming billing: the readings of a time slot are encrypted and billed as
+ *  soon as they arrive, instead of once the whole round is known. The clients
+ *  are packed in groups of streaming_group_size clients: the client at position
+ *  p of its group uploads a single ciphertext per time slot, with its field f
+ *  (TimeslotField) in slot f * group_size + p. The server adds the uploads of a
+ *  group, rotates the fields into the first group_size slots and bills the
+ *  group with one server_billing per time slot, so the work of a time slot is
+ *  that of a batch round divided by TIMESLOTS, not that of a whole round.
+ */
+
+/** Fields of an upload of client_setup_timeslot */
+enum TimeslotField { FIELD_CONSUMPTION, FIELD_SUPPLY, FIELD_DEVIATION, FIELD_SIGN, FIELD_ACCEPTED, TIMESLOT_FIELDS };
+
+/**
+ *  Most clients in a group: the running bill of a group holds the TIMESLOTS
+ *  bills of every client, and BFV rotations are within the rows of N / 2 slots.
+ */
+int streaming_group_size(const CryptoContext<DCRTPoly> &cc, BillingScheme scheme = BILLING_CKKS);
+
+/** Rotations to generate with EvalRotateKeyGen for groups of group_size clients */
+std::vector<int32_t> streaming_rotation_indices(int group_size);
+
+/**
+ *  client_setup of the readings of one time slot of the client at position in
+ *  its group; the slots of the other clients encrypt 0. Throws
+ *  std::out_of_range if position is not in the group.
+ */
+Ciphertext<DCRTPoly> client_setup_timeslot(
+	CryptoContext<DCRTPoly> &cc,
+	const PublicKey<DCRTPoly> &ckks_pk,
+	int position,
+	int group_size,
+	double consumption,
+	double supply,
+	double deviation,
+	double accepted,
+	BillingScheme scheme = BILLING_CKKS
+);
+
+/**
+ *  encode_round_plaintexts with the context of one time slot, known once the
+ *  totals of that time slot are aggregated, for the group_size clients of a
+ *  group. Only the supplement or the penalty is encoded and billed, depending
+ *  on the sign of the total deviation.
+ */
+RoundPlaintexts encode_timeslot_plaintexts(
+	CryptoContext<DCRTPoly> &cc,
+	const PublicKey<DCRTPoly> &publickey,
+	int group_size,
+	double tradingPrice,
+	double feedInTarif,
+	double totalP2PProsumers,
+	double totalDeviation,
+	BillingScheme scheme = BILLING_CKKS
+);
+
+/**
+ *  encode_tariff_plaintexts of one time slot for a group, with the retail
+ *  price of every client of the group at that time slot, in group order.
+ */
+TariffPlaintexts encode_timeslot_tariff_plaintexts(
+	CryptoContext<DCRTPoly> &cc,
+	const PublicKey<DCRTPoly> &publickey,
+	double tradingPrice,
+	const std::vector<double> &retailPrices,
+	double totalP2PConsumers,
+	double totalDeviation,
+	BillingScheme scheme = BILLING_CKKS
+);
+
+/**
+ *  Encrypted bills and rewards of a group over the time slots billed so far:
+ *  the bill of the client at position p for the k-th last time slot billed is
+ *  in slot k * group_size + p.
+ */
+struct RunningBill
+{
+	Ciphertext<DCRTPoly> bill;
+	Ciphertext<DCRTPoly> reward;
+	int n_timeslots = 0;
+};
+
+/**
+ *  Adds the uploads of client_setup_timeslot of the clients of a group for the
+ *  next time slot, bills them with server_billing and folds the result into
+ *  running, which is rotated by one block of group_size slots. The work per time
+ *  slot does not depend on the number of time slots already billed: 3 rotations
+ *  to take the fields apart, one server_billing, and 2 rotations to fold.
+ */
+void fold_timeslot(
+	CryptoContext<DCRTPoly> &cc,
+	RunningBill &running,
+	int group_size,
+	const RoundPlaintexts &round,
+	const TariffPlaintexts &tariff,
+	const std::vector<Ciphertext<DCRTPoly>> &uploads
+);
+
+/**
+ *  Bill and reward of the round of the clients of a group. Throws
+ *  std::logic_error if not all the TIMESLOTS time slots were folded.
+ */
+std::tuple<Ciphertext<DCRTPoly>,
+		   Ciphertext<DCRTPoly>>
+finalise_bill(const RunningBill &running);
+
+/**
+ *  The bills (or rewards) of the n_members first clients of a group, from a
+ *  ciphertext of finalise_bill, in money units, as decrypt_billing returns
+ *  those of a client.
+ */
+std::vector<std::vector<double>> decrypt_group_billing(
+	CryptoContext<DCRTPoly> &cc,
+	const PrivateKey<DCRTPoly> &sk,
+	const Ciphertext<DCRTPoly> &ctxt,
+	int group_size,
+	int n_members,
+	BillingScheme scheme = BILLING_CKKS
+);
+
+
+/**
+ *  Bills and rewards of a client over a billing period (e.g., a month), added
+ *  day by day into a single pair of ciphertexts, so that the period is
+ *  decrypted once instead of once per day.
+ *
+ *  The days are packed in days_per_ciphertext blocks of TIMESLOTS slots: day d
+ *  is rotated into block d % days_per_ciphertext, so that 1 adds up all the
+ *  days of the period, and the number of days of the period keeps every day
+ *  apart. Rotations need the keys of rotation_indices.
+ *
+ *  The daily results of server_billing all have the same level and scale, so
+ *  they are added as they are. With the FLEXIBLEAUTO scaling of
+ *  generate_parameters_ckks they are not rescaled yet, and the sum is rescaled
+ *  once, when the period is decrypted, instead of once per day.
+ */
+class BillAccumulator
+{
+	CryptoContext<DCRTPoly> cc;
+	BillingScheme scheme;
+	int days_per_ciphertext;
+	Ciphertext<DCRTPoly> bill;
+	Ciphertext<DCRTPoly> reward;
+
+	public:
+
+		int n_days = 0; // days added so far
+
+		// throws std::invalid_argument if the blocks do not fit in the slots of cc
+		BillAccumulator(const CryptoContext<DCRTPoly>& cc, int days_per_ciphertext = 1, BillingScheme scheme = BILLING_CKKS);
+
+		// rotations to generate with EvalRotateKeyGen
+		static std::vector<int32_t> rotation_indices(int days_per_ciphertext);
+
+		/**
+		 *  Adds the bill and reward of the next day. Throws std::invalid_argument
+		 *  if they are not at the level and scale of the previous days. The reward
+		 *  may be null, as server_billing returns it for a client that cannot
+		 *  supply energy on a day without penalty: it adds nothing, and the
+		 *  reward of a period without any stays null (decrypt gives 0s, like
+		 *  decrypt_billing).
+		 */
+		void add_day(const Ciphertext<DCRTPoly>& bill_ct, const Ciphertext<DCRTPoly>& reward_ct);
+
+		// bytes of the ciphertexts of the accumulator
+		size_t memory_bytes() const;
+
+		// bill and reward (null if no day had one) of the period; throws std::logic_error if no day was added
+		std::tuple<Ciphertext<DCRTPoly>,
+				   Ciphertext<DCRTPoly>>
+		close() const;
+
+		// the blocks of ctxt, one of the ciphertexts of close, in money units
+		std::vector<std::vector<double>> decrypt(const PrivateKey<DCRTPoly>& sk, const Ciphertext<DCRTPoly>& ctxt);
+};
+
+#endif
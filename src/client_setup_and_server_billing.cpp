@@ -5,426 +5,115 @@
 #include <fstream>
 #include <sstream>
 #include <chrono>
+#include <numeric>
+#include <cmath>
+#include <memory>
 
-#include "utils_ckks.h"
-#include "vectorutils.hpp"
-#include "billing_tools.hpp"
-
-// Experiment settings
-static const int DAYS = 1;
-static const int TIMESLOTS_PER_DAY = 24;
-static const int TIMESLOTS = DAYS * TIMESLOTS_PER_DAY;
-static const int NR_CLIENTS = 150;
-static const int N_TIME_SLOTS = 1024; // should be a power of two, greater than TIMESLOTS
-static const string DATA_DIR = "../../../energy-billing-data-generation/data";
+#include "billing.h"
+#include "memory_budget.h"
+#include "result_archive.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 
 using namespace lbcrypto;
 
-/**
- * Load the context data
- *  
- * Returns a tuple with plaintext vectors containing
- * - the total deviation,
- * - the trading price,
- * - the retail price,
- * - the feed_in_tarif,
- * - the number of consumers, and
- * - the number of prosumers.
- * 
- * Each vector contains data for the entire round.
- */
-std::tuple<vector<double>,
- 		   vector<double>,
-		   vector<double>,
-		   vector<double>,
-		   vector<double>>
-context_setup()
+// largest |x[i] - y[i]|
+double max_abs_difference(const std::vector<double>& x, const std::vector<double>& y)
 {
-	std::string dirname = "/" + std::to_string(TIMESLOTS) + "_ts_" + std::to_string(NR_CLIENTS) + "_clients";
-	std::string fname = DATA_DIR + dirname + "/context.csv";
-	std::cout << fname << std::endl;
-
-	ifstream inputFile(fname);
-	if (!inputFile.is_open()) {
-		throw std::invalid_argument("cannot open specified file");
-	}
-	std::string line;
-
-	// Skip header line
-	getline(inputFile, line);
-
-	// Feed-in tarif
-	getline(inputFile, line);
-	std::vector<double> feedInTarif = parseToDoubles(line);
-	assert(feedInTarif.size() == TIMESLOTS);
-
-	// Trading prices
-	getline(inputFile, line);
-	std::vector<double> tradingPrice = parseToDoubles(line);
-	assert(tradingPrice.size() == TIMESLOTS);
-
-	// Total consumers
-	getline(inputFile, line);
-	std::vector<double> totalConsumers = parseToDoubles(line);
-	assert(totalConsumers.size() == TIMESLOTS);
-
-	// Total prosumers
-	getline(inputFile, line);
-	std::vector<double> totalProsumers = parseToDoubles(line);
-	assert(totalProsumers.size() == TIMESLOTS);
-
-	// Total deviation
-	getline(inputFile, line);
-	std::vector<double> totalDeviation = parseToDoubles(line);
-	assert(totalDeviation.size() == TIMESLOTS);
-
-	return {
-		feedInTarif,
-		tradingPrice,
-		totalProsumers,
-		totalConsumers,
-		totalDeviation
-	};
+	double diff = 0.0;
+	for (unsigned int i = 0; i < x.size(); i++)
+		diff = std::max(diff, std::fabs(x[i] - y[i]));
+	return diff;
 }
-/* 	END definition of function context_setup  */
-
-/**
- * Loads client data from file.
- * 
- * Returns:
- * - client's consumptions,
- * - ... supplies, 
- * - ... consumption_promise, 
- * - ... supply_promise, 
- * - ... retailPrice, 
- * - ... accepted, 
- * - ... deviations, 
- * - ... expected bill, 
- * - ... expected reward.
- * 
- * The last two values can be used in the experimentation phase to
- * check the output of the server is correct.
- */
-std::tuple<
-	std::vector<double>,
-	std::vector<double>,
-	std::vector<double>,
-	std::vector<double>,
-	std::vector<double>,
-	std::vector<double>,
-	std::vector<double>,
-	std::vector<double>,
-	std::vector<double>
->
-load_client_data(int clientID)
-{
-	// Open specified datafile
-	std::string dirname = "/" + std::to_string(TIMESLOTS) + "_ts_" + std::to_string(NR_CLIENTS) + "_clients";
-	std::string fname = DATA_DIR + dirname + "/user_" + std::to_string(clientID) + ".csv";
-	std::cout << fname << std::endl;
-
-	ifstream inputFile(fname);
-	if (!inputFile.is_open()) {
-		throw std::invalid_argument("cannot open specified file");
-	}
-	std::string line;
-
-	// Skip header line
-	getline(inputFile, line);
-
-	// Retail price
-	getline(inputFile, line);
-	std::vector<double> retailPrice = parseToDoubles(line);
-	assert(retailPrice.size() == TIMESLOTS);
-
-	// Consumption promise
-	getline(inputFile, line);
-	std::vector<double> consumption_promise = parseToDoubles(line);
-	assert(consumption_promise.size() == TIMESLOTS);
-
-	// Supply promise
-	getline(inputFile, line);
-	std::vector<double> supply_promise = parseToDoubles(line);
-	assert(supply_promise.size() == TIMESLOTS);
-
-	// Consumption
-	getline(inputFile, line);
-	std::vector<double> consumptions = parseToDoubles(line);
-	assert(consumptions.size() == TIMESLOTS);
-
-	// Supply
-	getline(inputFile, line);
-	std::vector<double> supplies = parseToDoubles(line);
-	assert(supplies.size() == TIMESLOTS);
-	
-	// Individual deviation
-	getline(inputFile, line);
-	std::vector<double> deviations = parseToDoubles(line);
-	assert(deviations.size() == TIMESLOTS);
-
-	// Trading accepted
-	getline(inputFile, line);
-	std::vector<double> accepted = parseToDoubles(line);
-	assert(accepted.size() == TIMESLOTS);
-
-	// Expected bill
-	getline(inputFile, line);
-	std::vector<double> expectedBill = parseToDoubles(line);
-	assert(expectedBill.size() == TIMESLOTS);
-
-	// Expected reward
-	getline(inputFile, line);
-	std::vector<double> expectedReward = parseToDoubles(line);
-	assert(expectedReward.size() == TIMESLOTS);
-
-	inputFile.close();
-
-	return {
-		consumptions,
-		supplies,
-		consumption_promise,
-		supply_promise,
-		retailPrice,
-		accepted,
-		deviations,
-		expectedBill,
-		expectedReward
-	};
-}
-/* 	END definition of function load_client_data  */
 
+// number of clients billed with both relinearisations by compare_relinearizations
+static const int RELINEARIZATION_SAMPLE = 10;
 
 /**
- * Definition of function client_setup.
- * 
- * Receives
- *  - the cryptographic context,
- *	- the client's public key,
- *  - the client's consumption data,
- *  - ... supply data
- *  - ... deviation data,
- *  - ... accepted for p2p-trading data.
- *
- * Returns a tuple with ciphertexts encrypting 
- * - the consumptions, 
- * - the supplies,
- * - the deviations,
- * - the signs of the deviations (marking negative or positive),
- * - mask indicating when client was accepted for p2p-trading.
+ *  Bills the uploads of the first RELINEARIZATION_SAMPLE clients with one
+ *  relinearisation per output and with one per product, and returns the
+ *  operations that were evaluated and the server_billing time, in microseconds,
+ *  of each. The uploads are encrypted with the public key, and the total
+ *  client_setup time is returned last, as the baseline of the offline/online
+ *  client_setup.
  */
-std::tuple<
-	Ciphertext<DCRTPoly>,
-	Ciphertext<DCRTPoly>,
-	Ciphertext<DCRTPoly>,
-	Ciphertext<DCRTPoly>,
-	Ciphertext<DCRTPoly>
->
-client_setup(
-	CryptoContext<DCRTPoly> &cc, 
-	const PublicKey<DCRTPoly> &ckks_pk,
-	std::vector<double> consumptions,
-	std::vector<double> supplies,
-	std::vector<double> deviations,
-	std::vector<double> accepted
+std::tuple<BillingOps, BillingOps, int64_t, int64_t, int64_t> compare_relinearizations(
+	CryptoContext<DCRTPoly> &cc,
+	const KeyPair<DCRTPoly> &keys,
+	BillingScheme scheme,
+	const std::vector<double> &tradingPrice,
+	const std::vector<double> &feedInTarif,
+	const std::vector<double> &totalConsumers,
+	const std::vector<double> &totalProsumers,
+	const std::vector<double> &totalDeviation,
+	const std::vector<double> &maskTotalDevPositive,
+	const std::vector<double> &maskTotalDevZero,
+	const std::vector<double> &maskTotalDevNegative
 )
 {
-	// Compute signs of individual deviations
-	vector<double> sign_deviations(TIMESLOTS);
-	for (int i = 0; i < TIMESLOTS; i++)
+	BillingOps ops[2];
+	int64_t timings[2] = {0, 0};
+	int64_t client_us = 0;
+	for (int userID = 0; userID < RELINEARIZATION_SAMPLE; userID++)
 	{
-		if (deviations[i] <= 0)
-			sign_deviations[i] = 1;
-		else
-			sign_deviations[i] = 0;
-	}
-
-	// Encrypt the secret data
-	Ciphertext<DCRTPoly> ct_consump = pack_and_encrypt(consumptions, cc, ckks_pk);
-	Ciphertext<DCRTPoly> ct_supplies = pack_and_encrypt(supplies, cc, ckks_pk);
-	Ciphertext<DCRTPoly> ct_deviations = pack_and_encrypt(deviations, cc, ckks_pk);
-	Ciphertext<DCRTPoly> ct_signs = pack_and_encrypt(sign_deviations, cc, ckks_pk);
-	Ciphertext<DCRTPoly> ct_accepted = pack_and_encrypt(accepted, cc, ckks_pk);
-
-	return {
-		ct_consump, 
-		ct_supplies, 
-		ct_deviations, 
-		ct_signs,
-		ct_accepted
-	};
-}
-/* 	END definition of function client_setup  */
-
-
-std::tuple<
-	std::vector<double>,
-	std::vector<double>,
-	std::vector<double>
->
-server_setup(std::vector<double> totalDeviation)
-{
-	// Create total deviation masks
-	vector<double> maskTotalDevZero(totalDeviation.size(), 0.0);
-	vector<double> maskTotalDevNegative(totalDeviation.size(), 0.0);
-	vector<double> maskTotalDevPositive(totalDeviation.size(), 0.0);
-	for (unsigned int i = 0; i < totalDeviation.size(); i++)
-	{
-		if (totalDeviation[i] == 0)
-			maskTotalDevZero[i] = 1;
-		else if (totalDeviation[i] > 0)
-			maskTotalDevPositive[i] = 1;
-		else // total_deviation[i] < 0
-			maskTotalDevNegative[i] = 1;
+		auto [
+			consumptions,
+			supplies,
+			consumption_promise,
+			supply_promise,
+			retailPrice,
+			accepted,
+			deviations,
+			expectedBill,
+			expectedReward
+		] = load_client_data(userID);
+		auto client_start = std::chrono::high_resolution_clock::now();
+		auto [ct_consumption, ct_supplies, ct_deviations, ct_signs, ct_accepted]
+			= client_setup(cc, keys.publicKey, consumptions, supplies, deviations, accepted, scheme);
+		auto client_end = std::chrono::high_resolution_clock::now();
+		client_us += std::chrono::duration_cast<std::chrono::microseconds>(client_end - client_start).count();
+
+		for (BillingRelinearization relinearization : {RELINEARIZE_OUTPUTS, RELINEARIZE_PRODUCTS})
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			auto [ct_bill, ct_reward] = server_billing(cc, keys.publicKey, tradingPrice, retailPrice, feedInTarif, totalConsumers,
+			                                           totalProsumers, totalDeviation, maskTotalDevPositive, maskTotalDevZero,
+			                                           maskTotalDevNegative, ct_consumption, ct_supplies, ct_deviations, ct_signs,
+			                                           ct_accepted, scheme, &ops[relinearization], relinearization);
+			auto end = std::chrono::high_resolution_clock::now();
+			timings[relinearization] += std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+			assert(max_abs_difference(decrypt_billing(cc, keys.secretKey, ct_bill, scheme), expectedBill) < 1e-2);
+			assert(max_abs_difference(decrypt_billing(cc, keys.secretKey, ct_reward, scheme), expectedReward) < 1e-2);
+		}
 	}
-
-	return {
-		maskTotalDevPositive,
-		maskTotalDevZero,
-		maskTotalDevNegative
-	};
+	return {ops[RELINEARIZE_OUTPUTS], ops[RELINEARIZE_PRODUCTS], timings[RELINEARIZE_OUTPUTS], timings[RELINEARIZE_PRODUCTS], client_us};
 }
 
-/*	END definition of function server_setup	*/
-
-
 /**
- * 	Definition of function server_billing:
- *
- *  Receives
- *  * Cryptographic properties, i.e.,
- *	  - the cryptographic context,
- *	  - the public key.
- *
- *  * Context information (for all timeslots)
- *    - trading prices, 
- *    - retail prices,
- *    - feed-in tarifs,
- *    - number of P2P-consumers,
- *    - number of P2P-prosumers.
- * 
- *  * Deviation information (for all timeslots)
- *    - total deviation,
- *    - bits masking timeslots with positive deviation,
- *    - ... with zero deviation,
- *    - ... with negative deviation.
- * 
- *  * Encrypted client information (for all timeslots)
- * 	  - consumption,
- *    - supplies,
- *    - deviations,
- *    - masks indicating timeslots in which they had a non-negative deviation,
- *    - masks indicating timeslots they were accepted for p2p trading.
- *
- *	Returns two ciphertexts encrypting the bill and the reward, respectively, 
- *  for this client, for each time slot.
- * 
- *	All ciphertexts are encrypted under the client's key
+ *  Bills the NR_CLIENTS clients. In CKKS the clients encrypt their uploads in
+ *  offline/online mode (ZeroEncryptionPool), and those are billed; the
+ *  public-key client_setup is only timed, for the first clients, by
+ *  compare_relinearizations. With a memory budget, as many clients are billed
+ *  in parallel as the budget allows, after the keys: every client reserves its
+ *  uploads and plaintexts before they are created, as many bytes as they can
+ *  take at most, and releases what they do not take once they are measured.
+ *  The intermediates of server_billing are only known once measured: the most
+ *  measured for the clients before is reserved. A client starts once the peak
+ *  measured for the clients before it fits (MemoryTask); the first one is billed
+ *  alone, and std::length_error is thrown if the keys and one client do not fit,
+ *  so the budget is never exceeded. Without a budget (budget_bytes = 0), the
+ *  clients are billed one after the other.
+ *  With an archive_path, the bill and reward of every client are appended to
+ *  the result archive there, as round 0, and read back for client 0.
  */
-std::tuple<Ciphertext<DCRTPoly>,
-		   Ciphertext<DCRTPoly>>
-server_billing(
-	// Cryptographic properties/values
-	CryptoContext<DCRTPoly> &cc,
-	PublicKey<DCRTPoly> publickey,
-
-	// Context information
-	std::vector<double> tradingPrice,
-	std::vector<double> retailPrice,
-	std::vector<double> feedInTarif,
-	std::vector<double> totalP2PConsumers,
-	std::vector<double> totalP2PProsumers,
-
-	// Deviation information
-	std::vector<double> totalDeviation,
-	std::vector<double>	maskTotalDevPositive,
-	std::vector<double>	maskTotalDevZero,
-	std::vector<double>	maskTotalDevNegative,
-
-	// Encrypted client information
-	Ciphertext<DCRTPoly> consumption,
-	Ciphertext<DCRTPoly> supplies,
-	Ciphertext<DCRTPoly> deviations,
-	Ciphertext<DCRTPoly> negDevSigns,
-	Ciphertext<DCRTPoly> accepted
-)
-{
-	// Create rejected; a dual to the accepted mask
-	Ciphertext<DCRTPoly> rejected = negate_all_slots(accepted, cc);
-	Ciphertext<DCRTPoly> nonNegDevSigns = negate_all_slots(negDevSigns, cc);
-	
-
-	// CASE: User not accepted for P2P trading -> they pay/get retail price
-	Ciphertext<DCRTPoly> bill_no_p2p = pack_and_mult(consumption, retailPrice, cc);
-	Ciphertext<DCRTPoly> reward_no_p2p = pack_and_mult(supplies, feedInTarif, cc);
-
-	// CASE: User was accepted for P2P trading
-			Ciphertext<DCRTPoly> baseBill = pack_and_mult(consumption, tradingPrice, cc);
-			Ciphertext<DCRTPoly> baseReward = pack_and_mult(supplies, tradingPrice, cc);
-
-		// CASE: TD == 0
-		    // consumer <- baseBill
-			// prosumer <- baseReward
-
-		// CASE: TD < 0
-			// demand > supply
-
-			// prosumer <- baseReward
-
-			// CASE: indiv dev <= 0
-				// consumer <- baseBill
-			
-			// CASE: indiv dev > 0
-				// consumer gets a billSupplement; buy their portion of what was used too much against retail price.
-				// bill = (consumption - TD / nr_p2p_consumers) * tradingPrice + TD / nr_p2p_consumers * retailPrice
-				//      = consumption * tradingPrice + TD / nr_p2p_consumers * (retailPrice - tradingPrice)
-				//      = baseBill + TD / nr_p2p_consumers * (retail_price - trading price)
-				// hence,
-				// supplement = TD / nr_p2p_consumers * (retail_price - trading price)
-
-				vector<double> billSupplement_pt = ((retailPrice - tradingPrice) / totalP2PConsumers) * totalDeviation;
-				Ciphertext<DCRTPoly> billSupplement_ct = pack_and_encrypt(billSupplement_pt, cc, publickey);
-				billSupplement_ct = cc->EvalMult(billSupplement_ct, nonNegDevSigns);
-		
-		// CASE: TD > 0
-			// demand < supply
-
-			// consumers <- baseBill
-
-			// CASE: indiv dev <= 0
-				// prosumers <- baseReward
-
-			// CASE: indiv dev > 0
-				// prosumers get a penalty; they sell their portion of what was produced too much against feedin tarif
-				// reward = (supply - TD / nr_p2p_prosumers) * tradingPrice + TD / nr_p2p_prosumers * feedInTarif
-				//        = supply * tradingPrice + (TD / nr_p2p_prosumers * (feedInTarif - tradingPrice)
-				//        = baseReward + (TD / nr_p2p_prosumers * (feedInTarif - tradingPrice)
-				// hence,
-				// penalty = (TD / nr_p2p_prosumers * (feedInTarif - tradingPrice)
-				//
-				// Note that the penalty is negative, since feedInTarif is assumed to be < tradingPrice
-				vector<double> rewardPenalty_pt = ((feedInTarif - tradingPrice) / totalP2PProsumers) * totalDeviation;
-				Ciphertext<DCRTPoly> rewardPenalty_ct = pack_and_encrypt(rewardPenalty_pt, cc, publickey);
-				rewardPenalty_ct = cc->EvalMult(rewardPenalty_ct, nonNegDevSigns);
-
-		// Aggregating the P2P cases
-		Ciphertext<DCRTPoly> bill_p2p = baseBill + pack_and_mult(billSupplement_ct, maskTotalDevNegative, cc);
-		Ciphertext<DCRTPoly> reward_p2p = baseReward + pack_and_mult(rewardPenalty_ct, maskTotalDevPositive, cc);
-
-	// Aggregating P2P and no-P2P cases
-	Ciphertext<DCRTPoly> bill_ct = cc->EvalMult(bill_p2p, accepted) + cc->EvalMult(bill_no_p2p, rejected);
-	Ciphertext<DCRTPoly> reward_ct = cc->EvalMult(reward_p2p, accepted) + cc->EvalMult(reward_no_p2p, rejected);
-	
-	return {bill_ct, reward_ct};
-}
-
-void experiment()
+void experiment(BillingScheme scheme, size_t budget_bytes, const std::string& archive_path)
 {
 	// Generate FHE context
-	CCParams<CryptoContextCKKSRNS> parameters = generate_parameters_ckks(N_TIME_SLOTS);
-	CryptoContext<DCRTPoly> cc = generate_crypto_context_ckks(parameters);
-	std::cout << "CKKS scheme is using ring dimension " 
+	CryptoContext<DCRTPoly> cc = billing_crypto_context(scheme);
+	std::cout << billing_scheme_name(scheme) << " scheme is using ring dimension "
 			  << cc->GetRingDimension()
 			  << std::endl;
 
@@ -437,6 +126,18 @@ void experiment()
 	cc->EvalMultKeyGen(keys.secretKey); // generates relinearization key
 	const PublicKey<DCRTPoly> &ckks_pub_key = keys.publicKey;
 
+	// Memory: the keys stay for the whole run; the objects of a client are
+	// reserved before they are created, and its first peak gates how many
+	// clients are billed at once
+	MemoryBudget budget(budget_bytes);
+	size_t keys_bytes = key_bytes(keys);
+	budget.reserve(keys_bytes);
+	int n_threads = 1;
+#ifdef _OPENMP
+	if (budget_bytes > 0)
+		n_threads = omp_get_max_threads();
+#endif
+
 	// Load experiment context
 	auto [
 		feedInTarif,
@@ -456,8 +157,21 @@ void experiment()
 	// Run experiment
 	std::vector<int64_t> client_timings(NR_CLIENTS, 0);
 	std::vector<int64_t> server_timings(NR_CLIENTS, 0);
+	std::vector<int64_t> client_offline_timings(NR_CLIENTS, 0);
+	std::vector<int64_t> client_online_timings(NR_CLIENTS, 0);
+	size_t pool_bytes = 0;
+	size_t input_bytes = 0, output_bytes = 0;
+	double max_bill_error = 0.0, max_reward_error = 0.0;
+	BillingOps billing_ops;
+	std::unique_ptr<ArchiveWriter> archive;
+	if (!archive_path.empty())
+		archive = std::make_unique<ArchiveWriter>(archive_path);
+	int64_t archive_us = 0;
+	#pragma omp parallel for num_threads(n_threads) schedule(dynamic)
 	for (int userID = 0; userID < NR_CLIENTS; userID++)
 	{
+		MemoryTask task(budget);
+
 		// Load client data
 		auto [
 			consumptions,
@@ -471,62 +185,231 @@ void experiment()
 			expectedReward
 		] = load_client_data(userID);		
 
-		// Setup client
-		auto setup_client_start = std::chrono::high_resolution_clock::now();
-		auto [
-			ct_consumption, 
-			ct_supplies, 
-			ct_deviations, 
-			ct_signs,
-			ct_accepted
-		] = client_setup(cc, ckks_pub_key, consumptions, supplies, deviations, accepted);
-		auto setup_client_end = std::chrono::high_resolution_clock::now();
-		auto setup_duration = std::chrono::duration_cast<std::chrono::microseconds>( setup_client_end - setup_client_start).count();
-		client_timings[userID] = setup_duration;
-
-		// Execute server billing
+		// Setup client; in CKKS in offline/online mode: the pool is filled while the client
+		// is idle, and the online client_setup turns each of its encryptions of zero into an
+		// upload. The uploads are reserved as fresh ciphertexts before they are encrypted,
+		// with a ciphertext and a plaintext of scratch for the one being made
+		size_t uploads_reserved = CLIENT_ENCRYPTIONS * fresh_ciphertext_bytes(cc);
+		size_t scratch_bytes = fresh_ciphertext_bytes(cc) + fresh_plaintext_bytes(cc);
+		task.reserve(uploads_reserved + scratch_bytes, CLIENT_ENCRYPTIONS + 1);
+		Ciphertext<DCRTPoly> ct_consumption, ct_supplies, ct_deviations, ct_signs, ct_accepted;
+		if (BILLING_CKKS == scheme)
+		{
+			ZeroEncryptionPool pool(cc, ckks_pub_key);
+			auto offline_start = std::chrono::high_resolution_clock::now();
+			pool.refill(CLIENT_ENCRYPTIONS);
+			auto offline_end = std::chrono::high_resolution_clock::now();
+			#pragma omp critical
+			pool_bytes = pool.memory_bytes();
+			std::tie(ct_consumption, ct_supplies, ct_deviations, ct_signs, ct_accepted)
+				= client_setup(pool, consumptions, supplies, deviations, accepted);
+			auto online_end = std::chrono::high_resolution_clock::now();
+			assert(pool.n_misses == 0);
+			client_offline_timings[userID] = std::chrono::duration_cast<std::chrono::microseconds>(offline_end - offline_start).count();
+			client_online_timings[userID] = std::chrono::duration_cast<std::chrono::microseconds>(online_end - offline_end).count();
+			client_timings[userID] = client_offline_timings[userID] + client_online_timings[userID];
+		}
+		else
+		{
+			auto setup_client_start = std::chrono::high_resolution_clock::now();
+			std::tie(ct_consumption, ct_supplies, ct_deviations, ct_signs, ct_accepted)
+				= client_setup(cc, ckks_pub_key, consumptions, supplies, deviations, accepted, scheme);
+			auto setup_client_end = std::chrono::high_resolution_clock::now();
+			client_timings[userID] = std::chrono::duration_cast<std::chrono::microseconds>(setup_client_end - setup_client_start).count();
+		}
+
+		task.release(scratch_bytes, 1);
+
+		// measured before the uploads are moved into server_billing, which frees them after their last use
+		size_t uploads_bytes = 0;
+		for (const Ciphertext<DCRTPoly>& ct : {ct_consumption, ct_supplies, ct_deviations, ct_signs, ct_accepted})
+			if (nullptr != ct)
+				uploads_bytes += ciphertext_bytes(ct, cc);
+		assert(uploads_bytes <= uploads_reserved);
+		task.release(uploads_reserved - uploads_bytes);
+		#pragma omp critical
+		input_bytes = ciphertext_bytes(ct_consumption, cc);
+
+		// Execute server billing; the plaintexts of the round are encoded for every
+		// client, as the server_billing of the whole context does
+		BillingOps client_ops;
 		auto server_billing_start = std::chrono::high_resolution_clock::now();
+		BillingPlan plan = plan_billing(totalConsumers, totalProsumers, maskTotalDevPositive, maskTotalDevNegative);
+		BillingOps encodings = round_encoding_ops(plan);
+		encodings += tariff_encoding_ops(plan);
+		size_t plaintexts_reserved = encodings.encodings * fresh_plaintext_bytes(cc) + encodings.encryptions * fresh_ciphertext_bytes(cc);
+		int plaintexts_encrypted = encodings.encryptions;
+		task.reserve(plaintexts_reserved, plaintexts_encrypted);
+		RoundPlaintexts round = encode_round_plaintexts(cc, ckks_pub_key, tradingPrice, feedInTarif, totalProsumers, totalDeviation,
+		                                                maskTotalDevPositive, maskTotalDevNegative, scheme, plan);
+		TariffPlaintexts tariff = encode_tariff_plaintexts(cc, ckks_pub_key, tradingPrice, retailPrice, totalConsumers, totalDeviation,
+		                                                   scheme, plan);
+		size_t plaintexts_bytes_used = plaintexts_bytes(round, cc) + plaintexts_bytes(tariff, cc);
+		assert(plaintexts_bytes_used <= plaintexts_reserved);
+		task.release(plaintexts_reserved - plaintexts_bytes_used);
+		plaintexts_reserved = plaintexts_bytes_used;
+		client_ops += encoding_ops(round);
+		client_ops += encoding_ops(tariff);
+
+		// the intermediates are alive next to the uploads and the plaintexts
+		size_t intermediates_reserved;
+		#pragma omp critical
+		intermediates_reserved = billing_ops.peak_bytes;
+		task.reserve(intermediates_reserved);
 		auto [ct_bill, ct_reward] = server_billing(
 			cc,
-			ckks_pub_key,
+			round,
+			tariff,
 
-			tradingPrice,
-			retailPrice,
-			feedInTarif,
-			totalConsumers,
-			totalProsumers,
-
-			totalDeviation,
-			maskTotalDevPositive,
-			maskTotalDevZero,
-			maskTotalDevNegative,
-
-			ct_consumption,
-			ct_supplies, 
-			ct_deviations, 
-			ct_signs,
-			ct_accepted
+			std::move(ct_consumption),
+			std::move(ct_supplies),
+			std::move(ct_deviations),
+			std::move(ct_signs),
+			std::move(ct_accepted),
+
+			&client_ops
 		);
 		auto server_billing_end = std::chrono::high_resolution_clock::now();
 		auto billing_duration = std::chrono::duration_cast<std::chrono::microseconds>(server_billing_end - server_billing_start).count();
 		server_timings[userID] = billing_duration;
+
+		// what the intermediates took beyond their reservation; the results stay
+		if (client_ops.peak_bytes > intermediates_reserved)
+			task.reserve_transient(client_ops.peak_bytes - intermediates_reserved);
+		size_t results_bytes = ciphertext_bytes(ct_bill, cc) + ((nullptr != ct_reward) ? ciphertext_bytes(ct_reward, cc) : 0);
+		task.release(uploads_bytes + plaintexts_reserved + intermediates_reserved, CLIENT_ENCRYPTIONS + plaintexts_encrypted);
+		round = RoundPlaintexts();
+		tariff = TariffPlaintexts();
+		task.reserve(results_bytes, 2);
+
+		// Check the results against the expected ones
+		double bill_error = max_abs_difference(decrypt_billing(cc, keys.secretKey, ct_bill, scheme), expectedBill);
+		double reward_error = max_abs_difference(decrypt_billing(cc, keys.secretKey, ct_reward, scheme), expectedReward);
+		#pragma omp critical
+		{
+			output_bytes = ciphertext_bytes(ct_bill, cc);
+			billing_ops += client_ops;
+			max_bill_error = std::max(max_bill_error, bill_error);
+			max_reward_error = std::max(max_reward_error, reward_error);
+		}
+		if (archive)
+		{
+			// the record is a copy of the results, freed once the writer has it in a batch
+			auto archive_start = std::chrono::high_resolution_clock::now();
+			std::vector<uint8_t> record;
+			append_ciphertext_record(record, ct_bill);
+			append_ciphertext_record(record, ct_reward);
+			archive->append(userID, 0, record.data(), record.size());
+			auto archive_end = std::chrono::high_resolution_clock::now();
+			#pragma omp atomic
+			archive_us += std::chrono::duration_cast<std::chrono::microseconds>(archive_end - archive_start).count();
+		}
+		ct_bill.reset();
+		ct_reward.reset();
+		task.release(results_bytes, 2);
 	}
+	assert(max_bill_error < 1e-2 && max_reward_error < 1e-2);
+
+	// the CKKS files keep their original names
+	std::string suffix = (BILLING_CKKS == scheme) ? "" : std::string("_") + billing_scheme_name(scheme);
 
 	// Write client timings to file
-	std::string client_timing_fname = "timing_client_" + std::to_string(TIMESLOTS) + "_ts_" + std::to_string(NR_CLIENTS) + "_clients.txt";
+	std::string client_timing_fname = "timing_client_" + std::to_string(TIMESLOTS) + "_ts_" + std::to_string(NR_CLIENTS) + "_clients" + suffix + ".txt";
 	std::ofstream client_timing_file(client_timing_fname);
     std::ostream_iterator<std::int64_t> client_iterator(client_timing_file, "\n");
     std::copy(client_timings.begin(), client_timings.end(), client_iterator);
 
+	// Write offline/online client timings to file
+	std::string offline_timing_fname = "timing_client_offline_" + std::to_string(TIMESLOTS) + "_ts_" + std::to_string(NR_CLIENTS) + "_clients" + suffix + ".txt";
+	std::ofstream offline_timing_file(offline_timing_fname);
+	std::copy(client_offline_timings.begin(), client_offline_timings.end(), std::ostream_iterator<std::int64_t>(offline_timing_file, "\n"));
+	std::string online_timing_fname = "timing_client_online_" + std::to_string(TIMESLOTS) + "_ts_" + std::to_string(NR_CLIENTS) + "_clients" + suffix + ".txt";
+	std::ofstream online_timing_file(online_timing_fname);
+	std::copy(client_online_timings.begin(), client_online_timings.end(), std::ostream_iterator<std::int64_t>(online_timing_file, "\n"));
+
+	// the first clients again, with a relinearisation per product, against the same uploads billed with one per output
+	auto [outputs_ops, products_ops, outputs_us, products_us, public_key_us] = compare_relinearizations(
+		cc, keys, scheme, tradingPrice, feedInTarif, totalConsumers, totalProsumers,
+		totalDeviation, maskTotalDevPositive, maskTotalDevZero, maskTotalDevNegative);
+
+	auto mean = [](const std::vector<int64_t>& v) { return std::accumulate(v.begin(), v.end(), 0.0) / v.size(); };
+	if (BILLING_CKKS == scheme)
+		std::cout << "client_setup with the public key (first " << RELINEARIZATION_SAMPLE << " clients): "
+				  << (double) public_key_us / RELINEARIZATION_SAMPLE << " us"
+				  << ", offline: " << mean(client_offline_timings) << " us"
+				  << ", online: " << mean(client_online_timings) << " us"
+				  << ", pool memory per client: " << pool_bytes / 1024.0 / 1024.0 << " MiB"
+				  << std::endl;
+	std::cout << "scheme: " << billing_scheme_name(scheme)
+			  << " -> client_setup: " << mean(client_timings) << " us"
+			  << ", server_billing: " << mean(server_timings) << " us"
+			  << ", input ciphertext: " << input_bytes / 1024.0 << " KiB"
+			  << ", bill ciphertext: " << output_bytes / 1024.0 << " KiB"
+			  << ", max |bill - expectedBill|: " << max_bill_error
+			  << ", max |reward - expectedReward|: " << max_reward_error
+			  << std::endl;
+
+	std::cout << "key switches per client: " << (double) billing_ops.relinearizations / NR_CLIENTS
+			  << " (" << (double) billing_ops.mults / NR_CLIENTS << " mults)"
+			  << " -> first " << RELINEARIZATION_SAMPLE << " clients, relinearised per output: "
+			  << (double) outputs_ops.relinearizations / RELINEARIZATION_SAMPLE << " key switches, "
+			  << (double) outputs_us / RELINEARIZATION_SAMPLE << " us"
+			  << ", per product: " << (double) products_ops.relinearizations / RELINEARIZATION_SAMPLE << " key switches, "
+			  << (double) products_us / RELINEARIZATION_SAMPLE << " us"
+			  << std::endl;
+
+	if (archive)
+	{
+		auto flush_start = std::chrono::high_resolution_clock::now();
+		archive->flush();
+		auto flush_end = std::chrono::high_resolution_clock::now();
+		uint64_t archive_bytes = archive->data_bytes();
+		archive.reset();
+
+		// read back the bill of client 0 and check it against expectedBill
+		ArchiveReader reader(archive_path);
+		auto lookup_start = std::chrono::high_resolution_clock::now();
+		ArchiveRecord record = reader.lookup(0, 0);
+		const uint8_t* data = record.data;
+		Ciphertext<DCRTPoly> ct_bill = restore_ciphertext(cc, data, keys.secretKey->GetKeyTag());
+		auto lookup_end = std::chrono::high_resolution_clock::now();
+		std::vector<double> expectedBill = std::get<7>(load_client_data(0));
+		double archived_error = max_abs_difference(decrypt_billing(cc, keys.secretKey, ct_bill, scheme), expectedBill);
+		assert(archived_error <= max_bill_error);
+
+		std::cout << "archive: " << archive_path
+				  << " -> records: " << reader.size()
+				  << ", size: " << archive_bytes / 1024.0 / 1024.0 << " MiB"
+				  << ", append: " << (double) archive_us / NR_CLIENTS << " us per client"
+				  << ", final flush: " << std::chrono::duration_cast<std::chrono::microseconds>(flush_end - flush_start).count() << " us"
+				  << ", lookup and restore of a bill: " << std::chrono::duration_cast<std::chrono::microseconds>(lookup_end - lookup_start).count() << " us"
+				  << ", max |archived bill - expectedBill|: " << archived_error
+				  << std::endl;
+	}
+
+	std::cout << "memory budget: " << budget_bytes / 1024.0 / 1024.0 << " MiB"
+			  << " -> threads: " << n_threads
+			  << ", clients in flight: " << budget.high_water_tasks()
+			  << ", keys: " << keys_bytes / 1024.0 / 1024.0 << " MiB"
+			  << ", per client: " << budget.task_footprint_bytes() / 1024.0 / 1024.0 << " MiB"
+			  << ", high-water: " << budget.high_water_bytes() / 1024.0 / 1024.0 << " MiB"
+			  << " (" << budget.high_water_ciphertexts() << " ciphertexts)"
+			  << ", peak RSS: " << peak_rss_bytes() / 1024.0 / 1024.0 << " MiB"
+			  << std::endl;
+
 	// Write server timings to file
-	std::string server_timing_fname = "timing_server_" + std::to_string(TIMESLOTS) + "_ts_" + std::to_string(NR_CLIENTS) + "_clients.txt";
+	std::string server_timing_fname = "timing_server_" + std::to_string(TIMESLOTS) + "_ts_" + std::to_string(NR_CLIENTS) + "_clients" + suffix + ".txt";
 	std::ofstream server_billing_file(server_timing_fname);
     std::ostream_iterator<std::int64_t> server_iterator(server_billing_file, "\n");
     std::copy(server_timings.begin(), server_timings.end(), server_iterator);
 }
 
-int main()
+// ./setup_and_billing [ckks|bfv] [memory budget in MiB, 0: none] [result archive]
+int main(int argc, char* argv[])
 {
-	experiment();
+	BillingScheme scheme = (argc > 1) ? parse_billing_scheme(argv[1]) : BILLING_CKKS;
+	size_t budget_bytes = (argc > 2) ? std::stoull(argv[2]) * 1024 * 1024 : 0;
+	std::string archive_path = (argc > 3) ? argv[3] : "";
+	experiment(scheme, budget_bytes, archive_path);
 	return 0;
 }
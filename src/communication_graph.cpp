@@ -0,0 +1,156 @@
+#include "communication_graph.h"
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <cmath>
+
+using namespace std;
+
+
+size_t CommunicationGraph::n_edges() const {
+    size_t sum_degrees = 0;
+    for (int i = 0; i < n_users; i++)
+        sum_degrees += neighbours[i].size();
+    return sum_degrees / 2;
+}
+
+int CommunicationGraph::max_degree() const {
+    int d = 0;
+    for (int i = 0; i < n_users; i++)
+        d = max(d, (int) neighbours[i].size());
+    return d;
+}
+
+
+// sort the adjacency lists and remove repeated edges
+void normalize_neighbours(CommunicationGraph& graph){
+    for (int i = 0; i < graph.n_users; i++){
+        vector<int>& adj = graph.neighbours[i];
+        sort(adj.begin(), adj.end());
+        adj.erase(unique(adj.begin(), adj.end()), adj.end());
+    }
+}
+
+void add_edge(CommunicationGraph& graph, int i, int j){
+    if (i == j)
+        return;
+    graph.neighbours[i].push_back(j);
+    graph.neighbours[j].push_back(i);
+}
+
+
+CommunicationGraph complete_graph(int n_users) {
+    CommunicationGraph graph;
+    graph.n_users = n_users;
+    graph.neighbours = vector<vector<int> >(n_users);
+    for (int i = 0; i < n_users; i++){
+        graph.neighbours[i].reserve(n_users - 1);
+        for (int j = 0; j < n_users; j++){
+            if (i != j)
+                graph.neighbours[i].push_back(j);
+        }
+    }
+    return graph;
+}
+
+
+CommunicationGraph harary_graph(int n_users, int k) {
+    if (k < 1 || k >= n_users)
+        throw std::invalid_argument("Harary graph needs 1 <= k < n_users.");
+
+    CommunicationGraph graph;
+    graph.n_users = n_users;
+    graph.neighbours = vector<vector<int> >(n_users);
+
+    for (int i = 0; i < n_users; i++){
+        for (int d = 1; d <= k / 2; d++)
+            add_edge(graph, i, (i + d) % n_users);
+    }
+    if (k % 2 == 1){
+        // connect each user to the one "across" the cycle
+        for (int i = 0; i < (n_users + 1) / 2; i++)
+            add_edge(graph, i, (i + n_users / 2) % n_users);
+    }
+    normalize_neighbours(graph);
+    return graph;
+}
+
+
+CommunicationGraph random_expander_graph(int n_users, int k, unsigned int seed) {
+    if (k < 2 || k >= n_users)
+        throw std::invalid_argument("Expander graph needs 2 <= k < n_users.");
+
+    CommunicationGraph graph;
+    graph.n_users = n_users;
+    graph.neighbours = vector<vector<int> >(n_users);
+
+    mt19937 rng(seed);
+    vector<int> perm(n_users);
+    iota(perm.begin(), perm.end(), 0);
+
+    for (int c = 0; c < k / 2; c++){
+        shuffle(perm.begin(), perm.end(), rng);
+        for (int t = 0; t < n_users; t++)
+            add_edge(graph, perm[t], perm[(t + 1) % n_users]);
+    }
+    normalize_neighbours(graph);
+    return graph;
+}
+
+
+CommunicationGraph generate_graph(GraphTopology topology, int n_users, int k, unsigned int seed) {
+    switch (topology){
+        case HARARY:
+            return harary_graph(n_users, k);
+        case EXPANDER:
+            return random_expander_graph(n_users, k, seed);
+        case COMPLETE:
+        default:
+            return complete_graph(n_users);
+    }
+}
+
+
+int log_degree(int n_users) {
+    int k = (int) ceil(log2((double) n_users));
+    k += k % 2;
+    k = max(k, 2);
+    return min(k, n_users - 1);
+}
+
+
+bool is_connected(const CommunicationGraph& graph) {
+    if (graph.n_users == 0)
+        return true;
+    vector<bool> visited(graph.n_users, false);
+    vector<int> stack = {0};
+    visited[0] = true;
+    int n_visited = 1;
+    while (!stack.empty()){
+        int i = stack.back();
+        stack.pop_back();
+        for (int j : graph.neighbours[i]){
+            if (!visited[j]){
+                visited[j] = true;
+                n_visited++;
+                stack.push_back(j);
+            }
+        }
+    }
+    return n_visited == graph.n_users;
+}
+
+
+const char* topology_name(GraphTopology topology) {
+    switch (topology){
+        case HARARY:
+            return "harary";
+        case EXPANDER:
+            return "expander";
+        case COMPLETE:
+        default:
+            return "complete";
+    }
+}
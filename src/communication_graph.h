@@ -0,0 +1,68 @@
+/**
+ *  Communication graphs for the pairwise-masking protocol.
+ *
+ *  Two users share a seed (and therefore a CSPRNG) iff they are adjacent in
+ *  the graph. The complete graph corresponds to the original scheme, in which
+ *  every user holds a seed with every other user, so it costs O(n) per user.
+ *  Sparse graphs of degree k bring this down to O(k) per user, while the shares
+ *  still sum to zero mod p for any graph.
+ *
+ *  Privacy of an honest user only requires that the honest users stay connected
+ *  once the corrupted ones are removed, which is why the sparse topologies below
+ *  are k-connected (Harary) or expanders of degree O(log n).
+ */
+
+#ifndef __COMMUNICATION_GRAPH
+#define __COMMUNICATION_GRAPH
+
+#include <vector>
+#include <cstddef>
+
+
+enum GraphTopology { COMPLETE, HARARY, EXPANDER };
+
+
+struct CommunicationGraph
+{
+    int n_users;
+
+    // neighbours[i] lists the users that share a seed with user i, sorted increasingly
+    std::vector<std::vector<int> > neighbours;
+
+    // number of (undirected) edges, i.e., number of pairwise seeds
+    size_t n_edges() const;
+
+    int max_degree() const;
+};
+
+
+/** Every pair of users is connected: n(n-1)/2 edges */
+CommunicationGraph complete_graph(int n_users);
+
+/**
+ *  Harary graph H_{k,n}: the k-connected graph on n vertices with the minimum
+ *  number of edges. User i is connected to i +- 1, ..., i +- k/2 (mod n) and,
+ *  if k is odd, also to the diametrically opposite user.
+ */
+CommunicationGraph harary_graph(int n_users, int k);
+
+/**
+ *  Union of k/2 random Hamiltonian cycles, which is an expander with high
+ *  probability and connected by construction. Degree is at most k.
+ */
+CommunicationGraph random_expander_graph(int n_users, int k, unsigned int seed);
+
+/**
+ *  Builds a graph of the given topology. The degree k is ignored for the
+ *  complete graph.
+ */
+CommunicationGraph generate_graph(GraphTopology topology, int n_users, int k, unsigned int seed = 0);
+
+/** Suggested degree for the sparse topologies: smallest even number >= log2(n_users) */
+int log_degree(int n_users);
+
+bool is_connected(const CommunicationGraph& graph);
+
+const char* topology_name(GraphTopology topology);
+
+#endif
@@ -3,6 +3,11 @@
 #include <iostream>
 #include <cassert>
 #include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <cstring>
+#include <endian.h>
 
 
 using namespace std;
@@ -41,23 +46,97 @@ void set_vec_iv_msg(uint8_t* vec, int nblocks, int iv){
 }
 
 
+/**
+ *  Populates vec with the counter blocks first_block, ..., first_block + nblocks - 1
+ *  of the given round: the first 8 bytes store the block counter and the last 8
+ *  bytes store the round, both in little-endian order.
+ */
+void set_vec_round_msg(uint8_t* vec, int nblocks, uint64_t round, uint64_t first_block){
+    const uint64_t round_le = htole64(round);
+    for (int i = 0; i < nblocks; i++){
+        uint64_t block_le = htole64(first_block + i);
+        memcpy(vec + 16*i, &block_le, 8);
+        memcpy(vec + 16*i + 8, &round_le, 8);
+    }
+}
+
+
 /**
  *  encypt msg inplace (i.e., msg = AES.enc(mgs))
  *  Assumes that msg has 16*nblocks entries
  */
-void enc_blocks(struct AES_ctx* ctx, uint8_t* msg, int nblocks){
+void enc_blocks(const struct AES_ctx* ctx, uint8_t* msg, int nblocks){
     for (int i = 0; i < nblocks; ++i) {
       AES_ECB_encrypt(ctx, msg + (i * 16)); // encrypts i-th block (16 bytes = 128 bits)
     }
 }
 
 
+bool aes_backend_supported(AESBackend backend){
+    switch (backend){
+        case AES_TINY:
+        case AES_BITSLICED:
+            return true;
+        case AES_NI:
+            return cpu_supports_aesni();
+        case AES_VAES:
+            return cpu_supports_vaes_avx512() || cpu_supports_vaes_avx2();
+        default:
+            return false;
+    }
+}
+
+AESBackend best_aes_backend(){
+    if (aes_backend_supported(AES_VAES))
+        return AES_VAES;
+    if (aes_backend_supported(AES_NI))
+        return AES_NI;
+    return AES_BITSLICED;
+}
+
+static AESBackend default_aes_backend = best_aes_backend();
+
+// VAES kernel for this host, chosen once
+static bool vaes_use_avx512 = cpu_supports_vaes_avx512();
+
+void set_aes_backend(AESBackend backend){
+    if (!aes_backend_supported(backend))
+        throw std::invalid_argument(std::string("AES backend not supported by this CPU: ") + aes_backend_name(backend));
+    default_aes_backend = backend;
+}
+
+AESBackend get_aes_backend(){
+    return default_aes_backend;
+}
+
+const char* aes_backend_name(AESBackend backend){
+    switch (backend){
+        case AES_TINY:
+            return "tiny-aes";
+        case AES_BITSLICED:
+            return "bitsliced";
+        case AES_NI:
+            return "aes-ni";
+        case AES_VAES:
+            return "vaes";
+        default:
+            return "unknown";
+    }
+}
+
+
 CSPRNG::CSPRNG(int8_t* _aes_key) {
     for(int i = 0; i < 16; i++)
         this->aes_key[i] = (uint8_t) _aes_key[i];
 
     AES_init_ctx(&(this->ctx), aes_key);
 
+    this->backend = default_aes_backend;
+    if (AES_BITSLICED == this->backend)
+        aes128_bs_load_key(aes_key, &(this->bs_key));
+    else if (AES_NI == this->backend || AES_VAES == this->backend)
+        aes128_ni_load_key(aes_key, &(this->ni_key));
+
     this->nbytes = 0;
     this->used_bytes = 0;
     this->iv = 0;
@@ -189,6 +268,57 @@ void CSPRNG::get_random_binary_vector(vector<int>& vec, int vec_size){
     this->used_bytes += needed_bytes;
 }
 
+void CSPRNG::keystream_blocks(uint64_t round, uint64_t first_block, int nblocks, uint8_t* out) const{
+    switch (this->backend){
+        case AES_VAES:
+            // counter blocks are built in registers
+            if (vaes_use_avx512)
+                aes128_vaes512_ctr_blocks(&(this->ni_key), round, first_block, nblocks, out);
+            else
+                aes128_vaes256_ctr_blocks(&(this->ni_key), round, first_block, nblocks, out);
+            break;
+        case AES_NI:
+            aes128_ni_ctr_blocks(&(this->ni_key), round, first_block, nblocks, out);
+            break;
+        case AES_BITSLICED:
+            set_vec_round_msg(out, nblocks, round, first_block);
+            aes128_bs_enc_blocks(&(this->bs_key), out, out, nblocks);
+            break;
+        default:
+            set_vec_round_msg(out, nblocks, round, first_block);
+            enc_blocks(&(this->ctx), out, nblocks);
+    }
+}
+
+
+void CSPRNG::round_random_ints(uint64_t round, uint64_t first_slot, int n_slots, uint32_t modulus, uint32_t* out) const{
+    const int chunk = 64; // number of blocks generated at a time
+    uint8_t buf[16 * chunk];
+
+    uint64_t block = first_slot / INTS_PER_BLOCK;
+    int offset = first_slot % INTS_PER_BLOCK; // first integer used from the first block
+    int done = 0;
+    while (done < n_slots){
+        int nblocks = min(chunk, (offset + n_slots - done + INTS_PER_BLOCK - 1) / INTS_PER_BLOCK);
+        keystream_blocks(round, block, nblocks, buf);
+
+        int n = min(nblocks * INTS_PER_BLOCK - offset, n_slots - done);
+        const uint8_t* b = buf + 8 * offset;
+        for (int i = 0; i < n; i++){
+            // little-endian 64-bit integer, so the reduction mod modulus is off uniform by < modulus / 2^64
+            uint64_t r = 0;
+            for (int j = 7; j >= 0; j--)
+                r = (r << 8) | b[8*i + j];
+            out[done + i] = r % modulus;
+        }
+        done += n;
+        block += nblocks;
+        offset = 0;
+    }
+}
+
+
+
         
 int CSPRNG::available_bytes() const{
     return nbytes - used_bytes;
@@ -7,8 +7,38 @@
 
 #include <vector>
 #include <random>
+#include <cstdint>
 
 #include "tiny-aes/aes.hpp" // from https://github.com/kokke/tiny-AES-c 
+#include "aes_bitsliced.h"
+#include "aes_ni_ctr.h"
+
+
+/**
+ *  AES implementation used by the keystream methods of the CSPRNG. All of them
+ *  produce the same keystream, so shares stay compatible across hosts.
+ *  - AES_TINY: byte-oriented, table-based tiny-AES, one block at a time.
+ *  - AES_BITSLICED: constant-time bitsliced AES on SSE2/AVX2 registers.
+ *  - AES_NI: AES-NI instructions, one block per instruction.
+ *  - AES_VAES: VAES instructions, 4 (AVX-512) or 2 (AVX2) blocks per instruction.
+ */
+enum AESBackend { AES_TINY, AES_BITSLICED, AES_NI, AES_VAES };
+
+// Whether this host has the instructions needed by the backend (checked with cpuid)
+bool aes_backend_supported(AESBackend backend);
+
+// Fastest backend supported by this host
+AESBackend best_aes_backend();
+
+/**
+ *  Selects the backend of the CSPRNGs created from now on. The default is
+ *  best_aes_backend(). Throws if the host does not support it.
+ */
+void set_aes_backend(AESBackend backend);
+
+AESBackend get_aes_backend();
+
+const char* aes_backend_name(AESBackend backend);
 
 
 class CSPRNG
@@ -27,6 +57,14 @@ class CSPRNG
 
         struct AES_ctx ctx; // stores keys for each round of AES
 
+        AESBackend backend; // implementation used by keystream_blocks
+
+        // key schedule of the backend, if it is not tiny-AES
+        union {
+            AESBitslicedKey bs_key;
+            AESNIKey ni_key;
+        };
+
         CSPRNG(int8_t* _aes_key);
 
         void generate_random_bytes(int iv, int nbytes);
@@ -62,6 +100,26 @@ class CSPRNG
 		void get_random_binary_vector(std::vector<int>& vec, int vec_size);
 
 
+        /**
+         *      Random-access keystream: block b of round r is AES.enc(b || r), where b and r
+         *  are 64-bit counters stored in little-endian order. Any block of any round is
+         *  computed in O(1), without generating the previous ones, so rounds can be
+         *  generated out of order, in parallel, or replayed after a crash.
+         *      These methods do not use the randomness pool, so they can be called
+         *  concurrently on the same CSPRNG.
+         */
+        void keystream_blocks(uint64_t round, uint64_t first_block, int nblocks, uint8_t* out) const;
+
+        /**
+         *      Writes in out[0, ..., n_slots-1] the random elements of {0, 1, ..., modulus-1}
+         *  for the time slots first_slot, ..., first_slot + n_slots - 1 of the given round.
+         *  Time slot s is the 64-bit integer in bytes 8s to 8s+7 of the round's keystream,
+         *  that is, in block s / INTS_PER_BLOCK, reduced mod modulus. Requires modulus < 2^32.
+         */
+        void round_random_ints(uint64_t round, uint64_t first_slot, int n_slots, uint32_t modulus, uint32_t* out) const;
+
+        static const int INTS_PER_BLOCK = 2;
+
         /**
          *  Return the number of random bytes still available in the randomness pool.
          *  If it returns zero, run generate_random_bytes again with new iv.
@@ -0,0 +1,87 @@
+#include "directory_watcher.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <dirent.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+
+// events read at once
+static const size_t EVENT_BUFFER_BYTES = 64 * (sizeof(struct inotify_event) + NAME_MAX + 1);
+
+
+// regular files of dir
+static std::vector<std::string> list_files(const std::string &dir)
+{
+	std::vector<std::string> names;
+	DIR *d = opendir(dir.c_str());
+	if (nullptr == d)
+		throw std::runtime_error("cannot list " + dir + ": " + strerror(errno));
+	while (struct dirent *entry = readdir(d))
+		if ((DT_REG == entry->d_type || DT_UNKNOWN == entry->d_type) && '.' != entry->d_name[0])
+			names.push_back(entry->d_name);
+	closedir(d);
+	return names;
+}
+
+
+DirectoryWatcher::DirectoryWatcher(const std::string &dir)
+	: dir(dir), buffer(EVENT_BUFFER_BYTES)
+{
+	fd = inotify_init1(IN_CLOEXEC);
+	if (fd < 0)
+		throw std::runtime_error(std::string("inotify_init1: ") + strerror(errno));
+
+	// the watch starts before the listing, so that no file is missed in between
+	if (inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+	{
+		close(fd);
+		throw std::runtime_error("cannot watch " + dir + ": " + strerror(errno));
+	}
+	initial = list_files(dir);
+}
+
+DirectoryWatcher::~DirectoryWatcher()
+{
+	close(fd);
+}
+
+std::vector<std::string> DirectoryWatcher::wait(int timeout_ms)
+{
+	std::vector<std::string> names;
+	names.swap(initial);
+	if (!names.empty())
+		timeout_ms = 0;
+
+	struct pollfd pfd = {fd, POLLIN, 0};
+	int ready = poll(&pfd, 1, timeout_ms);
+	if (ready < 0 && EINTR != errno)
+		throw std::runtime_error(std::string("poll: ") + strerror(errno));
+	if (ready <= 0)
+		return names;
+
+	ssize_t n = read(fd, buffer.data(), buffer.size());
+	if (n < 0)
+		throw std::runtime_error(std::string("reading the inotify events: ") + strerror(errno));
+	for (ssize_t at = 0; at < n; )
+	{
+		const struct inotify_event *event = (const struct inotify_event*) (buffer.data() + at);
+		if (event->mask & IN_Q_OVERFLOW)
+		{
+			std::vector<std::string> all = list_files(dir);
+			names.insert(names.end(), all.begin(), all.end());
+		}
+		else if (event->len > 0 && !(event->mask & IN_ISDIR) && '.' != event->name[0])
+			names.push_back(event->name);
+		at += sizeof(struct inotify_event) + event->len;
+	}
+	return names;
+}
+
+const std::string &DirectoryWatcher::directory() const
+{
+	return dir;
+}
@@ -0,0 +1,43 @@
+/**
+ *  Files arriving in a directory, with inotify: a file has arrived once it is
+ *  closed after being written, or moved into the directory. Files should be
+ *  written under a hidden name (starting with '.') and moved in, or written in
+ *  place and closed, so that a file is complete when it is reported. Hidden
+ *  files are not reported.
+ */
+
+#ifndef __DIRECTORY_WATCHER
+#define __DIRECTORY_WATCHER
+
+#include <string>
+#include <vector>
+
+
+class DirectoryWatcher
+{
+	std::string dir;
+	int fd = -1;
+	std::vector<std::string> initial; // files already in dir when the watch started
+	std::vector<char> buffer;
+
+	public:
+
+		// throws std::runtime_error if dir cannot be watched
+		explicit DirectoryWatcher(const std::string &dir);
+		DirectoryWatcher(const DirectoryWatcher&) = delete;
+		DirectoryWatcher& operator=(const DirectoryWatcher&) = delete;
+		~DirectoryWatcher();
+
+		/**
+		 *  Names of the files that arrived since the last call, waiting up to
+		 *  timeout_ms for one (-1: no timeout); empty on timeout. The first call
+		 *  also returns the files that were in dir before the watch started. If
+		 *  the events overflow, all the files of dir are returned again, so a
+		 *  file may be returned more than once.
+		 */
+		std::vector<std::string> wait(int timeout_ms = -1);
+
+		const std::string &directory() const;
+};
+
+#endif
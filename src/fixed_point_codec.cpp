@@ -0,0 +1,131 @@
+#include "fixed_point_codec.h"
+
+#include <stdexcept>
+#include <string>
+#include <cmath>
+
+#include <immintrin.h>
+
+using namespace std;
+
+
+FixedPointCodec::FixedPointCodec(uint32_t modulus, int n_users, double scale) {
+    if (modulus >= (1u << 30))
+        throw std::invalid_argument("FixedPointCodec assumes a modulus smaller than 2^30.");
+    if (n_users < 1)
+        throw std::invalid_argument("FixedPointCodec needs at least one user.");
+    this->modulus = modulus;
+    this->n_users = n_users;
+    this->scale = scale;
+    // n_users values of absolute value at most max_abs_encoded add up to at most (p-1)/2
+    this->max_abs_encoded = ((modulus - 1) / 2) / n_users;
+    if (0 == max_abs_encoded)
+        throw std::invalid_argument("The modulus is too small to add up the values of " + to_string(n_users) + " users.");
+}
+
+
+double FixedPointCodec::max_abs_value() const{
+    return max_abs_encoded / scale;
+}
+
+
+/**
+ *  out[t] = (round(values[t] * scale) + masks[t]) mod modulus for t < n, or without
+ *  the mask if masks is null. Returns false if some |round(values[t] * scale)| > bound.
+ */
+static bool encode_and_add_scalar(const double* values, const uint32_t* masks, int n, uint32_t* out,
+                                  uint32_t modulus, double scale, int64_t bound){
+    bool in_range = true;
+    for (int t = 0; t < n; t++){
+        double x = std::nearbyint(values[t] * scale);
+        if (!(std::fabs(x) <= bound)){
+            in_range = false;
+            continue;
+        }
+        int64_t e = (int64_t) x;
+        if (e < 0)
+            e += modulus;
+        if (masks){
+            e += masks[t];
+            if (e >= modulus)
+                e -= modulus;
+        }
+        out[t] = (uint32_t) e;
+    }
+    return in_range;
+}
+
+/** Same as encode_and_add_scalar, with AVX2 (4 values at a time). Selected at runtime. */
+__attribute__((target("avx2")))
+static bool encode_and_add_avx2(const double* values, const uint32_t* masks, int n, uint32_t* out,
+                                uint32_t modulus, double scale, int64_t bound){
+    int t = 0;
+    const __m256d vscale = _mm256_set1_pd(scale);
+    const __m256d vbound = _mm256_set1_pd((double) bound);
+    const __m256d sign_bit = _mm256_set1_pd(-0.0);
+    const __m128i p = _mm_set1_epi32(modulus);
+    __m256d out_of_range = _mm256_setzero_pd();
+    for (; t + 4 <= n; t += 4){
+        __m256d x = _mm256_mul_pd(_mm256_loadu_pd(values + t), vscale);
+        x = _mm256_round_pd(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        // !(|x| <= bound) also flags NaN
+        out_of_range = _mm256_or_pd(out_of_range, _mm256_cmp_pd(_mm256_andnot_pd(sign_bit, x), vbound, _CMP_NLE_UQ));
+
+        // |x| < 2^29, so it fits in a signed 32-bit lane; negative values get + p
+        __m128i e = _mm256_cvtpd_epi32(x);
+        e = _mm_add_epi32(e, _mm_and_si128(_mm_srai_epi32(e, 31), p));
+        if (masks){
+            // e, mask < p < 2^30: the sum does not overflow, and min(s, s - p) reduces it
+            __m128i s = _mm_add_epi32(e, _mm_loadu_si128((const __m128i*) (masks + t)));
+            e = _mm_min_epu32(s, _mm_sub_epi32(s, p));
+        }
+        _mm_storeu_si128((__m128i*) (out + t), e);
+    }
+    bool in_range = _mm256_testz_pd(out_of_range, out_of_range);
+    bool tail_in_range = encode_and_add_scalar(values + t, masks ? masks + t : nullptr, n - t, out + t, modulus, scale, bound);
+    return in_range && tail_in_range;
+}
+
+static bool cpu_supports_avx2(){
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+static const bool use_avx2 = cpu_supports_avx2();
+
+static bool encode_and_add(const double* values, const uint32_t* masks, int n, uint32_t* out,
+                           uint32_t modulus, double scale, int64_t bound){
+    if (use_avx2)
+        return encode_and_add_avx2(values, masks, n, out, modulus, scale, bound);
+    return encode_and_add_scalar(values, masks, n, out, modulus, scale, bound);
+}
+
+
+void FixedPointCodec::encode(const double* values, int n, uint32_t* out) const{
+    if (!encode_and_add(values, nullptr, n, out, modulus, scale, max_abs_encoded))
+        throw std::overflow_error("Value out of the range of the fixed-point encoding (|v| <= " + to_string(max_abs_value()) + ").");
+}
+
+
+void FixedPointCodec::mask(const double* values, const uint32_t* masks, int n, uint32_t* shares) const{
+    if (!encode_and_add(values, masks, n, shares, modulus, scale, max_abs_encoded))
+        throw std::overflow_error("Value out of the range of the fixed-point encoding (|v| <= " + to_string(max_abs_value()) + ").");
+}
+
+
+vector<double> FixedPointCodec::decode(const vector<uint32_t>& sums) const{
+    vector<double> res(sums.size());
+    for (size_t t = 0; t < sums.size(); t++)
+        res[t] = centered_lift(sums[t], modulus) / scale;
+    return res;
+}
+
+
+vector<double> FixedPointCodec::decode(const ShareAggregator& aggregator) const{
+    if (aggregator.modulus != modulus)
+        throw std::invalid_argument("The aggregator and the codec use different moduli.");
+    if (aggregator.n_shares > n_users)
+        throw std::overflow_error("The aggregator holds " + to_string(aggregator.n_shares) + " shares, but the codec is sized for "
+                                  + to_string(n_users) + " users.");
+    return aggregator.decode(scale);
+}
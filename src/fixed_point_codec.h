@@ -0,0 +1,63 @@
+/**
+ *  Fixed-point encoding of real values (e.g., the individual deviations) into Z_p.
+ *
+ *  A value v is encoded as round(v * scale) mod p, with negative values mapped to
+ *  the upper half of Z_p, so that adding the pairwise masks turns the encodings
+ *  into shares and the sum of all the shares of a time slot is the encoding of
+ *  the total. The total is decoded with a centered lift, which is only correct
+ *  if |sum| <= (p - 1) / 2, so the codec is sized to the number of users: each
+ *  encoded value must satisfy |round(v * scale)| <= (p - 1) / (2 * n_users).
+ */
+
+#ifndef __FIXED_POINT_CODEC
+#define __FIXED_POINT_CODEC
+
+#include <cstdint>
+#include <vector>
+
+#include "share_aggregator.h"
+
+
+class FixedPointCodec
+{
+    public:
+
+        uint32_t modulus;
+        int n_users; // number of encodings that may be added up
+        double scale;
+
+        int64_t max_abs_encoded; // largest |round(v * scale)| accepted by encode
+
+        /**
+         *  Throws if the modulus does not fit in 30 bits or if it is too small to
+         *  decode the sum of n_users values, even with a single unit each.
+         */
+        FixedPointCodec(uint32_t modulus, int n_users, double scale = FIXED_POINT_SCALE);
+
+        // largest |v| that can be encoded, i.e., max_abs_encoded / scale
+        double max_abs_value() const;
+
+        /**
+         *  out[t] = round(values[t] * scale) mod modulus for t < n.
+         *  Throws std::overflow_error if some value is out of range (or NaN).
+         */
+        void encode(const double* values, int n, uint32_t* out) const;
+
+        /**
+         *  shares[t] = (encode(values[t]) + masks[t]) mod modulus for t < n, with the
+         *  masks in {0, ..., modulus-1}. masks and shares may alias.
+         *  Throws std::overflow_error like encode.
+         */
+        void mask(const double* values, const uint32_t* masks, int n, uint32_t* shares) const;
+
+        /** Returns the real values encoded by the sums in {0, ..., modulus-1} */
+        std::vector<double> decode(const std::vector<uint32_t>& sums) const;
+
+        /**
+         *  Returns the totals accumulated in the aggregator. Throws std::overflow_error
+         *  if it holds more than n_users shares, since the totals could have wrapped around.
+         */
+        std::vector<double> decode(const ShareAggregator& aggregator) const;
+};
+
+#endif
@@ -0,0 +1,353 @@
+/**
+ *  Incremental ingestion of a round: the data directory is watched with
+ *  inotify (DirectoryWatcher), and every user_<id>.csv is parsed and encrypted
+ *  with client_setup as soon as it arrives. The encrypted clients are billed
+ *  once context.csv arrives, and the clients that arrive after it right away,
+ *  so that the round closes shortly after the last arrival instead of after
+ *  processing the whole population, e.g.
+ *      ./ingest_billing --dir incoming --replay <data directory> --interval 50 --threads 4
+ *
+ *  With --replay, the files of a data directory are moved into --dir one by
+ *  one, every --interval ms: the user files in a random order, then
+ *  context.csv (after --context-after user files, default all of them). Without
+ *  it, another process delivers the files into --dir (default data_directory()).
+ *  One thread watches; the others encrypt and bill.
+ *
+ *  Reports the round-close latency (from the last arrival to the last bill)
+ *  and, with --batch 1, the time to load, encrypt and bill all the clients
+ *  once all the files are there, as setup_and_billing does.
+ */
+
+#include "billing.h"
+#include "directory_watcher.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <random>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cctype>
+#include <fstream>
+#include <algorithm>
+
+
+struct IngestSettings
+{
+    std::string dir;
+    std::string replay;
+    int interval_ms = 50;
+    int clients = NR_CLIENTS;
+    int context_after = -1; // -1: after all the user files
+    int threads = 2;
+    bool batch = false;
+    BillingScheme scheme = BILLING_CKKS;
+};
+
+typedef std::tuple<Ciphertext<DCRTPoly>, Ciphertext<DCRTPoly>, Ciphertext<DCRTPoly>,
+                   Ciphertext<DCRTPoly>, Ciphertext<DCRTPoly>> Uploads;
+
+struct IngestedClient
+{
+    Uploads uploads;
+    std::vector<double> retailPrice;
+    std::vector<double> expectedBill;
+    std::vector<double> expectedReward;
+};
+
+
+IngestSettings parse_arguments(int argc, char* argv[])
+{
+    IngestSettings settings;
+    settings.dir = data_directory();
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string option = argv[i];
+        std::string value = argv[i + 1];
+        if (option == "--dir")
+            settings.dir = value;
+        else if (option == "--replay")
+            settings.replay = value;
+        else if (option == "--interval")
+            settings.interval_ms = stoi(value);
+        else if (option == "--clients")
+            settings.clients = stoi(value);
+        else if (option == "--context-after")
+            settings.context_after = stoi(value);
+        else if (option == "--threads")
+            settings.threads = stoi(value);
+        else if (option == "--batch")
+            settings.batch = stoi(value);
+        else if (option == "--scheme")
+            settings.scheme = parse_billing_scheme(value);
+        else
+            throw std::invalid_argument("unknown option " + option);
+    }
+    if (settings.threads < 2)
+        throw std::invalid_argument("--threads must be at least 2: one thread watches the directory");
+    return settings;
+}
+
+// largest |x[i] - y[i]|
+double max_abs_difference(const std::vector<double>& x, const std::vector<double>& y)
+{
+    double diff = 0.0;
+    for (unsigned int i = 0; i < x.size(); i++)
+        diff = std::max(diff, std::fabs(x[i] - y[i]));
+    return diff;
+}
+
+// id of user_<id>.csv, -1 for other names
+int client_of_file(const std::string& name)
+{
+    const std::string prefix = "user_", suffix = ".csv";
+    if (name.size() <= prefix.size() + suffix.size() || 0 != name.compare(0, prefix.size(), prefix)
+        || 0 != name.compare(name.size() - suffix.size(), suffix.size(), suffix))
+        return -1;
+    std::string digits = name.substr(prefix.size(), name.size() - prefix.size() - suffix.size());
+    if (!std::all_of(digits.begin(), digits.end(), ::isdigit))
+        return -1;
+    return stoi(digits);
+}
+
+/**
+ *  Moves the files of the round from source into dir, one every interval_ms:
+ *  each is copied to a hidden temporary file of dir, then renamed, so that it
+ *  arrives complete.
+ */
+void replay_round(const IngestSettings& settings)
+{
+    std::vector<std::string> names;
+    for (int id = 0; id < settings.clients; id++)
+        names.push_back("user_" + std::to_string(id) + ".csv");
+    std::mt19937_64 rng(1);
+    std::shuffle(names.begin(), names.end(), rng);
+    int context_at = (settings.context_after < 0) ? settings.clients : std::min(settings.context_after, settings.clients);
+    names.insert(names.begin() + context_at, "context.csv");
+
+    for (const std::string& name : names)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(settings.interval_ms));
+        std::string tmp = settings.dir + "/." + name + ".tmp";
+        {
+            std::ifstream src(settings.replay + "/" + name, std::ios::binary);
+            std::ofstream dst(tmp, std::ios::binary);
+            if (!src.is_open() || !dst.is_open())
+                throw std::runtime_error("cannot copy " + name + " from " + settings.replay);
+            dst << src.rdbuf();
+        }
+        if (0 != std::rename(tmp.c_str(), (settings.dir + "/" + name).c_str()))
+            throw std::runtime_error("cannot move " + tmp);
+    }
+}
+
+
+void ingest_experiment(const IngestSettings& settings)
+{
+    BillingScheme scheme = settings.scheme;
+    CryptoContext<DCRTPoly> cc = billing_crypto_context(scheme);
+    auto keys = cc->KeyGen();
+    cc->EvalMultKeyGen(keys.secretKey);
+    const PublicKey<DCRTPoly> &pk = keys.publicKey;
+
+    // the watch starts before the replay, so that no file is missed
+    DirectoryWatcher watcher(settings.dir);
+    std::thread replay;
+    if (!settings.replay.empty())
+        replay = std::thread(replay_round, std::cref(settings));
+
+    // shared by the tasks, under mutex
+    std::mutex mutex;
+    bool context_ready = false;
+    std::vector<int> waiting;                                // encrypted, waiting for context.csv
+    std::map<std::vector<double>, TariffPlaintexts> tariffs; // by retail price
+    std::vector<IngestedClient> clients(settings.clients);
+    std::vector<Ciphertext<DCRTPoly>> bills(settings.clients), rewards(settings.clients);
+
+    // written before context_ready is set, then only read
+    std::vector<double> tradingPrice, totalConsumers, totalDeviation;
+    RoundPlaintexts round;
+
+    auto bill_client = [&](int id)
+    {
+        IngestedClient& client = clients[id];
+        TariffPlaintexts tariff;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = tariffs.find(client.retailPrice);
+            if (tariffs.end() != it)
+                tariff = it->second;
+        }
+        if (nullptr == tariff.retailPrice)
+        {
+            // encoded outside the lock; two clients of a new tariff may both encode it
+            tariff = encode_tariff_plaintexts(cc, pk, tradingPrice, client.retailPrice, totalConsumers, totalDeviation, scheme, round.plan);
+            std::lock_guard<std::mutex> lock(mutex);
+            tariffs.emplace(client.retailPrice, tariff);
+        }
+        auto [ct_consumption, ct_supplies, ct_deviations, ct_signs, ct_accepted] = std::move(client.uploads);
+        std::tie(bills[id], rewards[id]) = server_billing(cc, round, tariff, std::move(ct_consumption), std::move(ct_supplies),
+                                                          std::move(ct_deviations), std::move(ct_signs), std::move(ct_accepted));
+    };
+
+    // Bills the client if context.csv was processed, else queues it for the
+    // context. The tasks read context_ready through this lambda: GCC (12) gives
+    // a task a copy of a scalar local whose address is never taken, even when it
+    // is shared, so a task that read it directly saw the value from its creation
+    // and queued its client after the context had gone, never to be billed.
+    auto client_encrypted = [&](int id)
+    {
+        bool bill_now;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            bill_now = context_ready;
+            if (!bill_now)
+                waiting.push_back(id);
+        }
+        if (bill_now)
+            bill_client(id);
+    };
+
+    std::vector<bool> arrived(settings.clients, false);
+    int n_arrived = 0;
+    bool context_arrived = false;
+    auto begin = std::chrono::high_resolution_clock::now();
+    auto last_arrival = begin;
+    int64_t encrypted_at_context = 0;
+    #pragma omp parallel num_threads(settings.threads)
+    #pragma omp single
+    {
+        while (n_arrived < settings.clients || !context_arrived)
+        {
+            for (const std::string& name : watcher.wait())
+            {
+                int id = client_of_file(name);
+                if (id >= 0 && id < settings.clients && !arrived[id])
+                {
+                    arrived[id] = true;
+                    n_arrived++;
+                    last_arrival = std::chrono::high_resolution_clock::now();
+                    std::string fname = settings.dir + "/" + name;
+                    #pragma omp task firstprivate(id, fname)
+                    {
+                        auto [
+                            consumptions,
+                            supplies,
+                            consumption_promise,
+                            supply_promise,
+                            retailPrice,
+                            accepted,
+                            deviations,
+                            expectedBill,
+                            expectedReward
+                        ] = load_client_file(fname);
+                        clients[id] = {client_setup(cc, pk, consumptions, supplies, deviations, accepted, scheme),
+                                       retailPrice, expectedBill, expectedReward};
+                        client_encrypted(id);
+                    }
+                }
+                else if ("context.csv" == name && !context_arrived)
+                {
+                    context_arrived = true;
+                    last_arrival = std::chrono::high_resolution_clock::now();
+                    auto [
+                        feedInTarif,
+                        contextTradingPrice,
+                        totalProsumers,
+                        contextTotalConsumers,
+                        contextTotalDeviation
+                    ] = load_context_file(settings.dir + "/" + name);
+                    tradingPrice = contextTradingPrice;
+                    totalConsumers = contextTotalConsumers;
+                    totalDeviation = contextTotalDeviation;
+                    auto [maskTotalDevPositive, maskTotalDevZero, maskTotalDevNegative] = server_setup(totalDeviation);
+                    BillingPlan plan = plan_billing(totalConsumers, totalProsumers, maskTotalDevPositive, maskTotalDevNegative);
+                    round = encode_round_plaintexts(cc, pk, tradingPrice, feedInTarif, totalProsumers, totalDeviation,
+                                                    maskTotalDevPositive, maskTotalDevNegative, scheme, plan);
+
+                    std::vector<int> ready;
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        context_ready = true;
+                        ready.swap(waiting);
+                    }
+                    encrypted_at_context = ready.size();
+                    for (int ready_id : ready)
+                    {
+                        #pragma omp task firstprivate(ready_id)
+                        bill_client(ready_id);
+                    }
+                }
+            }
+        }
+        #pragma omp taskwait
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    if (replay.joinable())
+        replay.join();
+
+    double max_bill_error = 0.0, max_reward_error = 0.0;
+    for (int id = 0; id < settings.clients; id++)
+    {
+        max_bill_error = std::max(max_bill_error, max_abs_difference(decrypt_billing(cc, keys.secretKey, bills[id], scheme), clients[id].expectedBill));
+        max_reward_error = std::max(max_reward_error, max_abs_difference(decrypt_billing(cc, keys.secretKey, rewards[id], scheme), clients[id].expectedReward));
+    }
+    assert(max_bill_error < 1e-2 && max_reward_error < 1e-2);
+
+    // Batch: all the files are there; load, encrypt and bill every client
+    int64_t batch_us = -1;
+    if (settings.batch)
+    {
+        auto batch_begin = std::chrono::high_resolution_clock::now();
+        auto [feedInTarif, batchTradingPrice, totalProsumers, batchTotalConsumers, batchTotalDeviation]
+            = load_context_file(settings.dir + "/context.csv");
+        auto [maskTotalDevPositive, maskTotalDevZero, maskTotalDevNegative] = server_setup(batchTotalDeviation);
+        #pragma omp parallel for num_threads(settings.threads) schedule(dynamic)
+        for (int id = 0; id < settings.clients; id++)
+        {
+            auto [
+                consumptions,
+                supplies,
+                consumption_promise,
+                supply_promise,
+                retailPrice,
+                accepted,
+                deviations,
+                expectedBill,
+                expectedReward
+            ] = load_client_file(settings.dir + "/user_" + std::to_string(id) + ".csv");
+            auto [ct_consumption, ct_supplies, ct_deviations, ct_signs, ct_accepted]
+                = client_setup(cc, pk, consumptions, supplies, deviations, accepted, scheme);
+            server_billing(cc, pk, batchTradingPrice, retailPrice, feedInTarif, batchTotalConsumers, totalProsumers,
+                           batchTotalDeviation, maskTotalDevPositive, maskTotalDevZero, maskTotalDevNegative,
+                           std::move(ct_consumption), std::move(ct_supplies), std::move(ct_deviations),
+                           std::move(ct_signs), std::move(ct_accepted), scheme);
+        }
+        batch_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - batch_begin).count();
+    }
+
+    // Display results
+    std::cout << "scheme: " << billing_scheme_name(scheme) << ", "
+              << "nr_clients: " << settings.clients << ", "
+              << "threads: " << settings.threads
+              << " -> arrivals: " << std::chrono::duration_cast<std::chrono::microseconds>(last_arrival - begin).count() << " us"
+              << ", encrypted when context.csv arrived: " << encrypted_at_context
+              << ", round close after the last arrival: " << std::chrono::duration_cast<std::chrono::microseconds>(end - last_arrival).count() << " us";
+    if (settings.batch)
+        std::cout << " (batch: " << batch_us << " us)";
+    std::cout << ", max |bill - expectedBill|: " << max_bill_error
+              << ", max |reward - expectedReward|: " << max_reward_error
+              << std::endl;
+}
+
+
+int main(int argc, char* argv[])
+{
+    ingest_experiment(parse_arguments(argc, argv));
+    return 0;
+}
@@ -0,0 +1,106 @@
+/**
+ *  Microbenchmark of the CSPRNG keystream, for each AES backend.
+ *
+ *  Checks first that all the backends produce the same keystream, then reports
+ *  the throughput of keystream_blocks (in blocks of `chunk` AES blocks, as used
+ *  by round_random_ints) and of round_random_ints for a round of 35,040 slots.
+ *  Backends not supported by the CPU are skipped.
+ */
+
+#include "csprng.h"
+
+#include <iostream>
+#include <vector>
+#include <cstring>
+#include <chrono>
+#include <cassert>
+
+using namespace std;
+
+static const int MODULUS = 759250133;
+
+
+/** Returns the keystream of a few rounds and block ranges, generated with the given backend */
+vector<uint8_t> sample_keystream(AESBackend backend, int8_t* key)
+{
+    set_aes_backend(backend);
+    CSPRNG csprng(key);
+
+    vector<uint8_t> out;
+    const uint64_t rounds[] = {0, 1, (1ull << 40) + 17};
+    for (uint64_t round : rounds)
+    {
+        for (int nblocks = 1; nblocks <= 37; nblocks += 6)
+        {
+            vector<uint8_t> buf(16 * nblocks);
+            csprng.keystream_blocks(round, 1000 * nblocks + 3, nblocks, buf.data());
+            out.insert(out.end(), buf.begin(), buf.end());
+        }
+    }
+    return out;
+}
+
+
+void keystream_experiment(const vector<AESBackend>& backends)
+{
+    int8_t key[16];
+    for (int i = 0; i < 16; i++)
+        key[i] = rand() % 256;
+
+    // all the backends must agree
+    vector<uint8_t> reference = sample_keystream(backends[0], key);
+    for (AESBackend backend : backends)
+        assert(reference == sample_keystream(backend, key));
+
+    const int chunk = 64;
+    const int nr_calls = 20000;
+    const int nr_slots = 35040;
+
+    for (AESBackend backend : backends)
+    {
+        set_aes_backend(backend);
+        CSPRNG csprng(key);
+
+        vector<uint8_t> buf(16 * chunk);
+        auto blocks_begin = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < nr_calls; i++)
+            csprng.keystream_blocks(7, (uint64_t) i * chunk, chunk, buf.data());
+        auto blocks_end = std::chrono::high_resolution_clock::now();
+
+        vector<uint32_t> ints(nr_slots);
+        const int nr_rounds = 20;
+        auto ints_begin = std::chrono::high_resolution_clock::now();
+        for (int r = 0; r < nr_rounds; r++)
+            csprng.round_random_ints(r, 0, nr_slots, MODULUS, ints.data());
+        auto ints_end = std::chrono::high_resolution_clock::now();
+
+        double blocks_s = std::chrono::duration<double>(blocks_end - blocks_begin).count();
+        double ints_s = std::chrono::duration<double>(ints_end - ints_begin).count();
+
+        // Display results
+        std::cout << "backend: " << aes_backend_name(backend)
+                  << " -> keystream: " << (16.0 * chunk * nr_calls) / blocks_s / (1 << 20) << " MB/s"
+                  << ", round of " << nr_slots << " slots: " << ints_s / nr_rounds * 1e6 << " us"
+                  << std::endl;
+    }
+}
+
+
+int main()
+{
+    srand(time(NULL)); // XXX not secure. Enough for timing experiments.
+
+    vector<AESBackend> backends;
+    for (AESBackend backend : {AES_TINY, AES_BITSLICED, AES_NI, AES_VAES})
+    {
+        if (aes_backend_supported(backend))
+            backends.push_back(backend);
+        else
+            std::cout << "backend: " << aes_backend_name(backend) << " -> not supported by this CPU" << std::endl;
+    }
+    std::cout << "default backend: " << aes_backend_name(best_aes_backend()) << std::endl;
+
+    keystream_experiment(backends);
+
+    return 0;
+}
@@ -0,0 +1,184 @@
+#include "memory_budget.h"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <sys/resource.h>
+#include <unistd.h>
+
+
+size_t peak_rss_bytes()
+{
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return (size_t) usage.ru_maxrss * 1024; // in KiB on Linux
+}
+
+size_t current_rss_bytes()
+{
+	// the second field of statm is the resident set size, in pages
+	std::ifstream statm("/proc/self/statm");
+	size_t total_pages = 0, resident_pages = 0;
+	if (!(statm >> total_pages >> resident_pages))
+		return 0;
+	return resident_pages * sysconf(_SC_PAGESIZE);
+}
+
+
+MemoryBudget::MemoryBudget(size_t budget_bytes)
+	: budget(budget_bytes) {}
+
+void MemoryBudget::reserve(size_t bytes, int n_ciphertexts)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	if (budget > 0 && bytes > budget)
+		throw std::length_error("reserving " + std::to_string(bytes) + " bytes out of a budget of " + std::to_string(budget));
+	if (budget > 0)
+		released.wait(lock, [&] { return live + set_aside + bytes <= budget; });
+	live += bytes;
+	live_ciphertexts += n_ciphertexts;
+	max_live = std::max(max_live, live);
+	max_live_ciphertexts = std::max(max_live_ciphertexts, live_ciphertexts);
+}
+
+void MemoryBudget::release(size_t bytes, int n_ciphertexts)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		live -= bytes;
+		live_ciphertexts -= n_ciphertexts;
+	}
+	released.notify_all();
+}
+
+size_t MemoryBudget::budget_bytes() const
+{
+	return budget;
+}
+
+size_t MemoryBudget::live_bytes()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return live;
+}
+
+size_t MemoryBudget::high_water_bytes()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return max_live;
+}
+
+int MemoryBudget::high_water_ciphertexts()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return max_live_ciphertexts;
+}
+
+size_t MemoryBudget::task_footprint_bytes()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return task_footprint;
+}
+
+int MemoryBudget::high_water_tasks()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return max_tasks;
+}
+
+
+// bytes a task admitted with admitted bytes has yet to reserve, with task_live reserved
+static size_t headroom(size_t admitted, size_t task_live)
+{
+	return (admitted > task_live) ? admitted - task_live : 0;
+}
+
+size_t MemoryBudget::admit()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	if (budget > 0)
+		released.wait(lock, [&] { return 0 == n_tasks || (task_footprint > 0 && live + set_aside + task_footprint <= budget); });
+	set_aside += task_footprint;
+	n_tasks++;
+	max_tasks = std::max(max_tasks, n_tasks);
+	return task_footprint;
+}
+
+void MemoryBudget::charge(size_t admitted, size_t task_live, long bytes, int n_ciphertexts)
+{
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if (budget > 0 && bytes > 0)
+		{
+			// the headroom of the task is set aside already
+			auto fits = [&] { return live + set_aside - headroom(admitted, task_live) + bytes + headroom(admitted, task_live + bytes) <= budget; };
+			if (!fits())
+			{
+				// the others can only release bytes if some of them are not waiting
+				n_waiting++;
+				released.wait(lock, [&] { return fits() || n_waiting == n_tasks; });
+				n_waiting--;
+				if (!fits())
+					throw std::length_error("reserving " + std::to_string(bytes) + " bytes for a task, with " + std::to_string(live)
+					                        + " reserved, out of a budget of " + std::to_string(budget));
+			}
+		}
+		set_aside -= headroom(admitted, task_live);
+		set_aside += headroom(admitted, task_live + bytes);
+		live += bytes;
+		live_ciphertexts += n_ciphertexts;
+		max_live = std::max(max_live, live);
+		max_live_ciphertexts = std::max(max_live_ciphertexts, live_ciphertexts);
+	}
+	if (bytes < 0)
+		released.notify_all();
+}
+
+void MemoryBudget::finish(size_t admitted, size_t task_live, int task_ciphertexts, size_t task_peak)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		set_aside -= headroom(admitted, task_live);
+		live -= task_live;
+		live_ciphertexts -= task_ciphertexts;
+		task_footprint = std::max(task_footprint, task_peak);
+		n_tasks--;
+	}
+	released.notify_all();
+}
+
+
+MemoryTask::MemoryTask(MemoryBudget &budget)
+	: budget(budget), admitted(budget.admit()) {}
+
+MemoryTask::~MemoryTask()
+{
+	budget.finish(admitted, live, live_ciphertexts, peak);
+}
+
+void MemoryTask::reserve(size_t bytes, int n_ciphertexts)
+{
+	budget.charge(admitted, live, (long) bytes, n_ciphertexts);
+	live += bytes;
+	live_ciphertexts += n_ciphertexts;
+	peak = std::max(peak, live);
+}
+
+void MemoryTask::release(size_t bytes, int n_ciphertexts)
+{
+	budget.charge(admitted, live, -(long) bytes, -n_ciphertexts);
+	live -= bytes;
+	live_ciphertexts -= n_ciphertexts;
+}
+
+void MemoryTask::reserve_transient(size_t bytes, int n_ciphertexts)
+{
+	reserve(bytes, n_ciphertexts);
+	release(bytes, n_ciphertexts);
+}
+
+size_t MemoryTask::peak_bytes() const
+{
+	return peak;
+}
@@ -0,0 +1,121 @@
+/**
+ *  Memory accounting of the billing: a budget of bytes for the FHE objects that
+ *  are alive at once, and the peak resident set size of the process.
+ *
+ *  The budget only counts what the callers reserve (ciphertexts, plaintexts and
+ *  keys, estimated from their towers); the scratch space of OpenFHE, e.g. of the
+ *  key switching, is only seen in the resident set size.
+ */
+
+#ifndef __MEMORY_BUDGET
+#define __MEMORY_BUDGET
+
+#include <cstddef>
+#include <mutex>
+#include <condition_variable>
+
+
+// peak resident set size of the process, in bytes
+size_t peak_rss_bytes();
+
+// current resident set size of the process, in bytes (0 if /proc is not available)
+size_t current_rss_bytes();
+
+
+/**
+ *  Bytes reserved by the threads of the billing, out of a budget. Objects that
+ *  outlive the tasks of the billing, e.g. the keys, are reserved with reserve,
+ *  which waits until they fit. The objects of a task, e.g. the billing of a
+ *  client, are reserved through a MemoryTask as they are created. The largest
+ *  reserved total is kept, in bytes and in ciphertexts.
+ */
+class MemoryBudget
+{
+	size_t budget;
+	size_t live = 0;
+	size_t max_live = 0;
+	int live_ciphertexts = 0;
+	int max_live_ciphertexts = 0;
+	size_t set_aside = 0;     // bytes admitted for the tasks running and not reserved by them yet
+	size_t task_footprint = 0; // largest peak measured for a task
+	int n_tasks = 0;
+	int max_tasks = 0;
+	int n_waiting = 0; // tasks waiting in MemoryTask::reserve
+	std::mutex mutex;
+	std::condition_variable released;
+
+	friend class MemoryTask;
+	size_t admit();
+	void charge(size_t admitted, size_t task_live, long bytes, int n_ciphertexts);
+	void finish(size_t admitted, size_t task_live, int task_ciphertexts, size_t task_peak);
+
+	public:
+
+		// budget_bytes = 0: no budget
+		explicit MemoryBudget(size_t budget_bytes = 0);
+
+		/**
+		 *  Waits until bytes fit in the budget and reserves them; n_ciphertexts
+		 *  of them are ciphertexts. Throws std::length_error if they cannot fit
+		 *  even when nothing else is reserved.
+		 */
+		void reserve(size_t bytes, int n_ciphertexts = 0);
+
+		void release(size_t bytes, int n_ciphertexts = 0);
+
+		size_t budget_bytes() const;
+		size_t live_bytes();
+		size_t high_water_bytes();
+		int high_water_ciphertexts();
+
+		// largest peak measured for a task, and most tasks admitted at once
+		size_t task_footprint_bytes();
+		int high_water_tasks();
+};
+
+
+/**
+ *  The objects of a task of a MemoryBudget, reserved before they are created
+ *  and released as they are freed. A task is admitted once the largest peak
+ *  measured for the tasks before it fits next to the bytes reserved and the
+ *  bytes admitted for the other tasks; the first task runs alone, since nothing
+ *  is measured yet. Reservations within the footprint a task was admitted with
+ *  never wait. Beyond it, they wait until the bytes fit in the budget, and
+ *  throw std::length_error if they cannot: when the task runs alone, e.g. the
+ *  first one, or when all the other tasks are waiting too. The tasks admitted
+ *  after a task are admitted with its peak.
+ */
+class MemoryTask
+{
+	MemoryBudget &budget;
+	size_t admitted;
+	size_t live = 0;
+	size_t peak = 0;
+	int live_ciphertexts = 0;
+
+	public:
+
+		// waits until the task is admitted
+		explicit MemoryTask(MemoryBudget &budget);
+
+		// releases the objects still reserved; the peak of the task is measured
+		~MemoryTask();
+
+		MemoryTask(const MemoryTask &) = delete;
+		MemoryTask &operator=(const MemoryTask &) = delete;
+
+		// waits until bytes fit; throws std::length_error if they cannot
+		void reserve(size_t bytes, int n_ciphertexts = 0);
+		void release(size_t bytes, int n_ciphertexts = 0);
+
+		/**
+		 *  Objects that were alive only during a call, measured once it returns,
+		 *  e.g. the intermediates of server_billing: reserved and released at once,
+		 *  on top of what the task has reserved.
+		 */
+		void reserve_transient(size_t bytes, int n_ciphertexts = 0);
+
+		size_t peak_bytes() const;
+};
+
+#endif
@@ -0,0 +1,177 @@
+/**
+ *  Billing period of a month: the daily bills and rewards of server_billing are
+ *  added into a BillAccumulator per client, instead of being kept and decrypted
+ *  day by day, e.g.
+ *      ./monthly_billing --days 30 --clients 4 --scheme ckks
+ *
+ *  Two accumulators are compared with keeping the daily results: one adding up
+ *  all the days (days_per_ciphertext 1) and one packing every day in its own
+ *  block (days_per_ciphertext = days). Reports, per client, the time to add a
+ *  day, the time to decrypt the period, the memory held during the period and
+ *  the largest difference with the daily decryptions.
+ *
+ *  The dataset has a single day, so day d of client i is the day of client
+ *  (i + d) % NR_CLIENTS.
+ */
+
+#include "billing.h"
+
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+
+
+struct MonthlySettings
+{
+    int days = 30;
+    int clients = 4;
+    BillingScheme scheme = BILLING_CKKS;
+};
+
+
+MonthlySettings parse_arguments(int argc, char* argv[])
+{
+    MonthlySettings settings;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string option = argv[i];
+        std::string value = argv[i + 1];
+        if (option == "--days")
+            settings.days = stoi(value);
+        else if (option == "--clients")
+            settings.clients = stoi(value);
+        else if (option == "--scheme")
+            settings.scheme = parse_billing_scheme(value);
+        else
+            throw std::invalid_argument("unknown option " + option);
+    }
+    return settings;
+}
+
+// largest |x[i] - y[i]|
+double max_abs_difference(const std::vector<double>& x, const std::vector<double>& y)
+{
+    double diff = 0.0;
+    for (unsigned int i = 0; i < x.size(); i++)
+        diff = std::max(diff, std::fabs(x[i] - y[i]));
+    return diff;
+}
+
+
+void monthly_experiment(const MonthlySettings& settings)
+{
+    BillingScheme scheme = settings.scheme;
+    CryptoContext<DCRTPoly> cc = billing_crypto_context(scheme);
+    auto keys = cc->KeyGen();
+    cc->EvalMultKeyGen(keys.secretKey);
+    cc->EvalRotateKeyGen(keys.secretKey, BillAccumulator::rotation_indices(settings.days));
+    const PublicKey<DCRTPoly> &pk = keys.publicKey;
+
+    auto [
+        feedInTarif,
+        tradingPrice,
+        totalProsumers,
+        totalConsumers,
+        totalDeviation
+    ] = context_setup();
+    auto [maskTotalDevPositive, maskTotalDevZero, maskTotalDevNegative] = server_setup(totalDeviation);
+    RoundPlaintexts round = encode_round_plaintexts(cc, pk, tradingPrice, feedInTarif, totalProsumers, totalDeviation,
+                                                    maskTotalDevPositive, maskTotalDevNegative, scheme);
+
+    for (int days_per_ciphertext : {1, settings.days})
+    {
+        int64_t add_us = 0, daily_decrypt_us = 0, period_decrypt_us = 0;
+        size_t daily_bytes = 0, period_bytes = 0;
+        double max_error = 0.0;
+        for (int c = 0; c < settings.clients; c++)
+        {
+            BillAccumulator accumulator(cc, days_per_ciphertext, scheme);
+            std::vector<Ciphertext<DCRTPoly>> daily_bills, daily_rewards;
+            for (int d = 0; d < settings.days; d++)
+            {
+                auto [
+                    consumptions,
+                    supplies,
+                    consumption_promise,
+                    supply_promise,
+                    retailPrice,
+                    accepted,
+                    deviations,
+                    expectedBill,
+                    expectedReward
+                ] = load_client_data((c + d) % NR_CLIENTS);
+                // public, e.g., from the contract; here, whether the client supplies in the dataset
+                bool can_supply = std::any_of(supplies.begin(), supplies.end(), [](double x) { return x > 0; });
+                auto [ct_consumption, ct_supplies, ct_deviations, ct_signs, ct_accepted]
+                    = client_setup(cc, pk, consumptions, supplies, deviations, accepted, scheme, can_supply);
+                TariffPlaintexts tariff = encode_tariff_plaintexts(cc, pk, tradingPrice, retailPrice, totalConsumers, totalDeviation, scheme);
+                auto [ct_bill, ct_reward] = server_billing(cc, round, tariff, ct_consumption, ct_supplies, ct_deviations, ct_signs, ct_accepted);
+
+                daily_bills.push_back(ct_bill);
+                daily_rewards.push_back(ct_reward);
+                daily_bytes += ciphertext_bytes(ct_bill, cc) + ((nullptr != ct_reward) ? ciphertext_bytes(ct_reward, cc) : 0);
+
+                auto add_begin = std::chrono::high_resolution_clock::now();
+                accumulator.add_day(ct_bill, ct_reward);
+                auto add_end = std::chrono::high_resolution_clock::now();
+                add_us += std::chrono::duration_cast<std::chrono::microseconds>(add_end - add_begin).count();
+            }
+            period_bytes += accumulator.memory_bytes();
+
+            // one decryption per day and result
+            auto daily_begin = std::chrono::high_resolution_clock::now();
+            std::vector<std::vector<double>> bills, rewards;
+            for (int d = 0; d < settings.days; d++)
+            {
+                bills.push_back(decrypt_billing(cc, keys.secretKey, daily_bills[d], scheme));
+                rewards.push_back(decrypt_billing(cc, keys.secretKey, daily_rewards[d], scheme));
+            }
+            auto daily_end = std::chrono::high_resolution_clock::now();
+
+            // one decryption per result for the whole period
+            auto [period_bill, period_reward] = accumulator.close();
+            std::vector<std::vector<double>> bill_blocks = accumulator.decrypt(keys.secretKey, period_bill);
+            std::vector<std::vector<double>> reward_blocks = accumulator.decrypt(keys.secretKey, period_reward);
+            auto period_end = std::chrono::high_resolution_clock::now();
+
+            daily_decrypt_us += std::chrono::duration_cast<std::chrono::microseconds>(daily_end - daily_begin).count();
+            period_decrypt_us += std::chrono::duration_cast<std::chrono::microseconds>(period_end - daily_end).count();
+
+            // block b is the sum of the days d = b mod days_per_ciphertext
+            for (int b = 0; b < days_per_ciphertext; b++)
+            {
+                std::vector<double> bill(TIMESLOTS, 0.0), reward(TIMESLOTS, 0.0);
+                for (int d = b; d < settings.days; d += days_per_ciphertext)
+                    for (int t = 0; t < TIMESLOTS; t++)
+                    {
+                        bill[t] += bills[d][t];
+                        reward[t] += rewards[d][t];
+                    }
+                max_error = std::max({max_error, max_abs_difference(bill_blocks[b], bill), max_abs_difference(reward_blocks[b], reward)});
+            }
+        }
+        assert(max_error < 1e-2);
+
+        // Display results
+        std::cout << "scheme: " << billing_scheme_name(scheme) << ", "
+                  << "days: " << settings.days << ", "
+                  << "days_per_ciphertext: " << days_per_ciphertext
+                  << " -> add_day: " << (double) add_us / (settings.clients * settings.days) << " us"
+                  << ", decryption of the period: " << (double) period_decrypt_us / settings.clients << " us"
+                  << " (daily: " << (double) daily_decrypt_us / settings.clients << " us)"
+                  << ", memory per client: " << period_bytes / settings.clients / 1024.0 << " KiB"
+                  << " (daily: " << daily_bytes / settings.clients / 1024.0 << " KiB)"
+                  << ", max |period - sum of the days|: " << max_error
+                  << std::endl;
+    }
+}
+
+
+int main(int argc, char* argv[])
+{
+    monthly_experiment(parse_arguments(argc, argv));
+    return 0;
+}
@@ -0,0 +1,201 @@
+/**
+ *  Premultiplied uploads vs the uploads of client_setup: with
+ *  client_setup_premultiplied the clients multiply their readings by their
+ *  masks in the clear, and server_billing only multiplies ciphertexts by
+ *  plaintexts, e.g.
+ *      ./premultiplied_billing --clients 16 --scheme ckks
+ *
+ *  Reports, per client and mode, the client and server time, the upload size,
+ *  the depth of the bill (levels consumed in CKKS; in BFV, which does not track
+ *  levels, the most ciphertext multiplications of a client, counted as
+ *  server_billing evaluates them), the key switches, and the largest errors
+ *  against expectedBill and expectedReward. The premultiplied clients are billed
+ *  before the relinearisation key is generated, since they do not need it.
+ */
+
+#include "billing.h"
+
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+
+
+struct PremultipliedSettings
+{
+    int clients = 16;
+    BillingScheme scheme = BILLING_CKKS;
+};
+
+struct ModeResult
+{
+    int64_t client_us = 0;
+    int64_t server_us = 0;
+    size_t upload_bytes = 0;
+    int depth = 0; // levels consumed in CKKS, ciphertext * ciphertext multiplications in BFV
+    BillingOps ops; // operations of server_billing, of all the clients
+    double max_bill_error = 0.0;
+    double max_reward_error = 0.0;
+};
+
+
+PremultipliedSettings parse_arguments(int argc, char* argv[])
+{
+    PremultipliedSettings settings;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string option = argv[i];
+        std::string value = argv[i + 1];
+        if (option == "--clients")
+            settings.clients = stoi(value);
+        else if (option == "--scheme")
+            settings.scheme = parse_billing_scheme(value);
+        else
+            throw std::invalid_argument("unknown option " + option);
+    }
+    return settings;
+}
+
+// largest |x[i] - y[i]|
+double max_abs_difference(const std::vector<double>& x, const std::vector<double>& y)
+{
+    double diff = 0.0;
+    for (unsigned int i = 0; i < x.size(); i++)
+        diff = std::max(diff, std::fabs(x[i] - y[i]));
+    return diff;
+}
+
+// levels consumed by ct in CKKS; its rescaling is still pending at noise scale degree 2
+int consumed_levels(const Ciphertext<DCRTPoly>& ct)
+{
+    return ct->GetLevel() + ct->GetNoiseScaleDeg() - 1;
+}
+
+void print_result(const char* mode, BillingScheme scheme, int n_clients, const ModeResult& result)
+{
+    std::cout << "scheme: " << billing_scheme_name(scheme) << ", "
+              << "uploads: " << mode
+              << " -> client_setup: " << (double) result.client_us / n_clients << " us"
+              << ", server_billing: " << (double) result.server_us / n_clients << " us"
+              << ", upload: " << result.upload_bytes / 1024.0 << " KiB"
+              << (BILLING_CKKS == scheme ? ", depth: " : ", ciphertext mults: ") << result.depth
+              << ", key switches: " << (double) result.ops.relinearizations / n_clients
+              << ", max |bill - expectedBill|: " << result.max_bill_error
+              << ", max |reward - expectedReward|: " << result.max_reward_error
+              << std::endl;
+}
+
+
+void premultiplied_experiment(const PremultipliedSettings& settings)
+{
+    BillingScheme scheme = settings.scheme;
+    CryptoContext<DCRTPoly> cc = billing_crypto_context(scheme);
+    auto keys = cc->KeyGen();
+    const PublicKey<DCRTPoly> &pk = keys.publicKey;
+
+    auto [
+        feedInTarif,
+        tradingPrice,
+        totalProsumers,
+        totalConsumers,
+        totalDeviation
+    ] = context_setup();
+    auto [maskTotalDevPositive, maskTotalDevZero, maskTotalDevNegative] = server_setup(totalDeviation);
+    BillingPlan plan = plan_billing(totalConsumers, totalProsumers, maskTotalDevPositive, maskTotalDevNegative);
+
+    RoundPlaintexts premultiplied_round = encode_premultiplied_round_plaintexts(cc, tradingPrice, feedInTarif, totalProsumers, totalDeviation,
+                                                                                maskTotalDevPositive, scheme, plan);
+    RoundPlaintexts round = encode_round_plaintexts(cc, pk, tradingPrice, feedInTarif, totalProsumers, totalDeviation,
+                                                    maskTotalDevPositive, maskTotalDevNegative, scheme, plan);
+
+    // Premultiplied uploads, without the relinearisation key
+    ModeResult premultiplied;
+    for (int c = 0; c < settings.clients; c++)
+    {
+        auto [
+            consumptions,
+            supplies,
+            consumption_promise,
+            supply_promise,
+            retailPrice,
+            accepted,
+            deviations,
+            expectedBill,
+            expectedReward
+        ] = load_client_data(c % NR_CLIENTS);
+        TariffPlaintexts tariff = encode_premultiplied_tariff_plaintexts(cc, tradingPrice, retailPrice, totalConsumers, totalDeviation,
+                                                                         maskTotalDevNegative, scheme, plan);
+
+        auto client_begin = std::chrono::high_resolution_clock::now();
+        PremultipliedUploads uploads = client_setup_premultiplied(cc, pk, consumptions, supplies, deviations, accepted, scheme);
+        auto client_end = std::chrono::high_resolution_clock::now();
+        BillingOps client_ops;
+        auto [ct_bill, ct_reward] = server_billing(cc, premultiplied_round, tariff, uploads, &client_ops);
+        auto server_end = std::chrono::high_resolution_clock::now();
+
+        premultiplied.client_us += std::chrono::duration_cast<std::chrono::microseconds>(client_end - client_begin).count();
+        premultiplied.server_us += std::chrono::duration_cast<std::chrono::microseconds>(server_end - client_end).count();
+        premultiplied.upload_bytes = PREMULTIPLIED_CLIENT_ENCRYPTIONS * ciphertext_bytes(uploads.deviations, cc);
+        premultiplied.ops += client_ops;
+        premultiplied.depth = std::max(premultiplied.depth, (BILLING_CKKS == scheme) ? consumed_levels(ct_bill) : client_ops.mults);
+        premultiplied.max_bill_error = std::max(premultiplied.max_bill_error,
+                                                max_abs_difference(decrypt_billing(cc, keys.secretKey, ct_bill, scheme), expectedBill));
+        premultiplied.max_reward_error = std::max(premultiplied.max_reward_error,
+                                                  max_abs_difference(decrypt_billing(cc, keys.secretKey, ct_reward, scheme), expectedReward));
+    }
+
+    // Uploads of client_setup
+    cc->EvalMultKeyGen(keys.secretKey);
+    ModeResult raw;
+    for (int c = 0; c < settings.clients; c++)
+    {
+        auto [
+            consumptions,
+            supplies,
+            consumption_promise,
+            supply_promise,
+            retailPrice,
+            accepted,
+            deviations,
+            expectedBill,
+            expectedReward
+        ] = load_client_data(c % NR_CLIENTS);
+        TariffPlaintexts tariff = encode_tariff_plaintexts(cc, pk, tradingPrice, retailPrice, totalConsumers, totalDeviation, scheme, plan);
+
+        auto client_begin = std::chrono::high_resolution_clock::now();
+        auto [ct_consumption, ct_supplies, ct_deviations, ct_signs, ct_accepted]
+            = client_setup(cc, pk, consumptions, supplies, deviations, accepted, scheme);
+        auto client_end = std::chrono::high_resolution_clock::now();
+        raw.upload_bytes = CLIENT_ENCRYPTIONS * ciphertext_bytes(ct_deviations, cc); // before the uploads are moved in
+        BillingOps client_ops;
+        auto server_begin = std::chrono::high_resolution_clock::now();
+        auto [ct_bill, ct_reward] = server_billing(cc, round, tariff, std::move(ct_consumption), std::move(ct_supplies),
+                                                   std::move(ct_deviations), std::move(ct_signs), std::move(ct_accepted), &client_ops);
+        auto server_end = std::chrono::high_resolution_clock::now();
+
+        raw.client_us += std::chrono::duration_cast<std::chrono::microseconds>(client_end - client_begin).count();
+        raw.server_us += std::chrono::duration_cast<std::chrono::microseconds>(server_end - server_begin).count();
+        raw.ops += client_ops;
+        raw.depth = std::max(raw.depth, (BILLING_CKKS == scheme) ? consumed_levels(ct_bill) : client_ops.mults);
+        raw.max_bill_error = std::max(raw.max_bill_error,
+                                      max_abs_difference(decrypt_billing(cc, keys.secretKey, ct_bill, scheme), expectedBill));
+        raw.max_reward_error = std::max(raw.max_reward_error,
+                                        max_abs_difference(decrypt_billing(cc, keys.secretKey, ct_reward, scheme), expectedReward));
+    }
+
+    assert(raw.max_bill_error < 1e-2 && raw.max_reward_error < 1e-2);
+    assert(premultiplied.max_bill_error < 1e-2 && premultiplied.max_reward_error < 1e-2);
+
+    // Display results
+    print_result("client_setup", scheme, settings.clients, raw);
+    print_result("premultiplied", scheme, settings.clients, premultiplied);
+}
+
+
+int main(int argc, char* argv[])
+{
+    premultiplied_experiment(parse_arguments(argc, argv));
+    return 0;
+}
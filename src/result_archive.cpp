@@ -0,0 +1,320 @@
+#include "result_archive.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+std::string archive_index_path(const std::string &path)
+{
+	return path + ".idx";
+}
+
+static std::runtime_error system_error(const std::string &what, const std::string &path)
+{
+	return std::runtime_error(what + " " + path + ": " + strerror(errno));
+}
+
+// writes all of data, retrying short writes
+static void write_all(int fd, const void *data, size_t size)
+{
+	const uint8_t *p = (const uint8_t*) data;
+	while (size > 0)
+	{
+		ssize_t n = write(fd, p, size);
+		if (n < 0 && EINTR == errno)
+			continue;
+		if (n < 0)
+			throw std::runtime_error(std::string("writing the archive: ") + strerror(errno));
+		p += n;
+		size -= n;
+	}
+}
+
+static uint64_t padded(uint64_t size)
+{
+	return (size + 7) & ~(uint64_t) 7;
+}
+
+/**
+ *  Drops the torn tail that a crash during a write can leave: a partial last
+ *  index entry, index entries of records that are not complete in the data file,
+ *  and the data after the last indexed record (which would misalign the records
+ *  appended after it). Returns the end of the data file.
+ */
+static uint64_t truncate_torn_tail(int data_fd, int index_fd, uint64_t data_size)
+{
+	struct stat st;
+	if (fstat(index_fd, &st) < 0)
+		throw std::runtime_error(std::string("reading the archive index: ") + strerror(errno));
+	uint64_t n_entries = st.st_size / sizeof(IndexEntry);
+	uint64_t end = sizeof(ARCHIVE_MAGIC);
+	for (; n_entries > 0; n_entries--)
+	{
+		IndexEntry entry;
+		RecordHeader header;
+		if (pread(index_fd, &entry, sizeof(entry), (n_entries - 1) * sizeof(entry)) != sizeof(entry)
+		    || entry.offset < sizeof(ARCHIVE_MAGIC) || entry.offset > data_size || data_size - entry.offset < sizeof(header)
+		    || pread(data_fd, &header, sizeof(header), entry.offset) != sizeof(header)
+		    || header.client != entry.client || header.round != entry.round
+		    || header.size > data_size - entry.offset - sizeof(header))
+			continue;
+		uint64_t record_end = entry.offset + sizeof(header) + padded(header.size);
+		if (record_end <= data_size)
+		{
+			end = record_end;
+			break;
+		}
+	}
+	if ((uint64_t) st.st_size != n_entries * sizeof(IndexEntry) && ftruncate(index_fd, n_entries * sizeof(IndexEntry)) < 0)
+		throw std::runtime_error(std::string("truncating the archive index: ") + strerror(errno));
+	if (end != data_size && ftruncate(data_fd, end) < 0)
+		throw std::runtime_error(std::string("truncating the archive: ") + strerror(errno));
+	return end;
+}
+
+static bool operator<(const IndexEntry &a, const IndexEntry &b)
+{
+	return (a.client != b.client) ? a.client < b.client : a.round < b.round;
+}
+
+
+ArchiveWriter::ArchiveWriter(const std::string &path, size_t batch_bytes, size_t max_pending_bytes)
+	: batch_bytes(batch_bytes), max_pending_bytes(std::max(max_pending_bytes, batch_bytes))
+{
+	data_fd = open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+	if (data_fd < 0)
+		throw system_error("cannot open", path);
+	index_fd = open(archive_index_path(path).c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+	if (index_fd < 0)
+	{
+		close(data_fd);
+		throw system_error("cannot open", archive_index_path(path));
+	}
+
+	struct stat st;
+	fstat(data_fd, &st);
+	char magic[sizeof(ARCHIVE_MAGIC)];
+	if (0 == st.st_size)
+		write_all(data_fd, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC));
+	else if (pread(data_fd, magic, sizeof(magic), 0) != sizeof(magic) || 0 != memcmp(magic, ARCHIVE_MAGIC, sizeof(magic)))
+	{
+		close(data_fd);
+		close(index_fd);
+		throw std::runtime_error(path + " is not an archive");
+	}
+	try
+	{
+		next_offset = written_offset = truncate_torn_tail(data_fd, index_fd, std::max((uint64_t) st.st_size, (uint64_t) sizeof(ARCHIVE_MAGIC)));
+	}
+	catch (const std::exception&)
+	{
+		close(data_fd);
+		close(index_fd);
+		throw;
+	}
+	batch.reserve(batch_bytes);
+
+	thread = std::thread(&ArchiveWriter::write_batches, this);
+}
+
+ArchiveWriter::~ArchiveWriter()
+{
+	try
+	{
+		flush();
+	}
+	catch (const std::exception&) {}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	batch_ready.notify_one();
+	thread.join();
+	close(data_fd);
+	close(index_fd);
+}
+
+void ArchiveWriter::append(uint32_t client, uint32_t round, const void *payload, size_t size)
+{
+	RecordHeader header = {client, round, size};
+	size_t record_bytes = sizeof(header) + padded(size);
+
+	std::unique_lock<std::mutex> lock(mutex);
+	auto fits = [&] { return error || next_offset - written_offset + record_bytes <= max_pending_bytes
+	                         || next_offset == written_offset; };
+	if (!fits())
+	{
+		// the current batch is written even if it is not full, to make room
+		n_waiting++;
+		batch_ready.notify_one();
+		written.wait(lock, fits);
+		n_waiting--;
+	}
+	if (error)
+		std::rethrow_exception(error);
+
+	batch_index.push_back({client, round, next_offset});
+	size_t at = batch.size();
+	batch.resize(at + record_bytes, 0);
+	memcpy(batch.data() + at, &header, sizeof(header));
+	memcpy(batch.data() + at + sizeof(header), payload, size);
+	next_offset += record_bytes;
+	n_records++;
+	bool full = batch.size() >= batch_bytes;
+	lock.unlock();
+	if (full)
+		batch_ready.notify_one();
+}
+
+void ArchiveWriter::flush()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	n_waiting++;
+	batch_ready.notify_one();
+	written.wait(lock, [&] { return error || written_offset == next_offset; });
+	n_waiting--;
+	if (error)
+		std::rethrow_exception(error);
+}
+
+uint64_t ArchiveWriter::records()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return n_records;
+}
+
+uint64_t ArchiveWriter::data_bytes()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return next_offset;
+}
+
+void ArchiveWriter::write_batches()
+{
+	std::vector<uint8_t> data;
+	std::vector<IndexEntry> entries;
+	data.reserve(batch_bytes);
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		batch_ready.wait(lock, [&] { return stopping || batch.size() >= batch_bytes || (n_waiting > 0 && !batch.empty()); });
+		if (batch.empty())
+		{
+			if (stopping)
+				return;
+			continue;
+		}
+		// the appends go on in the other buffers while this batch is written
+		data.swap(batch);
+		entries.swap(batch_index);
+		lock.unlock();
+
+		std::exception_ptr batch_error;
+		try
+		{
+			// the records before their index entries
+			write_all(data_fd, data.data(), data.size());
+			write_all(index_fd, entries.data(), entries.size() * sizeof(IndexEntry));
+		}
+		catch (const std::exception&)
+		{
+			batch_error = std::current_exception();
+		}
+
+		lock.lock();
+		if (batch_error)
+		{
+			error = batch_error;
+			written.notify_all();
+			return;
+		}
+		written_offset += data.size();
+		data.clear();
+		entries.clear();
+		written.notify_all();
+	}
+}
+
+
+ArchiveReader::ArchiveReader(const std::string &path)
+{
+	data_fd = open(path.c_str(), O_RDONLY);
+	if (data_fd < 0)
+		throw system_error("cannot open", path);
+	struct stat st;
+	fstat(data_fd, &st);
+	mapped_bytes = st.st_size;
+	if (mapped_bytes < sizeof(ARCHIVE_MAGIC))
+	{
+		close(data_fd);
+		throw std::runtime_error(path + " is not an archive");
+	}
+	void *mapping = mmap(nullptr, mapped_bytes, PROT_READ, MAP_SHARED, data_fd, 0);
+	if (MAP_FAILED == mapping)
+	{
+		close(data_fd);
+		throw system_error("cannot map", path);
+	}
+	base = (const uint8_t*) mapping;
+	madvise(mapping, mapped_bytes, MADV_RANDOM); // point lookups: no read-ahead
+	if (0 != memcmp(base, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC)))
+	{
+		munmap(mapping, mapped_bytes);
+		close(data_fd);
+		throw std::runtime_error(path + " is not an archive");
+	}
+
+	// a partial last entry, or entries of records past the mapping, are left out
+	int index_fd = open(archive_index_path(path).c_str(), O_RDONLY);
+	if (index_fd >= 0)
+	{
+		struct stat index_st;
+		fstat(index_fd, &index_st);
+		index.resize(index_st.st_size / sizeof(IndexEntry));
+		ssize_t n = pread(index_fd, index.data(), index.size() * sizeof(IndexEntry), 0);
+		close(index_fd);
+		index.resize(std::max(n, (ssize_t) 0) / sizeof(IndexEntry));
+	}
+	index.erase(std::remove_if(index.begin(), index.end(), [&](const IndexEntry &entry)
+	                           { return entry.offset < sizeof(ARCHIVE_MAGIC) || entry.offset > mapped_bytes
+	                                    || mapped_bytes - entry.offset < sizeof(RecordHeader); }),
+	            index.end());
+
+	// sorted by (client, round); of the entries of a (client, round), the last one appended is kept
+	std::stable_sort(index.begin(), index.end());
+	auto last = std::unique(index.rbegin(), index.rend(), [](const IndexEntry &a, const IndexEntry &b)
+	                        { return a.client == b.client && a.round == b.round; });
+	index.erase(index.begin(), last.base());
+}
+
+ArchiveReader::~ArchiveReader()
+{
+	munmap((void*) base, mapped_bytes);
+	close(data_fd);
+}
+
+ArchiveRecord ArchiveReader::lookup(uint32_t client, uint32_t round) const
+{
+	IndexEntry key = {client, round, 0};
+	auto it = std::lower_bound(index.begin(), index.end(), key);
+	if (index.end() == it || it->client != client || it->round != round)
+		return ArchiveRecord();
+
+	const RecordHeader *header = (const RecordHeader*) (base + it->offset);
+	// the reader only keeps entries with offset + sizeof(RecordHeader) <= mapped_bytes, so this does not wrap around
+	if (header->client != client || header->round != round || header->size > mapped_bytes - it->offset - sizeof(RecordHeader))
+		throw std::runtime_error("the archive record of client " + std::to_string(client) + " and round "
+		                         + std::to_string(round) + " does not match its index entry");
+	return {base + it->offset + sizeof(RecordHeader), header->size};
+}
+
+size_t ArchiveReader::size() const
+{
+	return index.size();
+}
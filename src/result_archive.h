@@ -0,0 +1,136 @@
+/**
+ *  Append-only archive of the results of the billing, e.g. the encrypted bills
+ *  and rewards, with random access by client and round.
+ *
+ *  The archive is two files. The data file <path> starts with ARCHIVE_MAGIC,
+ *  followed by the records: a RecordHeader and the payload, padded to a
+ *  multiple of 8 bytes, so that every payload is 8-byte aligned. The index
+ *  file <path>.idx holds an IndexEntry per record, written after the record
+ *  itself, so that the index never points past the data. Appending a record
+ *  with the (client, round) of an earlier one replaces it. When a writer opens
+ *  an archive, the torn tail of a crash (a partial index entry, or records
+ *  without an index entry) is truncated.
+ *
+ *  ArchiveWriter copies the records into a batch and a background thread
+ *  writes the batches. ArchiveReader maps the data file and returns pointers
+ *  into the mapping, so a lookup copies nothing. Both files use the byte order
+ *  of the machine.
+ */
+
+#ifndef __RESULT_ARCHIVE
+#define __RESULT_ARCHIVE
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+
+static const char ARCHIVE_MAGIC[8] = {'B', 'I', 'L', 'L', 'A', 'R', 'C', '1'};
+
+struct RecordHeader
+{
+	uint32_t client;
+	uint32_t round;
+	uint64_t size; // of the payload, without the padding
+};
+
+struct IndexEntry
+{
+	uint32_t client;
+	uint32_t round;
+	uint64_t offset; // of the RecordHeader in the data file
+};
+
+// path of the index file of the archive at path
+std::string archive_index_path(const std::string &path);
+
+
+/**
+ *  Writer of an archive; appends to it if it exists. append returns once the
+ *  record is copied into the current batch: a batch is written when it reaches
+ *  batch_bytes, or by flush. append waits while max_pending_bytes are not
+ *  written yet. Errors of the writer thread are thrown by the next append or
+ *  flush.
+ */
+class ArchiveWriter
+{
+	int data_fd = -1;
+	int index_fd = -1;
+	size_t batch_bytes;
+	size_t max_pending_bytes;
+
+	std::vector<uint8_t> batch;        // records appended since the last batch was taken
+	std::vector<IndexEntry> batch_index;
+	uint64_t next_offset;               // of the next record appended
+	uint64_t written_offset;            // end of the records written
+	uint64_t n_records = 0;
+	int n_waiting = 0;                  // flushes and appends waiting for the batch to be written
+	bool stopping = false;
+	std::exception_ptr error;
+
+	std::mutex mutex;
+	std::condition_variable batch_ready;
+	std::condition_variable written;
+	std::thread thread;
+
+	void write_batches();
+
+	public:
+
+		explicit ArchiveWriter(const std::string &path, size_t batch_bytes = 1 << 20, size_t max_pending_bytes = 1 << 26);
+		ArchiveWriter(const ArchiveWriter&) = delete;
+		ArchiveWriter& operator=(const ArchiveWriter&) = delete;
+
+		// flushes, then closes the files; errors are lost, call flush to see them
+		~ArchiveWriter();
+
+		void append(uint32_t client, uint32_t round, const void *payload, size_t size);
+
+		// waits until the records appended so far are written to the files
+		void flush();
+
+		// records appended, and bytes of the data file once they are written
+		uint64_t records();
+		uint64_t data_bytes();
+};
+
+
+/** Payload of a record, in the mapping of an ArchiveReader; data is null if there is no record */
+struct ArchiveRecord
+{
+	const uint8_t *data = nullptr;
+	size_t size = 0;
+};
+
+/**
+ *  Reader of the records of an archive that were written when it is opened.
+ *  The index is loaded and sorted by (client, round); the data file is mapped,
+ *  and the pages of a record are only read when its payload is.
+ */
+class ArchiveReader
+{
+	int data_fd = -1;
+	const uint8_t *base = nullptr;
+	size_t mapped_bytes = 0;
+	std::vector<IndexEntry> index;
+
+	public:
+
+		explicit ArchiveReader(const std::string &path);
+		ArchiveReader(const ArchiveReader&) = delete;
+		ArchiveReader& operator=(const ArchiveReader&) = delete;
+		~ArchiveReader();
+
+		// valid as long as the reader is; throws std::runtime_error if the record does not match the index
+		ArchiveRecord lookup(uint32_t client, uint32_t round) const;
+
+		// number of (client, round) with a record
+		size_t size() const;
+};
+
+#endif
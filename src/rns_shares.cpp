@@ -0,0 +1,138 @@
+#include "rns_shares.h"
+
+#include <stdexcept>
+#include <string>
+#include <cmath>
+
+using namespace std;
+
+
+// x^e mod m, for m < 2^32
+static uint64_t pow_mod(uint64_t x, uint64_t e, uint64_t m){
+    uint64_t r = 1;
+    x %= m;
+    for (; e; e >>= 1){
+        if (e & 1)
+            r = r * x % m;
+        x = x * x % m;
+    }
+    return r;
+}
+
+
+RNSBasis::RNSBasis(int n_primes) {
+    if (n_primes < 1 || n_primes > RNS_MAX_PRIMES)
+        throw std::invalid_argument("The RNS basis must have between 1 and " + to_string(RNS_MAX_PRIMES) + " primes.");
+    this->n_primes = n_primes;
+    this->product = 1;
+    for (int j = 0; j < n_primes; j++){
+        primes[j] = RNS_PRIMES[j];
+        product *= primes[j];
+    }
+    for (int j = 0; j < n_primes; j++){
+        unsigned __int128 m_j = product / primes[j];
+        // inverse of M/p_j mod p_j, by Fermat's little theorem
+        uint64_t inv = pow_mod((uint64_t) (m_j % primes[j]), primes[j] - 2, primes[j]);
+        crt_coefficients[j] = m_j * inv;
+    }
+}
+
+double RNSBasis::range_bits() const{
+    double bits = 0;
+    for (int j = 0; j < n_primes; j++)
+        bits += log2((double) primes[j]);
+    return bits;
+}
+
+
+int128_t crt_centered(const uint32_t* residues, const RNSBasis& basis){
+    // c_j < M < 2^90 and residues < 2^30, so the sum fits in 128 bits
+    unsigned __int128 x = 0;
+    for (int j = 0; j < basis.n_primes; j++)
+        x += (residues[j] % basis.primes[j]) * basis.crt_coefficients[j];
+    x %= basis.product;
+    if (x > basis.product / 2)
+        return (int128_t) x - (int128_t) basis.product;
+    return (int128_t) x;
+}
+
+
+void generate_share_vector_rns(int user_id, uint64_t round, int n_slots, const RNSBasis& basis, const SharingKeys& keys, uint32_t* shares) {
+    for (int j = 0; j < basis.n_primes; j++)
+        generate_share_vector(user_id, round, j * RNS_SLICE_SLOTS, n_slots, basis.primes[j], keys, shares + (size_t) j * n_slots);
+}
+
+
+void generate_masked_vector_rns(int user_id, uint64_t round, const double* values, int n_slots, double scale, int n_users,
+                                const RNSBasis& basis, const SharingKeys& keys, uint32_t* shares) {
+    // n_users values of absolute value at most max_abs add up to at most (M-1)/2
+    unsigned __int128 bound = ((basis.product - 1) / 2) / n_users;
+    const double max_exact = 9007199254740992.0; // 2^53
+    double max_abs = (bound < (unsigned __int128) max_exact) ? (double) bound : max_exact - 1;
+
+    generate_share_vector_rns(user_id, round, n_slots, basis, keys, shares);
+    for (int s = 0; s < n_slots; s++){
+        double x = std::nearbyint(values[s] * scale);
+        if (!(std::fabs(x) <= max_abs))
+            throw std::overflow_error("Value out of the range of the RNS encoding (|v| <= " + to_string(max_abs / scale) + ").");
+        int64_t e = (int64_t) x;
+        for (int j = 0; j < basis.n_primes; j++){
+            int64_t p = basis.primes[j];
+            int64_t r = e % p;
+            if (r < 0)
+                r += p;
+            uint32_t& share = shares[(size_t) j * n_slots + s];
+            share = (uint32_t) ((share + r) % p);
+        }
+    }
+}
+
+
+RNSAggregator::RNSAggregator(int n_slots, const RNSBasis& basis) : basis(basis) {
+    this->n_slots = n_slots;
+    for (int j = 0; j < basis.n_primes; j++)
+        residues.push_back(ShareAggregator(n_slots, basis.primes[j]));
+}
+
+void RNSAggregator::add_shares(const uint32_t* shares){
+    for (int j = 0; j < basis.n_primes; j++)
+        residues[j].add_shares(shares + (size_t) j * n_slots);
+}
+
+void RNSAggregator::add_share_matrix(const uint32_t* shares, int n_users){
+    size_t row = (size_t) basis.n_primes * n_slots;
+    for (int i = 0; i < n_users; i++)
+        add_shares(shares + i * row);
+}
+
+void RNSAggregator::reset(){
+    for (ShareAggregator& r : residues)
+        r.reset();
+}
+
+int RNSAggregator::n_shares() const{
+    return residues[0].n_shares;
+}
+
+vector<int128_t> RNSAggregator::result() const{
+    vector<vector<uint32_t> > sums;
+    for (const ShareAggregator& r : residues)
+        sums.push_back(r.result());
+
+    vector<int128_t> res(n_slots);
+    uint32_t slot_residues[RNS_MAX_PRIMES];
+    for (int t = 0; t < n_slots; t++){
+        for (int j = 0; j < basis.n_primes; j++)
+            slot_residues[j] = sums[j][t];
+        res[t] = crt_centered(slot_residues, basis);
+    }
+    return res;
+}
+
+vector<double> RNSAggregator::decode(double scale) const{
+    vector<int128_t> sums = result();
+    vector<double> res(n_slots);
+    for (int t = 0; t < n_slots; t++)
+        res[t] = (double) sums[t] / scale;
+    return res;
+}
@@ -0,0 +1,98 @@
+/**
+ *  Residue number system (RNS) mode of the shares.
+ *
+ *  A value is shared as k residues modulo k distinct ~30-bit primes instead of
+ *  one residue mod MODULUS, so the totals can use up to ~90 bits while every
+ *  share, and every SIMD lane of the aggregator, stays 32 bits wide. The mask of
+ *  residue j is drawn from its own slice of the pairwise keystreams (the slots
+ *  starting at j * RNS_SLICE_SLOTS), so the k masks are independent; slice 0 is
+ *  the keystream of the single-modulus scheme. The residues are combined with
+ *  the CRT only when the totals are decoded.
+ *
+ *  Shares of n_slots time slots are stored residue by residue: the residues mod
+ *  primes[j] are at shares[j*n_slots, ..., (j+1)*n_slots - 1].
+ */
+
+#ifndef __RNS_SHARES
+#define __RNS_SHARES
+
+#include <cstdint>
+#include <vector>
+
+#include "sharing.h"
+
+
+typedef __int128 int128_t;
+
+static const int RNS_MAX_PRIMES = 3;
+
+// the first prime is MODULUS, so that a basis of one prime is the original scheme
+static const uint32_t RNS_PRIMES[RNS_MAX_PRIMES] = {759250133, 1073741789, 1073741783};
+
+// keystream slots reserved to each residue, far beyond any number of time slots
+static const uint64_t RNS_SLICE_SLOTS = 1ull << 48;
+
+
+struct RNSBasis
+{
+    int n_primes;
+    uint32_t primes[RNS_MAX_PRIMES];
+    unsigned __int128 product; // M = primes[0] * ... * primes[n_primes-1]
+    unsigned __int128 crt_coefficients[RNS_MAX_PRIMES]; // c_j = 1 mod primes[j] and 0 mod the others
+
+    // basis of the first n_primes primes of RNS_PRIMES
+    RNSBasis(int n_primes);
+
+    // number of bits of the totals that can be decoded, i.e., log2(M)
+    double range_bits() const;
+};
+
+
+/** Maps the residues of x to the integer in (-M/2, M/2] congruent to x mod M */
+int128_t crt_centered(const uint32_t* residues, const RNSBasis& basis);
+
+void generate_share_vector_rns(int user_id, uint64_t round, int n_slots, const RNSBasis& basis, const SharingKeys& keys, uint32_t* shares);
+
+/**
+ *  Writes in shares the values of user_id for this round, as fixed-point integers
+ *  round(v * scale) reduced mod every prime and masked with the RNS shares of the user.
+ *  Throws std::overflow_error if n_users such values could wrap around mod M,
+ *  or if |v * scale| >= 2^53, where doubles stop being exact integers.
+ */
+void generate_masked_vector_rns(int user_id, uint64_t round, const double* values, int n_slots, double scale, int n_users,
+                                const RNSBasis& basis, const SharingKeys& keys, uint32_t* shares);
+
+
+/**
+ *  Server-side aggregation in RNS mode: one ShareAggregator per prime, so every
+ *  residue is added in 32-bit SIMD lanes with delayed reduction, and the CRT is
+ *  only applied by result() and decode().
+ */
+class RNSAggregator
+{
+    public:
+
+        RNSBasis basis;
+        int n_slots;
+        std::vector<ShareAggregator> residues; // residues[j] accumulates mod basis.primes[j]
+
+        RNSAggregator(int n_slots, const RNSBasis& basis);
+
+        // adds the k * n_slots shares of one user
+        void add_shares(const uint32_t* shares);
+
+        // adds a n_users x (k * n_slots) matrix of shares stored row by row
+        void add_share_matrix(const uint32_t* shares, int n_users);
+
+        void reset();
+
+        int n_shares() const;
+
+        /** Returns the sum of each time slot as a signed integer in (-M/2, M/2] */
+        std::vector<int128_t> result() const;
+
+        /** Returns the sum of each time slot divided by scale */
+        std::vector<double> decode(double scale = FIXED_POINT_SCALE) const;
+};
+
+#endif
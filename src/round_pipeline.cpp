@@ -0,0 +1,491 @@
+/**
+ *  End-to-end driver of the billing rounds. Every round goes through
+ *  1. sharing: every client masks its deviations with its pairwise shares,
+ *  2. aggregation: the server adds the masked vectors and decodes totalDeviation,
+ *  3. server_setup: the masks of the sign of the total deviation are derived,
+ *  4. billing: every client encrypts its data and the server computes the
+ *     encrypted bill and reward of every client.
+ *
+ *  With --totals fhe, phases 1-2 are replaced by the FHE aggregation: every
+ *  client uploads its client_setup ciphertexts and the masks of its P2P
+ *  participation, and the server adds them into the round totals and decrypts
+ *  them; the billing then reuses the uploads.
+ *
+ *  Clients are grouped by retail price (tariff): the plaintexts of the billing
+ *  that depend on the retail price are encoded once per group and round, and
+ *  the others once per round, instead of once per client.
+ *
+ *  The billing circuit is pruned with public information: the branches that
+ *  the round totals make zero (plan_billing), and the supply terms of the
+ *  reward of the clients that cannot supply energy. Every round reports the operations evaluated, as
+ *  server_billing counts them, and those pruned, and checks the decrypted bills
+ *  and rewards against the expected ones of the dataset.
+ *
+ *  Sharing and billing are parallelised over the clients with OpenMP. Phases 1-2
+ *  of round r+1 run in a background thread while round r is billed, since they
+ *  only depend on the clients' data. Reports the latency of every phase and the
+ *  sustained number of rounds per hour, e.g.
+ *      ./round_pipeline --rounds 4 --threads 4 --overlap 1
+ *
+ *  With --tariffs 1, reports instead the encodings that the tariff groups save
+ *  for synthetic populations of up to 100000 clients (tariff_distribution_experiment).
+ */
+
+#include "billing.h"
+#include "sharing.h"
+
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <future>
+#include <cassert>
+#include <cmath>
+#include <random>
+#include <algorithm>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+
+struct PipelineSettings
+{
+    int rounds = 4;
+    int threads = 1;
+    bool overlap = true;
+    bool fhe_totals = false; // --totals fhe|masking
+    bool tariffs = false;    // --tariffs 1: only the tariff_distribution_experiment
+};
+
+struct ClientData
+{
+    std::vector<double> consumptions;
+    std::vector<double> supplies;
+    std::vector<double> retailPrice;
+    std::vector<double> accepted;
+    std::vector<double> deviations;
+    std::vector<double> consumption_promise;
+    std::vector<double> supply_promise;
+    std::vector<double> expectedBill;
+    std::vector<double> expectedReward;
+    bool can_supply; // public, e.g., from the contract; here, whether the client supplies in the dataset
+};
+
+// ciphertexts of client_setup
+struct ClientUpload
+{
+    Ciphertext<DCRTPoly> consumption;
+    Ciphertext<DCRTPoly> supplies;
+    Ciphertext<DCRTPoly> deviations;
+    Ciphertext<DCRTPoly> signs;
+    Ciphertext<DCRTPoly> accepted;
+};
+
+// output of phases 1-2
+struct RoundInput
+{
+    RoundTotals totals;
+    std::vector<ClientUpload> uploads; // empty if the clients upload during the billing
+};
+
+// latency of each phase of one round, in microseconds
+struct PhaseTimings
+{
+    int64_t sharing_us = 0;
+    int64_t aggregation_us = 0;
+    int64_t server_setup_us = 0;
+    int64_t encoding_us = 0;
+    int64_t billing_us = 0;
+};
+
+// operations expected for the billing of a round, of all the clients
+BillingOps round_billing_ops(const BillingPlan& plan, size_t n_groups, const std::vector<bool>& can_supply)
+{
+    BillingOps ops = round_encoding_ops(plan);
+    BillingOps tariff = tariff_encoding_ops(plan);
+    ops.encodings += n_groups * tariff.encodings;
+    ops.encryptions += n_groups * tariff.encryptions;
+    for (bool client_can_supply : can_supply)
+        ops += client_billing_ops(plan, client_can_supply);
+    return ops;
+}
+
+
+// largest |x[i] - y[i]|
+double max_abs_difference(const std::vector<double>& x, const std::vector<double>& y)
+{
+    double diff = 0.0;
+    for (unsigned int i = 0; i < x.size(); i++)
+        diff = std::max(diff, std::fabs(x[i] - y[i]));
+    return diff;
+}
+
+
+PipelineSettings parse_arguments(int argc, char* argv[])
+{
+    PipelineSettings settings;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string option = argv[i];
+        std::string value = argv[i + 1];
+        if (option == "--rounds")
+            settings.rounds = stoi(value);
+        else if (option == "--threads")
+            settings.threads = stoi(value);
+        else if (option == "--overlap")
+            settings.overlap = (0 != stoi(value));
+        else if (option == "--totals")
+            settings.fhe_totals = ("fhe" == value);
+        else if (option == "--tariffs")
+            settings.tariffs = (0 != stoi(value));
+        else
+            throw std::invalid_argument("unknown option " + option);
+    }
+    return settings;
+}
+
+
+/**
+ *  Number of CKKS encodings of the billing plaintexts per round, with the
+ *  clients grouped by tariff, and without grouping (every client encodes all
+ *  of them, as server_billing does).
+ */
+void tariff_report(const std::string& distribution, int n_clients, const std::vector<TariffGroup>& groups)
+{
+    int64_t grouped = ROUND_ENCODINGS + (int64_t) TARIFF_ENCODINGS * groups.size();
+    int64_t per_client = (int64_t) (ROUND_ENCODINGS + TARIFF_ENCODINGS) * n_clients;
+    std::cout << "distribution: " << distribution << ", "
+              << "nr_clients: " << n_clients << ", "
+              << "tariff_groups: " << groups.size()
+              << " -> encodings per round: " << grouped
+              << " (per client: " << per_client << ")"
+              << ", removed: " << 100.0 * (per_client - grouped) / per_client << "%"
+              << std::endl;
+}
+
+
+/**
+ *  Encoding work removed by the tariff groups, for synthetic retail prices drawn
+ *  from a few tariff catalogues: a single regulated tariff, a market of suppliers
+ *  with fixed and day/night tariffs chosen with Zipf popularity, and an
+ *  hourly-priced tariff per supplier on top of it.
+ */
+void tariff_distribution_experiment()
+{
+    std::mt19937_64 rng(1);
+    for (int n_clients : {1000, 10000, 100000})
+    {
+        for (int n_tariffs : {1, 12, 36})
+        {
+            // tariff k is chosen with probability proportional to 1 / (k + 1)
+            std::vector<double> weights(n_tariffs);
+            for (int k = 0; k < n_tariffs; k++)
+                weights[k] = 1.0 / (k + 1);
+            std::discrete_distribution<int> tariff_of_client(weights.begin(), weights.end());
+
+            std::vector<std::vector<double>> catalogue(n_tariffs, std::vector<double>(TIMESLOTS));
+            std::uniform_real_distribution<double> price(0.2, 0.4);
+            for (int k = 0; k < n_tariffs; k++)
+                for (int t = 0; t < TIMESLOTS; t++)
+                    catalogue[k][t] = price(rng);
+
+            std::vector<std::vector<double>> retailPrices(n_clients);
+            for (int i = 0; i < n_clients; i++)
+                retailPrices[i] = catalogue[tariff_of_client(rng)];
+
+            tariff_report("zipf(" + std::to_string(n_tariffs) + ")", n_clients, group_by_tariff(retailPrices));
+        }
+    }
+}
+
+
+/**
+ *  Phases 1 and 2 of a round: every client masks its deviations, and the server
+ *  aggregates the masked vectors and decodes the total deviation of each time slot.
+ */
+RoundInput share_and_aggregate(uint64_t round, const std::vector<ClientData>& clients, const SharingKeys& keys,
+                               const FixedPointCodec& codec, const RoundTotals& file_totals, int n_threads, PhaseTimings& timings)
+{
+    int n_users = clients.size();
+    std::vector<uint32_t> shares((size_t) n_users * TIMESLOTS);
+
+    auto sharing_begin = std::chrono::high_resolution_clock::now();
+    #pragma omp parallel for num_threads(n_threads) schedule(dynamic, 16)
+    for (int i = 0; i < n_users; i++)
+        generate_masked_vector(i, round, clients[i].deviations.data(), TIMESLOTS, codec, keys,
+                               shares.data() + (size_t) i * TIMESLOTS);
+    auto sharing_end = std::chrono::high_resolution_clock::now();
+
+    ShareAggregator aggregator(TIMESLOTS, MODULUS);
+    aggregator.add_share_matrix(shares.data(), n_users);
+    std::vector<double> totalDeviation = codec.decode(aggregator);
+    auto aggregation_end = std::chrono::high_resolution_clock::now();
+
+    timings.sharing_us = std::chrono::duration_cast<std::chrono::microseconds>(sharing_end - sharing_begin).count();
+    timings.aggregation_us = std::chrono::duration_cast<std::chrono::microseconds>(aggregation_end - sharing_end).count();
+
+    // the numbers of P2P consumers and prosumers are taken from context.csv
+    return {{totalDeviation, file_totals.totalConsumers, file_totals.totalProsumers}, {}};
+}
+
+
+/**
+ *  Phases 1 and 2 with FHE: every client encrypts its data and its participation,
+ *  and the server adds the ciphertexts into the round totals and decrypts them.
+ */
+RoundInput encrypt_and_aggregate(CryptoContext<DCRTPoly>& cc, const KeyPair<DCRTPoly>& keys, const std::vector<ClientData>& clients,
+                                 int n_threads, PhaseTimings& timings)
+{
+    int n_users = clients.size();
+    RoundInput input;
+    input.uploads.resize(n_users);
+    std::vector<Ciphertext<DCRTPoly>> ct_deviations(n_users), ct_consumers(n_users), ct_prosumers(n_users);
+
+    auto encryption_begin = std::chrono::high_resolution_clock::now();
+    #pragma omp parallel for num_threads(n_threads) schedule(dynamic)
+    for (int i = 0; i < n_users; i++)
+    {
+        const ClientData& client = clients[i];
+        auto [consumption, supplies, deviations, signs, accepted]
+            = client_setup(cc, keys.publicKey, client.consumptions, client.supplies, client.deviations, client.accepted,
+                           BILLING_CKKS, client.can_supply);
+        input.uploads[i] = {consumption, supplies, deviations, signs, accepted};
+        ct_deviations[i] = deviations;
+        std::tie(ct_consumers[i], ct_prosumers[i])
+            = client_participation(cc, keys.publicKey, client.accepted, client.consumption_promise, client.supply_promise);
+    }
+    auto encryption_end = std::chrono::high_resolution_clock::now();
+
+    input.totals = fhe_round_totals(cc, keys.secretKey, ct_deviations, ct_consumers, ct_prosumers, n_threads);
+    auto aggregation_end = std::chrono::high_resolution_clock::now();
+
+    timings.sharing_us = std::chrono::duration_cast<std::chrono::microseconds>(encryption_end - encryption_begin).count();
+    timings.aggregation_us = std::chrono::duration_cast<std::chrono::microseconds>(aggregation_end - encryption_end).count();
+    return input;
+}
+
+
+void pipeline_experiment(const PipelineSettings& settings)
+{
+    // Generate FHE context and keys
+    CCParams<CryptoContextCKKSRNS> parameters = generate_parameters_ckks(N_TIME_SLOTS);
+    CryptoContext<DCRTPoly> cc = generate_crypto_context_ckks(parameters);
+    assert(TIMESLOTS <= (int) cc->GetRingDimension() / 2);
+    auto keys = cc->KeyGen();
+    cc->EvalMultKeyGen(keys.secretKey);
+    const PublicKey<DCRTPoly> &ckks_pub_key = keys.publicKey;
+
+    // Load experiment context; its totalDeviation is only used to check the shared one
+    auto [
+        feedInTarif,
+        tradingPrice,
+        totalProsumers,
+        totalConsumers,
+        fileTotalDeviation
+    ] = context_setup();
+
+    std::vector<ClientData> clients(NR_CLIENTS);
+    for (int userID = 0; userID < NR_CLIENTS; userID++)
+    {
+        auto [
+            consumptions,
+            supplies,
+            consumption_promise,
+            supply_promise,
+            retailPrice,
+            accepted,
+            deviations,
+            expectedBill,
+            expectedReward
+        ] = load_client_data(userID);
+        bool can_supply = std::any_of(supplies.begin(), supplies.end(), [](double x) { return x > 0; });
+        clients[userID] = {consumptions, supplies, retailPrice, accepted, deviations, consumption_promise, supply_promise,
+                           expectedBill, expectedReward, can_supply};
+    }
+
+    // Tariff groups; the retail prices do not change from round to round
+    std::vector<std::vector<double>> retailPrices;
+    for (const ClientData& client : clients)
+        retailPrices.push_back(client.retailPrice);
+    std::vector<TariffGroup> groups = group_by_tariff(retailPrices);
+    std::vector<int> group_of_client(NR_CLIENTS);
+    for (unsigned int g = 0; g < groups.size(); g++)
+        for (int userID : groups[g].clients)
+            group_of_client[userID] = g;
+    tariff_report("dataset", NR_CLIENTS, groups);
+    std::vector<bool> can_supply;
+    for (const ClientData& client : clients)
+        can_supply.push_back(client.can_supply);
+
+    // Pairwise keys of the clients, on a sparse graph
+    SharingKeys sharing_keys = setup(harary_graph(NR_CLIENTS, log_degree(NR_CLIENTS)));
+    FixedPointCodec codec(MODULUS, NR_CLIENTS);
+
+    std::vector<PhaseTimings> timings(settings.rounds);
+    std::launch policy = settings.overlap ? std::launch::async : std::launch::deferred;
+    RoundTotals file_totals = {fileTotalDeviation, totalConsumers, totalProsumers};
+    auto aggregate = [&](int r) {
+        if (settings.fhe_totals)
+            return encrypt_and_aggregate(cc, keys, clients, settings.threads, timings[r]);
+        return share_and_aggregate(r, clients, sharing_keys, codec, file_totals, settings.threads, timings[r]);
+    };
+
+    auto pipeline_begin = std::chrono::high_resolution_clock::now();
+    std::future<RoundInput> next_input = std::async(policy, aggregate, 0);
+    for (int r = 0; r < settings.rounds; r++)
+    {
+        RoundInput input = next_input.get();
+        const std::vector<double>& totalDeviation = input.totals.totalDeviation;
+
+        // with overlap, the next round is shared and aggregated while this one is billed
+        if (r + 1 < settings.rounds)
+            next_input = std::async(policy, aggregate, r + 1);
+
+        auto setup_begin = std::chrono::high_resolution_clock::now();
+        auto [
+            maskTotalDevPositive,
+            maskTotalDevZero,
+            maskTotalDevNegative
+        ] = server_setup(totalDeviation);
+        auto setup_end = std::chrono::high_resolution_clock::now();
+
+        BillingPlan plan = plan_billing(input.totals.totalConsumers, input.totals.totalProsumers, maskTotalDevPositive, maskTotalDevNegative);
+        RoundPlaintexts round_plaintexts = encode_round_plaintexts(cc, ckks_pub_key, tradingPrice, feedInTarif, input.totals.totalProsumers,
+                                                                   totalDeviation, maskTotalDevPositive, maskTotalDevNegative,
+                                                                   BILLING_CKKS, plan);
+        std::vector<TariffPlaintexts> tariff_plaintexts(groups.size());
+        #pragma omp parallel for num_threads(settings.threads) schedule(dynamic)
+        for (unsigned int g = 0; g < groups.size(); g++)
+            tariff_plaintexts[g] = encode_tariff_plaintexts(cc, ckks_pub_key, tradingPrice, groups[g].retailPrice,
+                                                            input.totals.totalConsumers, totalDeviation, BILLING_CKKS, plan);
+        auto encoding_end = std::chrono::high_resolution_clock::now();
+
+        std::vector<Ciphertext<DCRTPoly>> bills(NR_CLIENTS), rewards(NR_CLIENTS);
+        std::vector<BillingOps> client_ops(NR_CLIENTS);
+        #pragma omp parallel for num_threads(settings.threads) schedule(dynamic)
+        for (int userID = 0; userID < NR_CLIENTS; userID++)
+        {
+            const ClientData& client = clients[userID];
+            ClientUpload upload;
+            if (input.uploads.empty())
+            {
+                auto [
+                    ct_consumption,
+                    ct_supplies,
+                    ct_deviations,
+                    ct_signs,
+                    ct_accepted
+                ] = client_setup(cc, ckks_pub_key, client.consumptions, client.supplies, client.deviations, client.accepted,
+                                 BILLING_CKKS, client.can_supply);
+                upload = {ct_consumption, ct_supplies, ct_deviations, ct_signs, ct_accepted};
+            }
+            else
+                upload = input.uploads[userID];
+
+            auto [ct_bill, ct_reward] = server_billing(
+                cc,
+                round_plaintexts,
+                tariff_plaintexts[group_of_client[userID]],
+
+                upload.consumption,
+                upload.supplies,
+                upload.deviations,
+                upload.signs,
+                upload.accepted,
+                &client_ops[userID]
+            );
+            bills[userID] = ct_bill;
+            rewards[userID] = ct_reward;
+        }
+        auto billing_end = std::chrono::high_resolution_clock::now();
+
+        timings[r].server_setup_us = std::chrono::duration_cast<std::chrono::microseconds>(setup_end - setup_begin).count();
+        timings[r].encoding_us = std::chrono::duration_cast<std::chrono::microseconds>(encoding_end - setup_end).count();
+        timings[r].billing_us = std::chrono::duration_cast<std::chrono::microseconds>(billing_end - encoding_end).count();
+
+        // the shared total must be the sum of the individual deviations
+        double max_error = 0.0, max_file_error = 0.0, max_count_error = 0.0;
+        for (int t = 0; t < TIMESLOTS; t++)
+        {
+            double expected = 0.0;
+            for (const ClientData& client : clients)
+                expected += client.deviations[t];
+            max_error = std::max(max_error, std::fabs(expected - totalDeviation[t]));
+            max_file_error = std::max(max_file_error, std::fabs(fileTotalDeviation[t] - totalDeviation[t]));
+            max_count_error = std::max({max_count_error, std::fabs(totalConsumers[t] - input.totals.totalConsumers[t]),
+                                        std::fabs(totalProsumers[t] - input.totals.totalProsumers[t])});
+        }
+        // the FHE totals are rounded to the 4 decimals of the data
+        assert(max_error < (settings.fhe_totals ? 1e-4 : 1e-6 * NR_CLIENTS));
+
+        // the bills of the tariff groups and of the pruned circuit must be those of the dataset
+        double max_bill_error = 0.0, max_reward_error = 0.0;
+        for (int userID = 0; userID < NR_CLIENTS; userID++)
+        {
+            max_bill_error = std::max(max_bill_error, max_abs_difference(decrypt_billing(cc, keys.secretKey, bills[userID], BILLING_CKKS),
+                                                                         clients[userID].expectedBill));
+            max_reward_error = std::max(max_reward_error, max_abs_difference(decrypt_billing(cc, keys.secretKey, rewards[userID], BILLING_CKKS),
+                                                                             clients[userID].expectedReward));
+        }
+        assert(max_bill_error < 1e-2 && max_reward_error < 1e-2);
+
+        // operations that were evaluated, checked against those expected for the plan
+        BillingOps ops = encoding_ops(round_plaintexts);
+        for (const TariffPlaintexts& tariff : tariff_plaintexts)
+            ops += encoding_ops(tariff);
+        for (const BillingOps& billing_ops : client_ops)
+            ops += billing_ops;
+        BillingOps planned_ops = round_billing_ops(plan, groups.size(), can_supply);
+        assert(ops.encodings == planned_ops.encodings && ops.encryptions == planned_ops.encryptions
+               && ops.mults == planned_ops.mults && ops.plain_mults == planned_ops.plain_mults
+               && ops.additions == planned_ops.additions && ops.relinearizations == planned_ops.relinearizations);
+
+        // without pruning, every branch is evaluated and every client has a reward
+        BillingOps full_ops = round_billing_ops(BillingPlan(), groups.size(), std::vector<bool>(NR_CLIENTS, true));
+
+        // Display results
+        std::cout << "round: " << r
+                  << " -> " << (settings.fhe_totals ? "encryption: " : "sharing: ") << timings[r].sharing_us
+                  << ", aggregation: " << timings[r].aggregation_us
+                  << ", server_setup: " << timings[r].server_setup_us
+                  << ", encoding: " << timings[r].encoding_us
+                  << ", billing: " << timings[r].billing_us
+                  << ", max |totalDeviation - context.csv|: " << max_file_error
+                  << ", max |P2P counts - context.csv|: " << max_count_error
+                  << ", max |bill - expectedBill|: " << max_bill_error
+                  << ", max |reward - expectedReward|: " << max_reward_error
+                  << ", evaluated: " << ops.total() << " operations (relinearizations " << ops.relinearizations << ")"
+                  << ", pruned: " << full_ops.total() - ops.total() << " of " << full_ops.total() << " operations"
+                  << " (encodings " << full_ops.encodings - ops.encodings
+                  << ", encryptions " << full_ops.encryptions - ops.encryptions
+                  << ", mults " << full_ops.mults - ops.mults
+                  << ", plain mults " << full_ops.plain_mults - ops.plain_mults
+                  << ", additions " << full_ops.additions - ops.additions
+                  << ", relinearizations " << full_ops.relinearizations - ops.relinearizations << ")"
+                  << std::endl;
+    }
+    auto pipeline_end = std::chrono::high_resolution_clock::now();
+    delete_csprngs(sharing_keys);
+
+    double wall_s = std::chrono::duration<double>(pipeline_end - pipeline_begin).count();
+    std::cout << "nr_clients: " << NR_CLIENTS << ", "
+              << "nr_time_slots: " << TIMESLOTS << ", "
+              << "threads: " << settings.threads << ", "
+              << "overlap: " << settings.overlap << ", "
+              << "totals: " << (settings.fhe_totals ? "fhe" : "masking")
+              << " -> rounds: " << settings.rounds
+              << ", wall: " << wall_s << " s"
+              << ", rounds per hour: " << settings.rounds / wall_s * 3600
+              << std::endl;
+}
+
+
+int main(int argc, char* argv[])
+{
+    PipelineSettings settings = parse_arguments(argc, argv);
+    if (settings.tariffs)
+        tariff_distribution_experiment();
+    else
+        pipeline_experiment(settings);
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include "seeded_ckks.h"
+#include "csprng.h"
+
+#include <random>
+#include <cstring>
+#include <endian.h>
+
+using namespace lbcrypto;
+using namespace std;
+
+
+// blocks of keystream generated at once when expanding a tower
+static const int EXPANSION_BLOCKS = 1024;
+
+
+void expand_seed(const uint8_t* seed, const std::shared_ptr<DCRTPoly::Params>& params, DCRTPoly& a)
+{
+    CSPRNG csprng((int8_t*) seed);
+    a = DCRTPoly(params, Format::EVALUATION, true);
+
+    const std::vector<std::shared_ptr<ILNativeParams>>& towers = params->GetParams();
+    uint32_t ring_dim = params->GetRingDimension();
+    vector<uint64_t> words(EXPANSION_BLOCKS * 2);
+    for (uint32_t i = 0; i < towers.size(); i++){
+        uint64_t q = towers[i]->GetModulus().ConvertToInt();
+        uint64_t mask = ~0ull >> __builtin_clzll(q); // bits of q
+
+        // tower i is taken from round i of the keystream; words >= q are rejected
+        NativeVector values(ring_dim, towers[i]->GetModulus());
+        uint64_t block = 0;
+        size_t used = words.size();
+        for (uint32_t j = 0; j < ring_dim; ){
+            if (used == words.size()){
+                csprng.keystream_blocks(i, block, EXPANSION_BLOCKS, (uint8_t*) words.data());
+                block += EXPANSION_BLOCKS;
+                used = 0;
+            }
+            uint64_t x = le64toh(words[used++]) & mask;
+            if (x < q)
+                values[j++] = NativeInteger(x);
+        }
+        DCRTPoly::PolyType tower(towers[i], Format::EVALUATION);
+        tower.SetValues(std::move(values), Format::EVALUATION);
+        a.SetElementAtIndex(i, std::move(tower));
+    }
+}
+
+
+SeededCiphertext pack_and_encrypt_seeded(
+    const vector<double>& msg,
+    CryptoContext<DCRTPoly>& cc,
+    const PrivateKey<DCRTPoly>& ckks_sk
+)
+{
+    SeededCiphertext upload;
+    std::random_device rd; // getrandom / /dev/urandom
+    for (int b = 0; b < SEED_BYTES; b += 4){
+        uint32_t r = rd();
+        memcpy(upload.seed + b, &r, 4);
+    }
+
+    Plaintext ptxt_msg = cc->MakeCKKSPackedPlaintext(msg); // pack
+    DCRTPoly m = ptxt_msg->GetElement<DCRTPoly>();
+    m.SetFormat(Format::EVALUATION);
+    const std::shared_ptr<DCRTPoly::Params> params = m.GetParams();
+
+    // the secret key has all the towers, the plaintext only those of its level
+    DCRTPoly s = ckks_sk->GetPrivateElement();
+    if (s.GetNumOfElements() > m.GetNumOfElements())
+        s.DropLastElements(s.GetNumOfElements() - m.GetNumOfElements());
+
+    auto crypto_params = std::dynamic_pointer_cast<CryptoParametersRNS>(ckks_sk->GetCryptoParameters());
+    DCRTPoly e(crypto_params->GetDiscreteGaussianGenerator(), params, Format::EVALUATION);
+
+    DCRTPoly a;
+    expand_seed(upload.seed, params, a);
+
+    // b = m + e - a * s, as in the secret-key encryption of OpenFHE
+    upload.body = std::make_shared<CiphertextImpl<DCRTPoly>>(ckks_sk);
+    upload.body->SetElements({m + e - a * s});
+    upload.body->SetEncodingType(ptxt_msg->GetEncodingType());
+    upload.body->SetScalingFactor(ptxt_msg->GetScalingFactor());
+    upload.body->SetNoiseScaleDeg(ptxt_msg->GetNoiseScaleDeg());
+    upload.body->SetLevel(ptxt_msg->GetLevel());
+    upload.body->SetSlots(ptxt_msg->GetSlots());
+    return upload;
+}
+
+
+Ciphertext<DCRTPoly> expand_ciphertext(const SeededCiphertext& upload)
+{
+    const DCRTPoly& b = upload.body->GetElements()[0];
+    DCRTPoly a;
+    expand_seed(upload.seed, b.GetParams(), a);
+
+    Ciphertext<DCRTPoly> ctxt = upload.body->Clone();
+    ctxt->SetElements({b, a});
+    return ctxt;
+}
+
+
+size_t upload_bytes(const SeededCiphertext& upload, const CryptoContext<DCRTPoly>& cc)
+{
+    return ciphertext_bytes(upload.body, cc) + SEED_BYTES;
+}
@@ -0,0 +1,53 @@
+/**
+ *  Secret-key CKKS encryption with a seeded random component, for the uploads
+ *  of the clients.
+ *
+ *  A secret-key encryption of m is (b, a) with a uniformly random and
+ *  b = m + e - a * s. Here a is expanded from a 16-byte seed with the AES
+ *  keystream of the CSPRNG (tower i of a from round i of the keystream), so
+ *  the client only uploads b and the seed: about half of a public-key
+ *  ciphertext. The server expands the seed into a again and gets a usual
+ *  two-element ciphertext, so the billing does not change.
+ *
+ *  Secret-key encryption also skips the encryption of zero under the public
+ *  key, and its noise is a single Gaussian e instead of v * e_pk + e_0 + s * e_1.
+ */
+
+#ifndef __SEEDED_CKKS
+#define __SEEDED_CKKS
+
+#include <cstdint>
+#include <vector>
+
+#include "utils_ckks.h"
+
+
+static const int SEED_BYTES = 16;
+
+struct SeededCiphertext
+{
+    Ciphertext<DCRTPoly> body; // ciphertext with the single element b
+    uint8_t seed[SEED_BYTES];  // AES key from which a is expanded
+};
+
+
+/**
+ *  Writes in a the polynomial expanded from seed, in evaluation format, with
+ *  the towers of params. Tower i is uniform mod q_i (by rejection sampling).
+ */
+void expand_seed(const uint8_t* seed, const std::shared_ptr<DCRTPoly::Params>& params, DCRTPoly& a);
+
+/** Encrypts msg under ckks_sk, with a expanded from a fresh random seed */
+SeededCiphertext pack_and_encrypt_seeded(
+    const std::vector<double>& msg,
+    CryptoContext<DCRTPoly>& cc,
+    const PrivateKey<DCRTPoly>& ckks_sk
+);
+
+/** Server side: the ciphertext (b, a) of an upload */
+Ciphertext<DCRTPoly> expand_ciphertext(const SeededCiphertext& upload);
+
+/** Bytes of an upload: the towers of b and the seed */
+size_t upload_bytes(const SeededCiphertext& upload, const CryptoContext<DCRTPoly>& cc);
+
+#endif
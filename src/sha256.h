@@ -0,0 +1,31 @@
+/**
+ *  SHA-256 (FIPS 180-4), used to derive the pairwise AES seeds from the
+ *  X25519 shared secrets.
+ */
+
+#ifndef __SHA256
+#define __SHA256
+
+#include <cstdint>
+#include <cstddef>
+
+
+static const int SHA256_DIGEST_BYTES = 32;
+
+struct SHA256Context
+{
+    uint32_t state[8];
+    uint64_t n_bytes; // total length of the message so far
+    uint8_t buffer[64]; // pending bytes of the current block
+};
+
+void sha256_init(SHA256Context* ctx);
+
+void sha256_update(SHA256Context* ctx, const uint8_t* data, size_t len);
+
+void sha256_final(SHA256Context* ctx, uint8_t digest[SHA256_DIGEST_BYTES]);
+
+// digest = SHA-256(data[0, ..., len-1])
+void sha256(const uint8_t* data, size_t len, uint8_t digest[SHA256_DIGEST_BYTES]);
+
+#endif
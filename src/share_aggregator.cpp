@@ -0,0 +1,133 @@
+#include "share_aggregator.h"
+
+#include <stdexcept>
+#include <algorithm>
+
+#include <immintrin.h>
+
+using namespace std;
+
+
+/**
+ *  acc[t] += shares[t] for t = 0, ..., n - 1, zero-extending the shares to 64 bits,
+ *  with AVX2 (4 lanes). Selected at runtime by add_row.
+ */
+__attribute__((target("avx2")))
+static void add_row_avx2(uint64_t* acc, const uint32_t* shares, int n){
+    int t = 0;
+    for (; t + 8 <= n; t += 8){
+        __m256i s = _mm256_loadu_si256((const __m256i*) (shares + t));
+        __m256i lo = _mm256_cvtepu32_epi64(_mm256_castsi256_si128(s));
+        __m256i hi = _mm256_cvtepu32_epi64(_mm256_extracti128_si256(s, 1));
+        __m256i a_lo = _mm256_loadu_si256((const __m256i*) (acc + t));
+        __m256i a_hi = _mm256_loadu_si256((const __m256i*) (acc + t + 4));
+        _mm256_storeu_si256((__m256i*) (acc + t), _mm256_add_epi64(a_lo, lo));
+        _mm256_storeu_si256((__m256i*) (acc + t + 4), _mm256_add_epi64(a_hi, hi));
+    }
+    for (; t < n; t++)
+        acc[t] += shares[t];
+}
+
+/** Same as add_row_avx2, with SSE2 (2 lanes), which every x86-64 CPU has */
+static void add_row_sse2(uint64_t* acc, const uint32_t* shares, int n){
+    int t = 0;
+    const __m128i zero = _mm_setzero_si128();
+    for (; t + 4 <= n; t += 4){
+        __m128i s = _mm_loadu_si128((const __m128i*) (shares + t));
+        __m128i lo = _mm_unpacklo_epi32(s, zero);
+        __m128i hi = _mm_unpackhi_epi32(s, zero);
+        __m128i a_lo = _mm_loadu_si128((const __m128i*) (acc + t));
+        __m128i a_hi = _mm_loadu_si128((const __m128i*) (acc + t + 2));
+        _mm_storeu_si128((__m128i*) (acc + t), _mm_add_epi64(a_lo, lo));
+        _mm_storeu_si128((__m128i*) (acc + t + 2), _mm_add_epi64(a_hi, hi));
+    }
+    for (; t < n; t++)
+        acc[t] += shares[t];
+}
+
+static bool cpu_supports_avx2(){
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+static const bool use_avx2 = cpu_supports_avx2();
+
+static void add_row(uint64_t* acc, const uint32_t* shares, int n){
+    if (use_avx2)
+        add_row_avx2(acc, shares, n);
+    else
+        add_row_sse2(acc, shares, n);
+}
+
+
+ShareAggregator::ShareAggregator(int n_slots, uint32_t modulus) {
+    if (modulus >= (1u << 30))
+        throw std::invalid_argument("ShareAggregator assumes a modulus smaller than 2^30.");
+    this->n_slots = n_slots;
+    this->modulus = modulus;
+    this->n_shares = 0;
+    this->acc = vector<uint64_t>(n_slots, 0);
+}
+
+
+void ShareAggregator::add_shares(const uint32_t* shares){
+    add_row(acc.data(), shares, n_slots);
+    n_shares++;
+}
+
+
+void ShareAggregator::add_correction(const uint32_t* correction){
+    add_row(acc.data(), correction, n_slots);
+}
+
+
+void ShareAggregator::add_share_matrix(const uint32_t* shares, int n_users){
+    // Go through the matrix in column blocks that fit in L1, so that the
+    // accumulators of the block stay in cache while all the rows are added.
+    const int block = 1024;
+    for (int t0 = 0; t0 < n_slots; t0 += block){
+        int len = min(block, n_slots - t0);
+        for (int i = 0; i < n_users; i++)
+            add_row(acc.data() + t0, shares + (size_t) i * n_slots + t0, len);
+    }
+    n_shares += n_users;
+}
+
+
+void ShareAggregator::add_aggregator(const ShareAggregator& other){
+    if (other.n_slots != n_slots || other.modulus != modulus)
+        throw std::invalid_argument("It is impossible to combine aggregators of different sizes or moduli.");
+    for (int t = 0; t < n_slots; t++)
+        acc[t] += other.acc[t];
+    n_shares += other.n_shares;
+}
+
+
+void ShareAggregator::reset(){
+    fill(acc.begin(), acc.end(), 0);
+    n_shares = 0;
+}
+
+
+vector<uint32_t> ShareAggregator::result() const{
+    vector<uint32_t> res(n_slots);
+    for (int t = 0; t < n_slots; t++)
+        res[t] = acc[t] % modulus;
+    return res;
+}
+
+
+vector<double> ShareAggregator::decode(double scale) const{
+    vector<double> res(n_slots);
+    for (int t = 0; t < n_slots; t++)
+        res[t] = centered_lift(acc[t], modulus) / scale;
+    return res;
+}
+
+
+int64_t centered_lift(uint64_t x, uint32_t modulus){
+    int64_t r = x % modulus;
+    if (r > modulus / 2)
+        r -= modulus;
+    return r;
+}
@@ -0,0 +1,77 @@
+/**
+ *  Server-side aggregation of the users' shares.
+ *
+ *  Shares are elements of Z_p with p < 2^30 stored as uint32_t. Instead of
+ *  reducing after every addition (as sum_mod does), the aggregator adds the
+ *  shares of each time slot into 64-bit accumulators with SIMD instructions
+ *  and only reduces mod p when the result is requested. The accumulators can
+ *  absorb 2^34 shares before they would overflow, so in practice the reduction
+ *  happens once per round.
+ */
+
+#ifndef __SHARE_AGGREGATOR
+#define __SHARE_AGGREGATOR
+
+#include <cstdint>
+#include <vector>
+
+
+// values are read with 4 decimals (see parseToDoubles), so they are scaled by 10^4
+static const double FIXED_POINT_SCALE = 10000.0;
+
+
+class ShareAggregator
+{
+    public:
+
+        int n_slots;
+        uint32_t modulus;
+
+        int n_shares; // number of share vectors added since the last reset
+
+        std::vector<uint64_t> acc; // one (unreduced) accumulator per time slot
+
+        ShareAggregator(int n_slots, uint32_t modulus);
+
+        /**
+         *  Adds the n_slots shares of one user. Meant to be called as the
+         *  shares arrive at the server.
+         */
+        void add_shares(const uint32_t* shares);
+
+        /**
+         *  Adds a n_users x n_slots matrix of shares stored row by row
+         *  (i.e., the shares of user i are shares[i*n_slots, ..., (i+1)*n_slots - 1]).
+         */
+        void add_share_matrix(const uint32_t* shares, int n_users);
+
+        /**
+         *  Adds a vector of n_slots values mod modulus that is not the share of
+         *  a user (e.g., a dropout correction), so n_shares is left unchanged.
+         */
+        void add_correction(const uint32_t* correction);
+
+        /**
+         *  Adds the accumulators of another aggregator with the same number of slots
+         *  and modulus, e.g., to combine the partial sums of several threads.
+         */
+        void add_aggregator(const ShareAggregator& other);
+
+        // sets all the accumulators to zero
+        void reset();
+
+        /** Returns the sum of the shares of each time slot, in {0, 1, ..., modulus-1} */
+        std::vector<uint32_t> result() const;
+
+        /**
+         *  Interprets the sum of each time slot as a signed fixed-point value, that is,
+         *  lifts it to (-modulus/2, modulus/2] and divides it by scale.
+         */
+        std::vector<double> decode(double scale = FIXED_POINT_SCALE) const;
+};
+
+
+/** Maps x in Z_p to the integer in (-modulus/2, modulus/2] congruent to it */
+int64_t centered_lift(uint64_t x, uint32_t modulus);
+
+#endif
@@ -0,0 +1,401 @@
+#include "sharing.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+
+#include "x25519.h"
+#include "sha256.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+
+
+SEED gen_random_seed() {
+	SEED s = (SEED) malloc(16 * sizeof(int8_t));
+	for(int i = 0; i < 16; i++)
+		s[i] = rand() % 256;
+	return s;
+}
+
+void erase_seed(SEED s) {
+	free(s);
+}
+
+void print_seed(SEED s) {
+	if (NULL == s) {
+		cout << "{ }" << endl;
+	}else {
+		for(int i = 0; i < 16; i++)
+			cout << (int) s[i] << " ";
+		cout << endl;
+	}
+}
+
+/** Generates one seed per edge of the graph (O(n^2) seeds for the complete graph) */
+vector<vector<SEED>> generate_seed_matrix(const CommunicationGraph& graph) {
+    int n_users = graph.n_users;
+	vector<vector<SEED> > seed_matrix(n_users);
+	for(int i = 0; i < n_users; i++)
+		seed_matrix[i] = vector<SEED>(graph.neighbours[i].size(), NULL);
+
+	for(int i = 0; i < n_users; i++){
+		const vector<int>& adj = graph.neighbours[i];
+		for(unsigned int t = 0; t < adj.size(); t++){
+			int j = adj[t];
+			if (i < j){
+				SEED s = gen_random_seed();
+				seed_matrix[i][t] = s;
+				// position of i in the (sorted) neighbourhood of j
+				const vector<int>& adj_j = graph.neighbours[j];
+				int t_j = lower_bound(adj_j.begin(), adj_j.end(), i) - adj_j.begin();
+				seed_matrix[j][t_j] = s;
+			}
+		}
+	}
+	return seed_matrix;
+}
+
+/** Frees the seeds generated by generate_seed_matrix (each edge owns one seed) */
+void delete_seed_matrix(const CommunicationGraph& graph, vector<vector<SEED> >& seed_matrix){
+    int n_users = seed_matrix.size();
+	for(int i = 0; i < n_users; i++){
+		for(unsigned int t = 0; t < seed_matrix[i].size(); t++){
+			if (i < graph.neighbours[i][t]){
+			    erase_seed(seed_matrix[i][t]);
+			}
+		}
+	}
+}
+
+vector<vector<CSPRNG*> > init_csprngs(const CommunicationGraph& graph, const vector<vector<SEED> >& seeds) {
+    int n_users = seeds.size();
+	vector<vector<CSPRNG*> > csprng_matrix(n_users);
+	for(int i = 0; i < n_users; i++)
+		csprng_matrix[i] = vector<CSPRNG*>(seeds[i].size(), NULL);
+
+	for(int i = 0; i < n_users; i++){
+		const vector<int>& adj = graph.neighbours[i];
+		for(unsigned int t = 0; t < adj.size(); t++){
+			int j = adj[t];
+			if (i < j){
+				CSPRNG* csprng = new CSPRNG(seeds[i][t]);
+				csprng_matrix[i][t] = csprng;
+				const vector<int>& adj_j = graph.neighbours[j];
+				int t_j = lower_bound(adj_j.begin(), adj_j.end(), i) - adj_j.begin();
+				csprng_matrix[j][t_j] = csprng;
+			}
+		}
+	}
+	return csprng_matrix;
+}
+
+void delete_csprngs(SharingKeys& keys){
+    int n_users = keys.csprngs.size();
+	for(int i = 0; i < n_users; i++){
+		for(unsigned int t = 0; t < keys.csprngs[i].size(); t++){
+			if (i < keys.graph.neighbours[i][t]){
+			    delete keys.csprngs[i][t];
+			}
+		}
+	}
+	keys.csprngs.clear();
+}
+
+SharingKeys setup(const CommunicationGraph& graph) {
+    vector<vector<SEED> > seeds = generate_seed_matrix(graph);
+    SharingKeys keys;
+    keys.graph = graph;
+    keys.csprngs = init_csprngs(graph, seeds);
+    delete_seed_matrix(graph, seeds);
+
+    return keys;
+}
+
+/**
+ *  Memory used by the keys: the pairwise CSPRNGs (one per edge) plus the
+ *  adjacency lists and the per-user tables of CSPRNG pointers.
+ */
+size_t sharing_keys_bytes(const SharingKeys& keys) {
+    size_t bytes = keys.graph.n_edges() * sizeof(CSPRNG);
+    for (unsigned int i = 0; i < keys.csprngs.size(); i++){
+        bytes += sizeof(vector<int>) + keys.graph.neighbours[i].capacity() * sizeof(int);
+        bytes += sizeof(vector<CSPRNG*>) + keys.csprngs[i].capacity() * sizeof(CSPRNG*);
+    }
+    return bytes;
+}
+
+/** Original setup, in which every user shares a seed with every other user */
+SharingKeys setup(int n_users) {
+    return setup(complete_graph(n_users));
+}
+
+/**
+ *  Key derivation: seed = SHA-256(label || shared secret || pk_low || pk_high),
+ *  truncated to the 16 bytes of an AES-128 key, where pk_low is the public key
+ *  of the endpoint with the lower id. Binding the public keys makes the seed
+ *  depend on the pair and not only on the shared point.
+ */
+void derive_pairwise_seed(const uint8_t* shared_secret, const uint8_t* public_key_low, const uint8_t* public_key_high, SEED seed) {
+    static const char label[] = "energy-billing pairwise seed";
+    uint8_t acc = 0;
+    for (int i = 0; i < X25519_BYTES; i++)
+        acc |= shared_secret[i];
+    if (0 == acc)
+        throw std::runtime_error("X25519 gave the all-zero shared secret (low-order public key).");
+
+    SHA256Context ctx;
+    uint8_t digest[SHA256_DIGEST_BYTES];
+    sha256_init(&ctx);
+    sha256_update(&ctx, (const uint8_t*) label, sizeof(label) - 1);
+    sha256_update(&ctx, shared_secret, X25519_BYTES);
+    sha256_update(&ctx, public_key_low, X25519_BYTES);
+    sha256_update(&ctx, public_key_high, X25519_BYTES);
+    sha256_final(&ctx, digest);
+    memcpy(seed, digest, 16);
+    memset(digest, 0, sizeof(digest));
+}
+
+/**
+ *  Seeds agreed by the users themselves, as they would in a deployment: every
+ *  user draws an X25519 key pair and publishes the public key, then agrees with
+ *  each neighbour in one batched call and derives the seed of the edge. Both
+ *  endpoints of an edge derive the same seed, and the function checks it. Each
+ *  phase is parallelised over the users (n_threads = 0 uses the OpenMP default).
+ *  Returns the seeds in the layout of generate_seed_matrix.
+ */
+vector<vector<SEED>> agree_seed_matrix(const CommunicationGraph& graph, int n_threads) {
+    int n_users = graph.n_users;
+#ifdef _OPENMP
+    if (n_threads <= 0)
+        n_threads = omp_get_max_threads();
+#else
+    n_threads = 1;
+#endif
+
+    // key generation
+    vector<uint8_t> private_keys((size_t) n_users * X25519_BYTES);
+    vector<uint8_t> public_keys((size_t) n_users * X25519_BYTES);
+    #pragma omp parallel num_threads(n_threads)
+    {
+        std::random_device rd; // getrandom / /dev/urandom
+        #pragma omp for schedule(static)
+        for (int i = 0; i < n_users; i++){
+            uint8_t* sk = private_keys.data() + (size_t) i * X25519_BYTES;
+            for (int b = 0; b < X25519_BYTES; b += 4){
+                uint32_t r = rd();
+                memcpy(sk + b, &r, 4);
+            }
+            x25519_clamp(sk);
+            x25519_public_key(public_keys.data() + (size_t) i * X25519_BYTES, sk);
+        }
+    }
+
+    // agreement: derived[i][16 t, ..., 16 t + 15] is the seed user i derived with its t-th neighbour
+    vector<vector<uint8_t> > derived(n_users);
+    #pragma omp parallel for num_threads(n_threads) schedule(dynamic, 16)
+    for (int i = 0; i < n_users; i++){
+        const vector<int>& adj = graph.neighbours[i];
+        int degree = adj.size();
+        vector<uint8_t> peers((size_t) degree * X25519_BYTES), shared((size_t) degree * X25519_BYTES);
+        for (int t = 0; t < degree; t++)
+            memcpy(peers.data() + (size_t) t * X25519_BYTES, public_keys.data() + (size_t) adj[t] * X25519_BYTES, X25519_BYTES);
+        x25519_batch(shared.data(), private_keys.data() + (size_t) i * X25519_BYTES, peers.data(), degree);
+
+        derived[i].resize(16 * degree);
+        const uint8_t* own = public_keys.data() + (size_t) i * X25519_BYTES;
+        for (int t = 0; t < degree; t++){
+            const uint8_t* other = peers.data() + (size_t) t * X25519_BYTES;
+            const uint8_t* shared_t = shared.data() + (size_t) t * X25519_BYTES;
+            if (i < adj[t])
+                derive_pairwise_seed(shared_t, own, other, (SEED) derived[i].data() + 16 * t);
+            else
+                derive_pairwise_seed(shared_t, other, own, (SEED) derived[i].data() + 16 * t);
+        }
+        memset(shared.data(), 0, shared.size());
+    }
+    memset(private_keys.data(), 0, private_keys.size());
+
+    // one seed per edge, shared by both endpoints (as in generate_seed_matrix)
+	vector<vector<SEED> > seed_matrix(n_users);
+	for(int i = 0; i < n_users; i++)
+		seed_matrix[i] = vector<SEED>(graph.neighbours[i].size(), NULL);
+	for(int i = 0; i < n_users; i++){
+		const vector<int>& adj = graph.neighbours[i];
+		for(unsigned int t = 0; t < adj.size(); t++){
+			int j = adj[t];
+			if (i < j){
+				const vector<int>& adj_j = graph.neighbours[j];
+				int t_j = lower_bound(adj_j.begin(), adj_j.end(), i) - adj_j.begin();
+				if (0 != memcmp(derived[i].data() + 16 * t, derived[j].data() + 16 * t_j, 16))
+					throw std::runtime_error("Users " + to_string(i) + " and " + to_string(j) + " derived different seeds.");
+				SEED s = (SEED) malloc(16 * sizeof(int8_t));
+				memcpy(s, derived[i].data() + 16 * t, 16);
+				seed_matrix[i][t] = s;
+				seed_matrix[j][t_j] = s;
+			}
+		}
+		memset(derived[i].data(), 0, derived[i].size());
+	}
+	return seed_matrix;
+}
+
+/** Setup in which the pairwise seeds come from X25519 key agreement (see agree_seed_matrix) */
+SharingKeys setup_key_agreement(const CommunicationGraph& graph, int n_threads) {
+    vector<vector<SEED> > seeds = agree_seed_matrix(graph, n_threads);
+    SharingKeys keys;
+    keys.graph = graph;
+    keys.csprngs = init_csprngs(graph, seeds);
+    delete_seed_matrix(graph, seeds);
+
+    return keys;
+}
+
+/**
+ *  For each edge {i, j} with i < j, user i adds the common random value and
+ *  user j subtracts it, so all the shares sum to zero mod modulus.
+ *  Returns the share in {0, 1, ..., modulus-1}.
+ */
+int generate_share(int user_id, uint64_t round, int modulus, const SharingKeys& keys) {
+    const vector<int>& adj = keys.graph.neighbours[user_id];
+    int64_t share = 0;
+    for (unsigned int t = 0; t < adj.size(); t++){
+        uint32_t r;
+        keys.csprngs[user_id][t]->round_random_ints(round, 0, 1, modulus, &r);
+        if (user_id < adj[t])
+            share += r;
+        else
+            share -= r;
+        share %= modulus;
+    }
+    if (share < 0)
+        share += modulus;
+    return (int) share;
+}
+
+vector<int> generate_shares(uint64_t& round, int modulus, const SharingKeys& keys) {
+    int n_users = keys.csprngs.size();
+    vector<int> shares(n_users);
+    for (int i = 0; i < n_users; i++)
+        shares[i] = generate_share(i, round, modulus, keys);
+    round++;
+    return shares;
+}
+
+/**
+ *  Generates the shares of one user for the time slots first_slot, ..., first_slot + n_slots - 1
+ *  of a round and stores them, in {0, 1, ..., modulus-1}, in shares[0, ..., n_slots-1].
+ *  Only depends on (round, first_slot), so rounds and slot ranges can be generated
+ *  in any order and concurrently.
+ */
+void generate_share_vector(int user_id, uint64_t round, uint64_t first_slot, int n_slots, int modulus, const SharingKeys& keys, uint32_t* shares) {
+    const vector<int>& adj = keys.graph.neighbours[user_id];
+    vector<int64_t> acc(n_slots, 0);
+    vector<uint32_t> r(n_slots);
+    for (unsigned int t = 0; t < adj.size(); t++){
+        keys.csprngs[user_id][t]->round_random_ints(round, first_slot, n_slots, modulus, r.data());
+        if (user_id < adj[t]){
+            for (int s = 0; s < n_slots; s++)
+                acc[s] += r[s];
+        } else {
+            for (int s = 0; s < n_slots; s++)
+                acc[s] -= r[s];
+        }
+    }
+    for (int s = 0; s < n_slots; s++){
+        int64_t share = acc[s] % modulus;
+        shares[s] = (uint32_t) (share < 0 ? share + modulus : share);
+    }
+}
+
+/**
+ *  Returns the n_users x n_slots matrix (stored row by row) with the shares
+ *  of all users for this round.
+ */
+vector<uint32_t> generate_share_matrix(uint64_t round, int n_slots, int modulus, const SharingKeys& keys) {
+    int n_users = keys.csprngs.size();
+    vector<uint32_t> shares((size_t) n_users * n_slots);
+    for (int i = 0; i < n_users; i++)
+        generate_share_vector(i, round, 0, n_slots, modulus, keys, shares.data() + (size_t) i * n_slots);
+    return shares;
+}
+
+/**
+ *  Writes in shares[0, ..., n_slots-1] the values of user_id for this round
+ *  (e.g., its deviations), encoded with the codec and masked with the share
+ *  vector of the user. The server recovers the totals by aggregating the
+ *  masked vectors of all the users and decoding the result with the same codec.
+ *  Throws std::overflow_error if some value is out of the range of the codec.
+ */
+void generate_masked_vector(int user_id, uint64_t round, const double* values, int n_slots, const FixedPointCodec& codec,
+                            const SharingKeys& keys, uint32_t* shares) {
+    generate_share_vector(user_id, round, 0, n_slots, codec.modulus, keys, shares);
+    codec.mask(values, shares, n_slots, shares);
+}
+
+/**
+ *  Dropout recovery.
+ *
+ *  If user d does not report in a round, every surviving neighbour u of d has
+ *  the mask of the edge {u, d} in its share, but nobody cancels it. Each such
+ *  u sends the keystream of that edge for this round only (the keystream of
+ *  other rounds stays secret, since every round uses independent counters),
+ *  and the aggregator removes the contributions of all the neighbours of d at
+ *  once.
+ *
+ *  Writes in correction[0, ..., n_slots-1] the sum, mod modulus, of the masks
+ *  that the surviving neighbours of the dropped user put in their shares.
+ *  Edges between two dropped users are skipped, since neither share was received.
+ */
+void dropout_correction(int dropped_user, uint64_t round, int n_slots, int modulus, const SharingKeys& keys,
+                        const vector<bool>& dropped, uint32_t* correction) {
+    const vector<int>& adj = keys.graph.neighbours[dropped_user];
+    vector<int64_t> acc(n_slots, 0);
+    vector<uint32_t> r(n_slots);
+    for (unsigned int t = 0; t < adj.size(); t++){
+        int u = adj[t];
+        if (dropped[u])
+            continue;
+        keys.csprngs[dropped_user][t]->round_random_ints(round, 0, n_slots, modulus, r.data());
+        // u added the mask if u < dropped_user and subtracted it otherwise
+        if (u < dropped_user){
+            for (int s = 0; s < n_slots; s++)
+                acc[s] += r[s];
+        } else {
+            for (int s = 0; s < n_slots; s++)
+                acc[s] -= r[s];
+        }
+    }
+    for (int s = 0; s < n_slots; s++){
+        int64_t c = acc[s] % modulus;
+        correction[s] = (uint32_t) (c < 0 ? c + modulus : c);
+    }
+}
+
+/**
+ *  Removes from the aggregator the masks left by the dropped users, so that it
+ *  holds the sum of the values of the surviving users. The aggregator must
+ *  contain the shares of exactly the users not marked as dropped.
+ */
+void recover_dropouts(ShareAggregator& aggregator, uint64_t round, const SharingKeys& keys, const vector<bool>& dropped) {
+    int n_users = keys.csprngs.size();
+    int n_slots = aggregator.n_slots;
+    uint32_t modulus = aggregator.modulus;
+    vector<uint32_t> correction(n_slots);
+    for (int d = 0; d < n_users; d++){
+        if (!dropped[d])
+            continue;
+        dropout_correction(d, round, n_slots, modulus, keys, dropped, correction.data());
+        // subtract the correction, i.e., add its additive inverse
+        for (int s = 0; s < n_slots; s++)
+            correction[s] = (0 == correction[s]) ? 0 : modulus - correction[s];
+        aggregator.add_correction(correction.data());
+    }
+}
+
@@ -0,0 +1,80 @@
+/**
+ *  Pairwise-masking scheme used to share the total deviation: every pair of
+ *  adjacent users in the communication graph shares a CSPRNG, and the shares
+ *  of all the users sum to zero mod MODULUS.
+ */
+
+#ifndef __SHARING
+#define __SHARING
+
+#include <vector>
+#include <cstdint>
+
+#include "csprng.h"
+#include "communication_graph.h"
+#include "share_aggregator.h"
+#include "fixed_point_codec.h"
+
+
+static constexpr int MODULUS = 759250133; // 30-bit prime (close to 2^29.5)
+
+typedef int8_t* SEED; // 16-byte AES key of a pair of users
+
+SEED gen_random_seed();
+
+void erase_seed(SEED s);
+
+void print_seed(SEED s);
+
+
+/**
+ *  Pairwise keys of all the users: csprngs[i][t] is the CSPRNG that user i
+ *  shares with its neighbour graph.neighbours[i][t]. Both endpoints of an edge
+ *  point to the same object, since they derive the same randomness.
+ */
+struct SharingKeys
+{
+    CommunicationGraph graph;
+    std::vector<std::vector<CSPRNG*> > csprngs;
+};
+
+
+std::vector<std::vector<SEED>> generate_seed_matrix(const CommunicationGraph& graph);
+
+void delete_seed_matrix(const CommunicationGraph& graph, std::vector<std::vector<SEED> >& seed_matrix);
+
+std::vector<std::vector<CSPRNG*> > init_csprngs(const CommunicationGraph& graph, const std::vector<std::vector<SEED> >& seeds);
+
+void delete_csprngs(SharingKeys& keys);
+
+SharingKeys setup(const CommunicationGraph& graph);
+
+SharingKeys setup(int n_users);
+
+void derive_pairwise_seed(const uint8_t* shared_secret, const uint8_t* public_key_low, const uint8_t* public_key_high, SEED seed);
+
+std::vector<std::vector<SEED>> agree_seed_matrix(const CommunicationGraph& graph, int n_threads = 0);
+
+SharingKeys setup_key_agreement(const CommunicationGraph& graph, int n_threads = 0);
+
+size_t sharing_keys_bytes(const SharingKeys& keys);
+
+
+int generate_share(int user_id, uint64_t round, int modulus, const SharingKeys& keys);
+
+std::vector<int> generate_shares(uint64_t& round, int modulus, const SharingKeys& keys);
+
+void generate_share_vector(int user_id, uint64_t round, uint64_t first_slot, int n_slots, int modulus, const SharingKeys& keys, uint32_t* shares);
+
+std::vector<uint32_t> generate_share_matrix(uint64_t round, int n_slots, int modulus, const SharingKeys& keys);
+
+void generate_masked_vector(int user_id, uint64_t round, const double* values, int n_slots, const FixedPointCodec& codec,
+                            const SharingKeys& keys, uint32_t* shares);
+
+
+void dropout_correction(int dropped_user, uint64_t round, int n_slots, int modulus, const SharingKeys& keys,
+                        const std::vector<bool>& dropped, uint32_t* correction);
+
+void recover_dropouts(ShareAggregator& aggregator, uint64_t round, const SharingKeys& keys, const std::vector<bool>& dropped);
+
+#endif
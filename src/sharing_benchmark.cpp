@@ -0,0 +1,263 @@
+/**
+ *  Scaling benchmark of the sharing subsystem.
+ *
+ *  For every topology and number of users it measures
+ *  - the setup time (seeds and pairwise CSPRNGs),
+ *  - the memory used by the keys, per user (counted from the data structures,
+ *    since the resident set size does not shrink when previous runs free memory),
+ *  and, for every number of time slots and threads,
+ *  - the per-round share generation time and throughput,
+ *  - the per-round aggregation time and throughput.
+ *
+ *  Results are written as CSV (default) or JSON, to stdout or to a file, e.g.
+ *      ./sharing_benchmark --users 1000,10000 --slots 24,96,35040 --threads 1,4 --format json --output sharing.json
+ */
+
+#include "sharing.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <algorithm>
+#include <chrono>
+#include <cassert>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+
+
+struct BenchmarkSettings
+{
+    vector<int> users = {100, 1000, 10000};
+    vector<int> slots = {24, 96, 8760, 35040};
+    vector<int> threads = {1};
+    vector<GraphTopology> topologies = {HARARY};
+    int rounds = 1;
+    string format = "csv";
+    string output = "";
+};
+
+struct BenchmarkResult
+{
+    GraphTopology topology;
+    int n_users;
+    int degree;
+    int n_slots;
+    int n_threads;
+    int rounds;
+    int64_t setup_us;
+    double bytes_per_user;
+    int64_t generation_us; // per round
+    int64_t aggregation_us; // per round
+};
+
+
+vector<int> parse_int_list(const string& s)
+{
+    vector<int> values;
+    stringstream stream(s);
+    string cell;
+    while (getline(stream, cell, ','))
+        values.push_back(stoi(cell));
+    return values;
+}
+
+GraphTopology parse_topology(const string& s)
+{
+    if (s == "complete")
+        return COMPLETE;
+    if (s == "harary")
+        return HARARY;
+    if (s == "expander")
+        return EXPANDER;
+    throw std::invalid_argument("unknown topology " + s);
+}
+
+BenchmarkSettings parse_arguments(int argc, char* argv[])
+{
+    BenchmarkSettings settings;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        string option = argv[i];
+        string value = argv[i + 1];
+        if (option == "--users")
+            settings.users = parse_int_list(value);
+        else if (option == "--slots")
+            settings.slots = parse_int_list(value);
+        else if (option == "--threads")
+            settings.threads = parse_int_list(value);
+        else if (option == "--rounds")
+            settings.rounds = stoi(value);
+        else if (option == "--format")
+            settings.format = value;
+        else if (option == "--output")
+            settings.output = value;
+        else if (option == "--topology")
+        {
+            settings.topologies.clear();
+            stringstream stream(value);
+            string cell;
+            while (getline(stream, cell, ','))
+                settings.topologies.push_back(parse_topology(cell));
+        }
+        else
+            throw std::invalid_argument("unknown option " + option);
+    }
+    return settings;
+}
+
+
+/**
+ *  Generates and aggregates the shares of all the users for one round, in
+ *  batches of users, so that the share matrix of a batch stays small even
+ *  for 35,040 slots. Adds the time spent generating and aggregating to
+ *  generation_us and aggregation_us.
+ */
+vector<uint32_t> run_round(uint64_t round, int n_slots, int n_threads, const SharingKeys& keys,
+                           int64_t& generation_us, int64_t& aggregation_us)
+{
+    int n_users = keys.csprngs.size();
+    int batch = max(1, (int) ((64u << 20) / (sizeof(uint32_t) * n_slots))); // 64 MB of shares
+    batch = min(batch, n_users);
+
+    vector<uint32_t> shares((size_t) batch * n_slots);
+    vector<ShareAggregator> partial(n_threads, ShareAggregator(n_slots, MODULUS));
+
+    for (int first = 0; first < n_users; first += batch)
+    {
+        int len = min(batch, n_users - first);
+
+        auto generation_begin = std::chrono::high_resolution_clock::now();
+        #pragma omp parallel for num_threads(n_threads) schedule(dynamic, 16)
+        for (int i = 0; i < len; i++)
+            generate_share_vector(first + i, round, 0, n_slots, MODULUS, keys, shares.data() + (size_t) i * n_slots);
+        auto generation_end = std::chrono::high_resolution_clock::now();
+
+        // each thread adds a contiguous range of users into its own accumulators
+        #pragma omp parallel num_threads(n_threads)
+        {
+#ifdef _OPENMP
+            int id = omp_get_thread_num(), nt = omp_get_num_threads();
+#else
+            int id = 0, nt = 1;
+#endif
+            int begin = (int) ((int64_t) len * id / nt), end = (int) ((int64_t) len * (id + 1) / nt);
+            partial[id].add_share_matrix(shares.data() + (size_t) begin * n_slots, end - begin);
+        }
+        auto aggregation_end = std::chrono::high_resolution_clock::now();
+
+        generation_us += std::chrono::duration_cast<std::chrono::microseconds>(generation_end - generation_begin).count();
+        aggregation_us += std::chrono::duration_cast<std::chrono::microseconds>(aggregation_end - generation_end).count();
+    }
+
+    auto merge_begin = std::chrono::high_resolution_clock::now();
+    for (int t = 1; t < n_threads; t++)
+        partial[0].add_aggregator(partial[t]);
+    vector<uint32_t> result = partial[0].result();
+    auto merge_end = std::chrono::high_resolution_clock::now();
+    aggregation_us += std::chrono::duration_cast<std::chrono::microseconds>(merge_end - merge_begin).count();
+
+    return result;
+}
+
+
+void write_csv(ostream& os, const vector<BenchmarkResult>& results)
+{
+    os << "topology,n_users,degree,n_slots,n_threads,rounds,setup_us,bytes_per_user,"
+       << "generation_us,aggregation_us,generated_shares_per_s,aggregated_shares_per_s" << endl;
+    for (const BenchmarkResult& r : results)
+    {
+        double n_shares = (double) r.n_users * r.n_slots;
+        os << topology_name(r.topology) << "," << r.n_users << "," << r.degree << ","
+           << r.n_slots << "," << r.n_threads << "," << r.rounds << ","
+           << r.setup_us << "," << r.bytes_per_user << ","
+           << r.generation_us << "," << r.aggregation_us << ","
+           << n_shares / max<int64_t>(r.generation_us, 1) * 1e6 << ","
+           << n_shares / max<int64_t>(r.aggregation_us, 1) * 1e6 << endl;
+    }
+}
+
+void write_json(ostream& os, const vector<BenchmarkResult>& results)
+{
+    os << "[" << endl;
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const BenchmarkResult& r = results[i];
+        double n_shares = (double) r.n_users * r.n_slots;
+        os << "  {\"topology\": \"" << topology_name(r.topology) << "\", "
+           << "\"n_users\": " << r.n_users << ", "
+           << "\"degree\": " << r.degree << ", "
+           << "\"n_slots\": " << r.n_slots << ", "
+           << "\"n_threads\": " << r.n_threads << ", "
+           << "\"rounds\": " << r.rounds << ", "
+           << "\"setup_us\": " << r.setup_us << ", "
+           << "\"bytes_per_user\": " << r.bytes_per_user << ", "
+           << "\"generation_us\": " << r.generation_us << ", "
+           << "\"aggregation_us\": " << r.aggregation_us << ", "
+           << "\"generated_shares_per_s\": " << n_shares / max<int64_t>(r.generation_us, 1) * 1e6 << ", "
+           << "\"aggregated_shares_per_s\": " << n_shares / max<int64_t>(r.aggregation_us, 1) * 1e6 << "}"
+           << (i + 1 < results.size() ? "," : "") << endl;
+    }
+    os << "]" << endl;
+}
+
+
+int main(int argc, char* argv[])
+{
+    srand(time(NULL)); // XXX not secure. Enough for timing experiments.
+
+    BenchmarkSettings settings = parse_arguments(argc, argv);
+    vector<BenchmarkResult> results;
+
+    for (GraphTopology topology : settings.topologies)
+    {
+        for (int n_users : settings.users)
+        {
+            CommunicationGraph graph = generate_graph(topology, n_users, log_degree(n_users), n_users);
+
+            auto setup_begin = std::chrono::high_resolution_clock::now();
+            SharingKeys keys = setup(graph);
+            auto setup_end = std::chrono::high_resolution_clock::now();
+            int64_t setup_us = std::chrono::duration_cast<std::chrono::microseconds>(setup_end - setup_begin).count();
+            double bytes_per_user = (double) sharing_keys_bytes(keys) / n_users;
+
+            for (int n_slots : settings.slots)
+            {
+                for (int n_threads : settings.threads)
+                {
+                    BenchmarkResult r = {topology, n_users, graph.max_degree(), n_slots, n_threads, settings.rounds,
+                                         setup_us, bytes_per_user, 0, 0};
+                    for (int round = 0; round < settings.rounds; round++)
+                    {
+                        vector<uint32_t> total = run_round(round, n_slots, n_threads, keys, r.generation_us, r.aggregation_us);
+                        for (uint32_t s : total)
+                            assert(0 == s);
+                    }
+                    r.generation_us /= settings.rounds;
+                    r.aggregation_us /= settings.rounds;
+                    results.push_back(r);
+
+                    cerr << topology_name(topology) << ", n_users: " << n_users << ", n_slots: " << n_slots
+                         << ", n_threads: " << n_threads << " -> generation: " << r.generation_us
+                         << ", aggregation: " << r.aggregation_us << endl;
+                }
+            }
+            delete_csprngs(keys);
+        }
+    }
+
+    ofstream file;
+    if (!settings.output.empty())
+        file.open(settings.output);
+    ostream& os = settings.output.empty() ? cout : file;
+    if (settings.format == "json")
+        write_json(os, results);
+    else
+        write_csv(os, results);
+
+    return 0;
+}
@@ -1,136 +1,35 @@
-#include "csprng.h"
+#include "sharing.h"
+#include "rns_shares.h"
 #include "vectorutils.hpp"
+#include "x25519.h"
+#include "sha256.h"
 #include <vector>
 #include <iostream>
 #include <cassert>
 #include <chrono>
 #include <time.h>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <stdexcept>
 
 using namespace std;
 
-static const int MODULUS = 759250133; // 30-bit prime (close to 2^29.5)
 static const int NR_TIME_SLOTS = 1000; // each user will generate shares for this amount of time slots
 
-#define SEED int8_t* 
-
-SEED gen_random_seed() {
-	SEED s = (SEED) malloc(16 * sizeof(int8_t));
-	for(int i = 0; i < 16; i++)
-		s[i] = rand() % 256;
-	return s;
-}
-
-void erase_seed(SEED s) {
-	free(s);
-}
-
-void print_seed(SEED s) {
-	if (NULL == s) {
-		cout << "{ }" << endl;
-	}else {
-		for(int i = 0; i < 16; i++)
-			cout << (int) s[i] << " ";
-		cout << endl;
-	}
-}
-
-/** Generates the O(n^2) seeds corresponding to all the n users */
-vector<vector<SEED>> generate_seed_matrix(int n_users) {
-	vector<vector<SEED> > seed_matrix(n_users);
-	for(int i = 0; i < n_users; i++){
-		seed_matrix[i] = vector<SEED>(n_users);
-		for(int j = 0; j < n_users; j++){
-			if (i == j){
-				seed_matrix[i][j] = NULL;
-			}else {
-				seed_matrix[i][j] = gen_random_seed();
-			}
-		}
-	}
-	return seed_matrix;
-}
-/** Generates the O(n^2) seeds corresponding to all the n users */
-void delete_seed_matrix(vector<vector<SEED> >& seed_matrix){
-    int n_users = seed_matrix.size();
-	for(int i = 0; i < n_users; i++){
-		for(int j = 0; j < n_users; j++){
-			if (i != j){
-			    erase_seed(seed_matrix[i][j]);
-			}
-		}
-	}
-}
-
-vector<vector<CSPRNG*> > init_csprngs(const vector<vector<SEED> >& seeds, int n_time_slots, int modulus) {
-    int n_users = seeds.size();
-	vector<vector<CSPRNG*> > csprng_matrix(n_users);
-	for(int i = 0; i < n_users; i++){
-		csprng_matrix[i] = vector<CSPRNG*>(n_users);
-		for(int j = 0; j < n_users; j++){
-			if (i == j){
-				csprng_matrix[i][j] = NULL;
-			} else {
-				csprng_matrix[i][j] = new CSPRNG(seeds[i][j]);
-			}
-		}
-	}
-	return csprng_matrix;
-}
-
-vector<vector<CSPRNG*> > setup(int n_users, int n_time_slots, int modulus) {
-    vector<vector<SEED> > seeds = generate_seed_matrix(n_users);
-    vector<vector<CSPRNG*> > csprngs = init_csprngs(seeds, n_time_slots, modulus);
-    delete_seed_matrix(seeds);
-
-    return csprngs;
-}
-
-int generate_share(int user_id, int round, int modulus, const vector<vector<CSPRNG*> >& csprngs) {
-    int n_users = csprngs.size();
-    int share = 0;
-    int iv = 126 + (1 << 7) * round;
-    for (int j = 0; j < n_users; j++){
-        if (user_id != j){
-            csprngs[user_id][j]->generate_random_bytes(iv, 1, modulus, 0);
-        	share += csprngs[user_id][j]->get_random_int(modulus);
-//            cout << "  +share = " << share << endl;
-            share %= modulus;
-        }
-    }
+void test_shares(const CommunicationGraph& graph){
+	cout << "keys = setup(graph);" << endl;
+	SharingKeys keys = setup(graph);
+	int n_users = graph.n_users;
 
-    for (int i = 0; i < n_users; i++){
-        if (user_id != i){
-            csprngs[i][user_id]->generate_random_bytes(iv, 1, modulus, 0);
-        	share -= csprngs[i][user_id]->get_random_int(modulus);
-//            cout << "  -share = " << share << endl;
-            share %= modulus;
-        }
-    }
-	return share;
-}
-
-vector<int> generate_shares(int& round, int modulus, const vector<vector<CSPRNG*> >& csprngs) {
-    int n_users = csprngs.size();
-    vector<int> shares(n_users);
-    for (int i = 0; i < n_users; i++)
-        shares[i] = generate_share(i, round, modulus, csprngs);
-    round++;
-    return shares;
-}
-
-
-void test_shares(int n_users){
-	cout << "csprngs = setup(n_users, n_time_slots, modulus);" << endl;
-	vector<vector<CSPRNG*> > csprngs = setup(n_users, NR_TIME_SLOTS, MODULUS);
-
-    int round = 0;
+    uint64_t round = 0;
 
     vector<int> shares(n_users);
 
     for(int i = 0; i < NR_TIME_SLOTS; i++){
         if (0 == i%100)
             cout << "generating shares for round " << round << endl;
-        shares = generate_shares(round, MODULUS, csprngs);
+        shares = generate_shares(round, MODULUS, keys);
         int s = sum_mod(shares, MODULUS);
 
         assert(0 == s); // sum of shares = 0 mod modulus
@@ -143,38 +42,652 @@ void test_shares(int n_users){
             }
         }
     }
+    delete_csprngs(keys);
+}
+
+void test_shares(int n_users){
+    test_shares(complete_graph(n_users));
+}
+
+/** Checks that the aggregated shares of every time slot are zero */
+void test_aggregation(const CommunicationGraph& graph, int n_slots){
+	SharingKeys keys = setup(graph);
+	int n_users = graph.n_users;
+
+    ShareAggregator aggregator(n_slots, MODULUS);
+    for(uint64_t round = 0; round < 10; round++){
+        vector<uint32_t> shares = generate_share_matrix(round, n_slots, MODULUS, keys);
+
+        aggregator.reset();
+        aggregator.add_share_matrix(shares.data(), n_users);
+        for (uint32_t s : aggregator.result())
+            assert(0 == s);
+
+        // the streaming interface must give the same result
+        aggregator.reset();
+        for (int i = 0; i < n_users; i++)
+            aggregator.add_shares(shares.data() + (size_t) i * n_slots);
+        for (double d : aggregator.decode())
+            assert(0.0 == d);
+    }
+    delete_csprngs(keys);
+}
+
+/** Checks that the sum of the surviving shares is zero after removing the dropped users' masks */
+void test_dropout(const CommunicationGraph& graph, int n_slots, double dropout_rate){
+	SharingKeys keys = setup(graph);
+	int n_users = graph.n_users;
+    ShareAggregator aggregator(n_slots, MODULUS);
+
+    for(uint64_t round = 0; round < 5; round++){
+        vector<uint32_t> shares = generate_share_matrix(round, n_slots, MODULUS, keys);
+        vector<bool> dropped(n_users, false);
+        for (int i = 0; i < n_users; i++)
+            dropped[i] = rand() < dropout_rate * RAND_MAX;
+
+        aggregator.reset();
+        for (int i = 0; i < n_users; i++){
+            if (!dropped[i])
+                aggregator.add_shares(shares.data() + (size_t) i * n_slots);
+        }
+        recover_dropouts(aggregator, round, keys, dropped);
+        for (uint32_t s : aggregator.result())
+            assert(0 == s);
+    }
+    delete_csprngs(keys);
+}
+
+/**
+ *  Checks that the shares of any (round, slot range) can be generated on their own,
+ *  in any order, and match the ones generated for the whole round.
+ */
+void test_random_access(const CommunicationGraph& graph, int n_slots){
+	SharingKeys keys = setup(graph);
+	int n_users = graph.n_users;
+
+    // rounds far apart, including counters that do not fit in 32 bits
+    const uint64_t rounds[] = {(1ull << 40) + 3, 7, 0, (1ull << 32), 6};
+    vector<vector<uint32_t> > full;
+    for (uint64_t round : rounds)
+        full.push_back(generate_share_matrix(round, n_slots, MODULUS, keys));
+
+    for (int k = 4; k >= 0; k--){
+        const int first_slot = 5, len = n_slots - 7;
+        vector<uint32_t> part(len);
+        for (int i = 0; i < n_users; i++){
+            generate_share_vector(i, rounds[k], first_slot, len, MODULUS, keys, part.data());
+            for (int s = 0; s < len; s++)
+                assert(part[s] == full[k][(size_t) i * n_slots + first_slot + s]);
+        }
+    }
+    // consecutive rounds are independent
+    assert(full[1] != full[4]);
+    delete_csprngs(keys);
+}
+
+/** Checks X25519 and SHA-256 against the test vectors of RFC 7748 and FIPS 180-2 */
+void test_x25519(){
+    auto from_hex = [](const char* hex, uint8_t* out){
+        for (int i = 0; hex[2*i]; i++)
+            out[i] = (uint8_t) stoi(string(hex + 2*i, 2), nullptr, 16);
+    };
+    uint8_t alice_sk[32], bob_sk[32], alice_pk[32], bob_pk[32], expected[32], out[32], shared[64];
+
+    from_hex("77076d0a7318a57d3c16c17251b26645df4c2f87ebc0992ab177fba51db92c2a", alice_sk);
+    from_hex("5dab087e624a8a4b79e17f8b83800ee66f3bb1292618b6fd1c2f8b27ff88e0eb", bob_sk);
+    from_hex("8520f0098930a754748b7ddcb43ef75a0dbf3a0d26381af4eba4a98eaa9b4e6a", expected);
+    x25519_public_key(alice_pk, alice_sk);
+    assert(0 == memcmp(alice_pk, expected, 32));
+    from_hex("de9edb7d7b7dc1b4d35b61c2ece435373f8343c85b78674dadfc7e146f882b4f", expected);
+    x25519_public_key(bob_pk, bob_sk);
+    assert(0 == memcmp(bob_pk, expected, 32));
+
+    from_hex("4a5d9d5ba4ce2de1728e3bf480350f25e07e21c947d19e3376f09b3c1e161742", expected);
+    x25519(out, alice_sk, bob_pk);
+    assert(0 == memcmp(out, expected, 32));
+    x25519(out, bob_sk, alice_pk);
+    assert(0 == memcmp(out, expected, 32));
+
+    // the batch gives the same results as one call per peer
+    uint8_t peers[64];
+    memcpy(peers, bob_pk, 32);
+    memcpy(peers + 32, alice_pk, 32);
+    x25519_batch(shared, alice_sk, peers, 2);
+    assert(0 == memcmp(shared, expected, 32));
+    x25519(out, alice_sk, alice_pk);
+    assert(0 == memcmp(shared + 32, out, 32));
+
+    from_hex("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", expected);
+    sha256((const uint8_t*) "abc", 3, out);
+    assert(0 == memcmp(out, expected, 32));
+    from_hex("248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1", expected);
+    const char* msg = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+    sha256((const uint8_t*) msg, strlen(msg), out);
+    assert(0 == memcmp(out, expected, 32));
+}
+
+/** Checks that the shares sum to zero when the seeds come from key agreement */
+void test_key_agreement(const CommunicationGraph& graph, int n_slots){
+	SharingKeys keys = setup_key_agreement(graph);
+	int n_users = graph.n_users;
+    ShareAggregator aggregator(n_slots, MODULUS);
+    for(uint64_t round = 0; round < 3; round++){
+        vector<uint32_t> shares = generate_share_matrix(round, n_slots, MODULUS, keys);
+        aggregator.reset();
+        aggregator.add_share_matrix(shares.data(), n_users);
+        for (uint32_t s : aggregator.result())
+            assert(0 == s);
+    }
+    delete_csprngs(keys);
+}
+
+/** Returns n random values with 4 decimals in [-max_abs, max_abs], like the deviations read by parseToDoubles */
+vector<double> random_deviations(int n, double max_abs){
+    vector<double> values(n);
+    int64_t bound = (int64_t) (max_abs * FIXED_POINT_SCALE);
+    for (int t = 0; t < n; t++)
+        values[t] = (int64_t) ((double) rand() / RAND_MAX * (2 * bound + 1)) % (2 * bound + 1) - bound;
+    for (int t = 0; t < n; t++)
+        values[t] /= FIXED_POINT_SCALE;
+    return values;
+}
+
+/**
+ *  Checks that masking fixed-point values and aggregating the masked vectors gives
+ *  the exact totals, also with every user at the edge of the range of the codec.
+ */
+void test_fixed_point(const CommunicationGraph& graph, int n_slots){
+	SharingKeys keys = setup(graph);
+	int n_users = graph.n_users;
+    FixedPointCodec codec(MODULUS, n_users);
+    ShareAggregator aggregator(n_slots, MODULUS);
+
+    for(uint64_t round = 0; round < 4; round++){
+        vector<vector<double> > values(n_users);
+        for (int i = 0; i < n_users; i++){
+            values[i] = random_deviations(n_slots, codec.max_abs_value());
+            // slots 0 and 1 reach the largest positive and negative totals
+            values[i][0] = codec.max_abs_value();
+            values[i][1] = -codec.max_abs_value();
+        }
+
+        aggregator.reset();
+        vector<uint32_t> shares(n_slots);
+        for (int i = 0; i < n_users; i++){
+            generate_masked_vector(i, round, values[i].data(), n_slots, codec, keys, shares.data());
+            aggregator.add_shares(shares.data());
+        }
+        vector<double> totals = codec.decode(aggregator);
+        for (int t = 0; t < n_slots; t++){
+            int64_t expected = 0;
+            for (int i = 0; i < n_users; i++)
+                expected += llround(values[i][t] * FIXED_POINT_SCALE);
+            assert(expected == llround(totals[t] * FIXED_POINT_SCALE));
+        }
+    }
+
+    // values out of range are rejected, whatever their position
+    vector<double> values(n_slots, 0.0);
+    vector<uint32_t> shares(n_slots);
+    for (int t : {0, n_slots - 1}){
+        values[t] = codec.max_abs_value() + 1 / FIXED_POINT_SCALE;
+        bool thrown = false;
+        try { codec.encode(values.data(), n_slots, shares.data()); }
+        catch (const std::overflow_error&) { thrown = true; }
+        assert(thrown);
+        values[t] = 0.0;
+    }
+
+    // so are aggregates of more users than the codec was sized for
+    aggregator.n_shares = n_users + 1;
+    bool thrown = false;
+    try { codec.decode(aggregator); }
+    catch (const std::overflow_error&) { thrown = true; }
+    assert(thrown);
+    delete_csprngs(keys);
+}
+
+/**
+ *  Checks the RNS mode: the shares of every residue sum to zero, the first
+ *  residue matches the single-modulus shares, and masked totals far beyond
+ *  MODULUS are decoded exactly.
+ */
+void test_rns(const CommunicationGraph& graph, int n_slots){
+	SharingKeys keys = setup(graph);
+	int n_users = graph.n_users;
+
+    for (int k = 1; k <= RNS_MAX_PRIMES; k++){
+        RNSBasis basis(k);
+        RNSAggregator aggregator(n_slots, basis);
+        vector<uint32_t> shares((size_t) k * n_slots), reference(n_slots);
+        for (int i = 0; i < n_users; i++){
+            generate_share_vector_rns(i, 5, n_slots, basis, keys, shares.data());
+            generate_share_vector(i, 5, 0, n_slots, MODULUS, keys, reference.data());
+            assert(equal(reference.begin(), reference.end(), shares.begin()));
+            aggregator.add_shares(shares.data());
+        }
+        for (int128_t s : aggregator.result())
+            assert(0 == s);
+
+        // CRT of random values in the range of the basis
+        for (int r = 0; r < 1000; r++){
+            int128_t x = ((int128_t) rand() << 62) ^ ((int128_t) rand() << 31) ^ rand();
+            x %= (int128_t) (basis.product / 2);
+            if (rand() % 2)
+                x = -x;
+            uint32_t residues[RNS_MAX_PRIMES];
+            for (int j = 0; j < k; j++)
+                residues[j] = (uint32_t) (((x % basis.primes[j]) + basis.primes[j]) % basis.primes[j]);
+            assert(x == crt_centered(residues, basis));
+        }
+    }
 
+    // totals of up to 100 * 10^12 fixed-point units, which need more than 30 bits
+    RNSBasis basis(RNS_MAX_PRIMES);
+    RNSAggregator aggregator(n_slots, basis);
+    vector<int128_t> expected(n_slots, 0);
+    vector<uint32_t> shares((size_t) RNS_MAX_PRIMES * n_slots);
+    for (int i = 0; i < n_users; i++){
+        vector<double> values = random_deviations(n_slots, 1e8);
+        values[0] = 1e8;
+        for (int t = 0; t < n_slots; t++)
+            expected[t] += llround(values[t] * FIXED_POINT_SCALE);
+        generate_masked_vector_rns(i, 9, values.data(), n_slots, FIXED_POINT_SCALE, n_users, basis, keys, shares.data());
+        aggregator.add_shares(shares.data());
+    }
+    assert(expected == aggregator.result());
+    delete_csprngs(keys);
 }
 
 /**
- * Test how long it takes to generate CSPRNG keys.
+ * Test how long it takes to set up the pairwise CSPRNG keys of thousands of
+ * users on the sparse graph of degree log n, with seeds handed out by a
+ * central party (setup) and with seeds agreed by the users via X25519
+ * (setup_key_agreement: key generation, one batched agreement per user and
+ * the key derivation, parallelised over the users).
+ * The setup does not depend on the number of time slots, since the keystream of
+ * each round is derived on demand (see sharing_benchmark for per-round costs).
  */ 
 void prngkeygen_experiment()
 {
-    for (int nr_users = 50; nr_users <= 500; nr_users += 50)
+    for (int nr_users = 1000; nr_users <= 16000; nr_users *= 2)
     {
-        for (int nr_timeslots = 100; nr_timeslots <= 1000; nr_timeslots *= 10)
+        CommunicationGraph graph = harary_graph(nr_users, log_degree(nr_users));
+
+        // Time the setup functions
+        auto central_begin = std::chrono::high_resolution_clock::now();
+        SharingKeys keys = setup(graph);
+        auto central_end = std::chrono::high_resolution_clock::now();
+        delete_csprngs(keys);
+
+        auto agreement_begin = std::chrono::high_resolution_clock::now();
+        keys = setup_key_agreement(graph);
+        auto agreement_end = std::chrono::high_resolution_clock::now();
+        delete_csprngs(keys);
+
+        auto central_duration = std::chrono::duration_cast<std::chrono::microseconds>(central_end - central_begin).count();
+        auto agreement_duration = std::chrono::duration_cast<std::chrono::microseconds>(agreement_end - agreement_begin).count();
+
+        // Display results
+        std::cout << "nr_users: " << nr_users << ", "
+                  << "degree: " << graph.max_degree()
+                  << " -> central: " << central_duration
+                  << ", key agreement: " << agreement_duration
+                  << ", key agreement per user: " << (double) agreement_duration / nr_users
+                  << std::endl;
+    }
+}
+
+
+/**
+ * Compare setup time and per-round share generation of the complete graph
+ * against the sparse topologies of degree O(log n).
+ *
+ * The complete graph is only run while its n(n-1)/2 pairwise CSPRNGs fit in memory.
+ */
+void topology_experiment()
+{
+    const int max_complete_users = 2000;
+    const int nr_rounds = 3;
+    const GraphTopology topologies[] = {COMPLETE, HARARY, EXPANDER};
+
+    for (int nr_users = 100; nr_users <= 100000; nr_users *= 10)
+    {
+        int k = log_degree(nr_users);
+        for (GraphTopology topology : topologies)
         {
+            if (COMPLETE == topology && nr_users > max_complete_users)
+                continue;
+
+            CommunicationGraph graph = generate_graph(topology, nr_users, k, nr_users);
+            assert(is_connected(graph));
+
             // Time the setup function
             auto setup_begin = std::chrono::high_resolution_clock::now();
-            setup(nr_users, nr_timeslots, MODULUS);
+            SharingKeys keys = setup(graph);
             auto setup_end = std::chrono::high_resolution_clock::now();
             auto setup_duration = std::chrono::duration_cast<std::chrono::microseconds>(setup_end - setup_begin).count();
 
+            // Time the share generation of all users
+            uint64_t round = 0;
+            auto round_begin = std::chrono::high_resolution_clock::now();
+            for (int r = 0; r < nr_rounds; r++)
+            {
+                vector<int> shares = generate_shares(round, MODULUS, keys);
+                assert(0 == sum_mod(shares, MODULUS));
+            }
+            auto round_end = std::chrono::high_resolution_clock::now();
+            auto round_duration = std::chrono::duration_cast<std::chrono::microseconds>(round_end - round_begin).count() / nr_rounds;
+
             // Display results
-            std::cout << "nr_users: " << nr_users << ", "
-                      << "nr_time_slots: " << nr_timeslots 
-                      << " -> " << setup_duration 
+            std::cout << "topology: " << topology_name(topology) << ", "
+                      << "nr_users: " << nr_users << ", "
+                      << "max_degree: " << graph.max_degree() << ", "
+                      << "nr_edges: " << graph.n_edges()
+                      << " -> setup: " << setup_duration
+                      << ", per round: " << round_duration
                       << std::endl;
+
+            delete_csprngs(keys);
+        }
+    }
+}
+
+/**
+ * Time the server-side aggregation of a n_users x n_slots share matrix,
+ * both with the vectorised aggregator (whole matrix and one user at a time)
+ * and with the scalar sum_mod applied to each time slot.
+ */
+void aggregation_experiment()
+{
+    const int nr_slots = 96;
+    const int nr_repetitions = 10;
+
+    for (int nr_users = 10000; nr_users <= 80000; nr_users *= 2)
+    {
+        // random shares; only the aggregation is timed here
+        vector<uint32_t> shares((size_t) nr_users * nr_slots);
+        for (size_t i = 0; i < shares.size(); i++)
+            shares[i] = rand() % MODULUS;
+
+        ShareAggregator aggregator(nr_slots, MODULUS);
+        auto matrix_begin = std::chrono::high_resolution_clock::now();
+        for (int r = 0; r < nr_repetitions; r++)
+        {
+            aggregator.reset();
+            aggregator.add_share_matrix(shares.data(), nr_users);
         }
+        vector<uint32_t> result = aggregator.result();
+        auto matrix_end = std::chrono::high_resolution_clock::now();
+
+        auto stream_begin = std::chrono::high_resolution_clock::now();
+        for (int r = 0; r < nr_repetitions; r++)
+        {
+            aggregator.reset();
+            for (int i = 0; i < nr_users; i++)
+                aggregator.add_shares(shares.data() + (size_t) i * nr_slots);
+        }
+        assert(result == aggregator.result());
+        auto stream_end = std::chrono::high_resolution_clock::now();
+
+        auto scalar_begin = std::chrono::high_resolution_clock::now();
+        vector<int> column(nr_users);
+        for (int r = 0; r < nr_repetitions; r++)
+        {
+            for (int t = 0; t < nr_slots; t++)
+            {
+                for (int i = 0; i < nr_users; i++)
+                    column[i] = shares[(size_t) i * nr_slots + t];
+                int s = sum_mod(column, MODULUS);
+                assert(result[t] == (uint32_t) s);
+            }
+        }
+        auto scalar_end = std::chrono::high_resolution_clock::now();
+
+        auto matrix_duration = std::chrono::duration_cast<std::chrono::microseconds>(matrix_end - matrix_begin).count() / nr_repetitions;
+        auto stream_duration = std::chrono::duration_cast<std::chrono::microseconds>(stream_end - stream_begin).count() / nr_repetitions;
+        auto scalar_duration = std::chrono::duration_cast<std::chrono::microseconds>(scalar_end - scalar_begin).count() / nr_repetitions;
+
+        // Display results
+        std::cout << "nr_users: " << nr_users << ", "
+                  << "nr_time_slots: " << nr_slots
+                  << " -> matrix: " << matrix_duration
+                  << ", streaming: " << stream_duration
+                  << ", scalar sum_mod: " << scalar_duration
+                  << std::endl;
     }
 }
 
+/**
+ * Time the private computation of the total deviation: every user encodes and
+ * masks its deviations, and the server aggregates and decodes the totals.
+ * Also reports the largest individual deviation the codec accepts for each
+ * number of users.
+ */
+void deviation_experiment()
+{
+    const int nr_slots = 96;
+
+    for (int nr_users = 1000; nr_users <= 8000; nr_users *= 2)
+    {
+        SharingKeys keys = setup(harary_graph(nr_users, log_degree(nr_users)));
+        FixedPointCodec codec(MODULUS, nr_users);
+
+        vector<double> deviations((size_t) nr_users * nr_slots);
+        for (int i = 0; i < nr_users; i++)
+        {
+            vector<double> d = random_deviations(nr_slots, min(codec.max_abs_value(), 10.0));
+            copy(d.begin(), d.end(), deviations.begin() + (size_t) i * nr_slots);
+        }
+
+        // users
+        vector<uint32_t> shares((size_t) nr_users * nr_slots);
+        auto masking_begin = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < nr_users; i++)
+            generate_masked_vector(i, 0, deviations.data() + (size_t) i * nr_slots, nr_slots, codec, keys,
+                                   shares.data() + (size_t) i * nr_slots);
+        auto masking_end = std::chrono::high_resolution_clock::now();
+
+        // encoding alone, without the masks
+        auto encoding_begin = std::chrono::high_resolution_clock::now();
+        codec.encode(deviations.data(), nr_users * nr_slots, shares.data());
+        auto encoding_end = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < nr_users; i++)
+            generate_masked_vector(i, 0, deviations.data() + (size_t) i * nr_slots, nr_slots, codec, keys,
+                                   shares.data() + (size_t) i * nr_slots);
+
+        // server
+        auto aggregation_begin = std::chrono::high_resolution_clock::now();
+        ShareAggregator aggregator(nr_slots, MODULUS);
+        aggregator.add_share_matrix(shares.data(), nr_users);
+        vector<double> total_deviation = codec.decode(aggregator);
+        auto aggregation_end = std::chrono::high_resolution_clock::now();
 
-int main() {
+        for (int t = 0; t < nr_slots; t++)
+        {
+            double expected = 0;
+            for (int i = 0; i < nr_users; i++)
+                expected += deviations[(size_t) i * nr_slots + t];
+            assert(fabs(expected - total_deviation[t]) < 1e-6 * nr_users);
+        }
+
+        auto masking_duration = std::chrono::duration_cast<std::chrono::microseconds>(masking_end - masking_begin).count();
+        auto encoding_duration = std::chrono::duration_cast<std::chrono::microseconds>(encoding_end - encoding_begin).count();
+        auto aggregation_duration = std::chrono::duration_cast<std::chrono::microseconds>(aggregation_end - aggregation_begin).count();
+
+        // Display results
+        std::cout << "nr_users: " << nr_users << ", "
+                  << "nr_time_slots: " << nr_slots << ", "
+                  << "max_deviation: " << codec.max_abs_value()
+                  << " -> masking per user: " << (double) masking_duration / nr_users
+                  << ", encoding per user: " << (double) encoding_duration / nr_users
+                  << ", aggregation and decoding: " << aggregation_duration
+                  << std::endl;
+        delete_csprngs(keys);
+    }
+}
+
+/**
+ * Time share generation and aggregation in RNS mode with 1, 2 and 3 primes,
+ * i.e., for totals of ~30, ~60 and ~90 bits.
+ */
+void rns_experiment()
+{
+    const int nr_users = 2000;
+    const int nr_slots = 96;
+    SharingKeys keys = setup(harary_graph(nr_users, log_degree(nr_users)));
+
+    for (int k = 1; k <= RNS_MAX_PRIMES; k++)
+    {
+        RNSBasis basis(k);
+        vector<uint32_t> shares((size_t) nr_users * k * nr_slots);
+
+        auto generation_begin = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < nr_users; i++)
+            generate_share_vector_rns(i, 0, nr_slots, basis, keys, shares.data() + (size_t) i * k * nr_slots);
+        auto generation_end = std::chrono::high_resolution_clock::now();
+
+        RNSAggregator aggregator(nr_slots, basis);
+        aggregator.add_share_matrix(shares.data(), nr_users);
+        vector<int128_t> totals = aggregator.result();
+        auto aggregation_end = std::chrono::high_resolution_clock::now();
+        for (int128_t s : totals)
+            assert(0 == s);
+
+        auto generation_duration = std::chrono::duration_cast<std::chrono::microseconds>(generation_end - generation_begin).count();
+        auto aggregation_duration = std::chrono::duration_cast<std::chrono::microseconds>(aggregation_end - generation_end).count();
+
+        // Display results
+        std::cout << "nr_users: " << nr_users << ", "
+                  << "nr_time_slots: " << nr_slots << ", "
+                  << "nr_primes: " << k << ", "
+                  << "range_bits: " << basis.range_bits()
+                  << " -> generation: " << generation_duration
+                  << ", aggregation and CRT: " << aggregation_duration
+                  << std::endl;
+    }
+    delete_csprngs(keys);
+}
+
+/**
+ * Time the recovery of a round in which a fraction of the users drops out,
+ * comparing the correction batched per dropped user with one correction per
+ * (survivor, dropped user) pair.
+ */
+void dropout_experiment()
+{
+    const int nr_slots = 96;
+    const double dropout_rates[] = {0.01, 0.05, 0.20};
+    const GraphTopology topologies[] = {COMPLETE, HARARY};
+
+    for (int nr_users = 1000; nr_users <= 10000; nr_users *= 10)
+    {
+        for (GraphTopology topology : topologies)
+        {
+            // the complete graph with 10k users needs ~5 * 10^7 pairwise CSPRNGs
+            if (COMPLETE == topology && nr_users > 1000)
+                continue;
+
+            CommunicationGraph graph = generate_graph(topology, nr_users, log_degree(nr_users), nr_users);
+            SharingKeys keys = setup(graph);
+            uint64_t round = 0;
+            for (double rate : dropout_rates)
+            {
+                vector<uint32_t> shares = generate_share_matrix(round, nr_slots, MODULUS, keys);
+                vector<bool> dropped(nr_users, false);
+                int nr_dropped = 0;
+                for (int i = 0; i < nr_users; i++)
+                {
+                    dropped[i] = rand() < rate * RAND_MAX;
+                    nr_dropped += dropped[i];
+                }
+
+                ShareAggregator aggregator(nr_slots, MODULUS);
+                for (int i = 0; i < nr_users; i++)
+                {
+                    if (!dropped[i])
+                        aggregator.add_shares(shares.data() + (size_t) i * nr_slots);
+                }
+                ShareAggregator survivors = aggregator;
+
+                auto batched_begin = std::chrono::high_resolution_clock::now();
+                recover_dropouts(aggregator, round, keys, dropped);
+                auto batched_end = std::chrono::high_resolution_clock::now();
+                for (uint32_t s : aggregator.result())
+                    assert(0 == s);
+
+                // one correction per pair, added to the aggregator as soon as it arrives
+                auto pairwise_begin = std::chrono::high_resolution_clock::now();
+                vector<uint32_t> r(nr_slots);
+                for (int d = 0; d < nr_users; d++)
+                {
+                    if (!dropped[d])
+                        continue;
+                    const vector<int>& adj = graph.neighbours[d];
+                    for (unsigned int t = 0; t < adj.size(); t++)
+                    {
+                        if (dropped[adj[t]])
+                            continue;
+                        keys.csprngs[d][t]->round_random_ints(round, 0, nr_slots, MODULUS, r.data());
+                        if (adj[t] < d)
+                        {
+                            for (int s = 0; s < nr_slots; s++)
+                                r[s] = (0 == r[s]) ? 0 : MODULUS - r[s];
+                        }
+                        survivors.add_shares(r.data());
+                    }
+                }
+                auto pairwise_end = std::chrono::high_resolution_clock::now();
+                assert(aggregator.result() == survivors.result());
+
+                auto batched_duration = std::chrono::duration_cast<std::chrono::microseconds>(batched_end - batched_begin).count();
+                auto pairwise_duration = std::chrono::duration_cast<std::chrono::microseconds>(pairwise_end - pairwise_begin).count();
+
+                // Display results
+                std::cout << "topology: " << topology_name(topology) << ", "
+                          << "nr_users: " << nr_users << ", "
+                          << "dropout: " << rate << ", "
+                          << "nr_dropped: " << nr_dropped
+                          << " -> batched: " << batched_duration
+                          << ", per pair: " << pairwise_duration
+                          << std::endl;
+                round++;
+            }
+            delete_csprngs(keys);
+        }
+    }
+}
+
+
+int main(int argc, char* argv[]) {
     srand(time(NULL)); // XXX not secure. Enough for timing experiments.
 
-    prngkeygen_experiment();
+    if (argc > 1 && 0 == strcmp(argv[1], "topology"))
+        topology_experiment();
+    else if (argc > 1 && 0 == strcmp(argv[1], "aggregation"))
+        aggregation_experiment();
+    else if (argc > 1 && 0 == strcmp(argv[1], "dropout"))
+        dropout_experiment();
+    else if (argc > 1 && 0 == strcmp(argv[1], "deviation"))
+        deviation_experiment();
+    else if (argc > 1 && 0 == strcmp(argv[1], "rns"))
+        rns_experiment();
+    else if (argc > 1 && 0 == strcmp(argv[1], "test"))
+    {
+        test_shares(harary_graph(50, log_degree(50)));
+        test_aggregation(random_expander_graph(200, log_degree(200), 1), 96);
+        test_random_access(harary_graph(30, 5), 96);
+        test_dropout(complete_graph(40), 24, 0.2);
+        test_dropout(harary_graph(500, log_degree(500)), 96, 0.05);
+        test_fixed_point(harary_graph(100, log_degree(100)), 99);
+        test_fixed_point(complete_graph(3), 7);
+        test_rns(harary_graph(100, log_degree(100)), 37);
+        test_x25519();
+        test_key_agreement(harary_graph(200, log_degree(200)), 24);
+        test_key_agreement(complete_graph(30), 24);
+    }
+    else
+        prngkeygen_experiment();
 
-	return 0;
+    return 0;
 }
@@ -0,0 +1,234 @@
+/**
+ *  Streaming billing of a round: the readings of every time slot are encrypted
+ *  by the clients and billed by the server as soon as the time slot ends. The
+ *  clients are packed in groups (streaming_group_size): a client uploads one
+ *  ciphertext per time slot, and the server bills every group once per time
+ *  slot and folds the result into a running bill per group (fold_timeslot). At
+ *  the end of the round only the running bills are finalised, instead of
+ *  encrypting and billing the whole round at once as setup_and_billing does, e.g.
+ *      ./streaming_billing --threads 4 --scheme ckks
+ *
+ *  Reports the client and server work per time slot, the work of the whole
+ *  round and the latency at the end of the round, of the streaming and of the
+ *  batch billing. The totals of a time slot are taken from context.csv, as if
+ *  they were aggregated when the time slot ends.
+ */
+
+#include "billing.h"
+
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+#include <numeric>
+#include <tuple>
+
+
+struct StreamingSettings
+{
+    int threads = 1;
+    BillingScheme scheme = BILLING_CKKS;
+};
+
+struct ClientData
+{
+    std::vector<double> consumptions;
+    std::vector<double> supplies;
+    std::vector<double> retailPrice;
+    std::vector<double> accepted;
+    std::vector<double> deviations;
+    std::vector<double> expectedBill;
+    std::vector<double> expectedReward;
+};
+
+
+StreamingSettings parse_arguments(int argc, char* argv[])
+{
+    StreamingSettings settings;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string option = argv[i];
+        std::string value = argv[i + 1];
+        if (option == "--threads")
+            settings.threads = stoi(value);
+        else if (option == "--scheme")
+            settings.scheme = parse_billing_scheme(value);
+        else
+            throw std::invalid_argument("unknown option " + option);
+    }
+    return settings;
+}
+
+// largest |x[i] - y[i]|
+double max_abs_difference(const std::vector<double>& x, const std::vector<double>& y)
+{
+    double diff = 0.0;
+    for (unsigned int i = 0; i < x.size(); i++)
+        diff = std::max(diff, std::fabs(x[i] - y[i]));
+    return diff;
+}
+
+
+void streaming_experiment(const StreamingSettings& settings)
+{
+    BillingScheme scheme = settings.scheme;
+    CryptoContext<DCRTPoly> cc = billing_crypto_context(scheme);
+    auto keys = cc->KeyGen();
+    cc->EvalMultKeyGen(keys.secretKey);
+    const PublicKey<DCRTPoly> &pk = keys.publicKey;
+
+    auto [
+        feedInTarif,
+        tradingPrice,
+        totalProsumers,
+        totalConsumers,
+        totalDeviation
+    ] = context_setup();
+
+    std::vector<ClientData> clients(NR_CLIENTS);
+    std::vector<std::vector<double>> retailPrices(NR_CLIENTS);
+    for (int userID = 0; userID < NR_CLIENTS; userID++)
+    {
+        auto [
+            consumptions,
+            supplies,
+            consumption_promise,
+            supply_promise,
+            retailPrice,
+            accepted,
+            deviations,
+            expectedBill,
+            expectedReward
+        ] = load_client_data(userID);
+        clients[userID] = {consumptions, supplies, retailPrice, accepted, deviations, expectedBill, expectedReward};
+        retailPrices[userID] = retailPrice;
+    }
+
+    // Streaming: time slot t is encrypted and billed when it ends
+    int group_size = streaming_group_size(cc, scheme);
+    int n_groups = (NR_CLIENTS + group_size - 1) / group_size;
+    cc->EvalRotateKeyGen(keys.secretKey, streaming_rotation_indices(group_size));
+    auto members = [&](int g) { return std::min(group_size, NR_CLIENTS - g * group_size); };
+
+    std::vector<RunningBill> running(n_groups);
+    std::vector<int64_t> client_us(TIMESLOTS), server_us(TIMESLOTS);
+    for (int t = 0; t < TIMESLOTS; t++)
+    {
+        std::vector<Ciphertext<DCRTPoly>> uploads(NR_CLIENTS);
+        auto client_begin = std::chrono::high_resolution_clock::now();
+        #pragma omp parallel for num_threads(settings.threads) schedule(dynamic)
+        for (int userID = 0; userID < NR_CLIENTS; userID++)
+        {
+            const ClientData& client = clients[userID];
+            uploads[userID] = client_setup_timeslot(cc, pk, userID % group_size, group_size, client.consumptions[t], client.supplies[t],
+                                                    client.deviations[t], client.accepted[t], scheme);
+        }
+        auto client_end = std::chrono::high_resolution_clock::now();
+
+        RoundPlaintexts round = encode_timeslot_plaintexts(cc, pk, group_size, tradingPrice[t], feedInTarif[t], totalProsumers[t],
+                                                           totalDeviation[t], scheme);
+        #pragma omp parallel for num_threads(settings.threads) schedule(dynamic)
+        for (int g = 0; g < n_groups; g++)
+        {
+            std::vector<double> retailPrices;
+            for (int p = 0; p < members(g); p++)
+                retailPrices.push_back(clients[g * group_size + p].retailPrice[t]);
+            TariffPlaintexts tariff = encode_timeslot_tariff_plaintexts(cc, pk, tradingPrice[t], retailPrices, totalConsumers[t],
+                                                                        totalDeviation[t], scheme);
+            std::vector<Ciphertext<DCRTPoly>> group_uploads(uploads.begin() + g * group_size,
+                                                            uploads.begin() + g * group_size + members(g));
+            fold_timeslot(cc, running[g], group_size, round, tariff, group_uploads);
+        }
+        auto server_end = std::chrono::high_resolution_clock::now();
+
+        client_us[t] = std::chrono::duration_cast<std::chrono::microseconds>(client_end - client_begin).count();
+        server_us[t] = std::chrono::duration_cast<std::chrono::microseconds>(server_end - client_end).count();
+    }
+
+    // End of the round: finalise the running bills
+    std::vector<Ciphertext<DCRTPoly>> bills(n_groups), rewards(n_groups);
+    auto finalise_begin = std::chrono::high_resolution_clock::now();
+    for (int g = 0; g < n_groups; g++)
+        std::tie(bills[g], rewards[g]) = finalise_bill(running[g]);
+    auto finalise_end = std::chrono::high_resolution_clock::now();
+
+    // Batch: the whole round is encrypted and billed at its end
+    std::vector<TariffGroup> groups = group_by_tariff(retailPrices);
+    std::vector<int> group_of_client(NR_CLIENTS);
+    for (unsigned int g = 0; g < groups.size(); g++)
+        for (int userID : groups[g].clients)
+            group_of_client[userID] = g;
+    auto [maskTotalDevPositive, maskTotalDevZero, maskTotalDevNegative] = server_setup(totalDeviation);
+    std::vector<std::tuple<Ciphertext<DCRTPoly>, Ciphertext<DCRTPoly>, Ciphertext<DCRTPoly>,
+                           Ciphertext<DCRTPoly>, Ciphertext<DCRTPoly>>> batch_uploads(NR_CLIENTS);
+    std::vector<Ciphertext<DCRTPoly>> batch_bills(NR_CLIENTS);
+    auto batch_begin = std::chrono::high_resolution_clock::now();
+    #pragma omp parallel for num_threads(settings.threads) schedule(dynamic)
+    for (int userID = 0; userID < NR_CLIENTS; userID++)
+    {
+        const ClientData& client = clients[userID];
+        batch_uploads[userID] = client_setup(cc, pk, client.consumptions, client.supplies, client.deviations, client.accepted, scheme);
+    }
+    auto batch_client_end = std::chrono::high_resolution_clock::now();
+    RoundPlaintexts round = encode_round_plaintexts(cc, pk, tradingPrice, feedInTarif, totalProsumers, totalDeviation,
+                                                    maskTotalDevPositive, maskTotalDevNegative, scheme);
+    std::vector<TariffPlaintexts> tariffs(groups.size());
+    for (unsigned int g = 0; g < groups.size(); g++)
+        tariffs[g] = encode_tariff_plaintexts(cc, pk, tradingPrice, groups[g].retailPrice, totalConsumers, totalDeviation, scheme);
+    #pragma omp parallel for num_threads(settings.threads) schedule(dynamic)
+    for (int userID = 0; userID < NR_CLIENTS; userID++)
+    {
+        auto [ct_consumption, ct_supplies, ct_deviations, ct_signs, ct_accepted] = batch_uploads[userID];
+        batch_bills[userID] = std::get<0>(server_billing(cc, round, tariffs[group_of_client[userID]],
+                                                         ct_consumption, ct_supplies, ct_deviations, ct_signs, ct_accepted));
+    }
+    auto batch_end = std::chrono::high_resolution_clock::now();
+
+    // Check the results against the expected ones and the batch bills
+    double max_bill_error = 0.0, max_reward_error = 0.0, max_batch_difference = 0.0;
+    for (int g = 0; g < n_groups; g++)
+    {
+        std::vector<std::vector<double>> group_bills = decrypt_group_billing(cc, keys.secretKey, bills[g], group_size, members(g), scheme);
+        std::vector<std::vector<double>> group_rewards = decrypt_group_billing(cc, keys.secretKey, rewards[g], group_size, members(g), scheme);
+        for (int p = 0; p < members(g); p++)
+        {
+            int userID = g * group_size + p;
+            max_bill_error = std::max(max_bill_error, max_abs_difference(group_bills[p], clients[userID].expectedBill));
+            max_reward_error = std::max(max_reward_error, max_abs_difference(group_rewards[p], clients[userID].expectedReward));
+            max_batch_difference = std::max(max_batch_difference,
+                                            max_abs_difference(group_bills[p], decrypt_billing(cc, keys.secretKey, batch_bills[userID], scheme)));
+        }
+    }
+    assert(max_bill_error < 1e-2 && max_reward_error < 1e-2);
+    assert(max_batch_difference < 1e-3);
+
+    // Display results
+    auto us = [](auto begin, auto end) { return std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count(); };
+    auto mean = [](const std::vector<int64_t>& v) { return std::accumulate(v.begin(), v.end(), 0.0) / v.size(); };
+    auto sum = [](const std::vector<int64_t>& v) { return std::accumulate(v.begin(), v.end(), (int64_t) 0); };
+    std::cout << "scheme: " << billing_scheme_name(scheme) << ", "
+              << "nr_clients: " << NR_CLIENTS << ", "
+              << "threads: " << settings.threads << ", "
+              << "groups: " << n_groups << " of " << group_size
+              << " -> per time slot: client " << mean(client_us) << " us"
+              << ", server " << mean(server_us) << " us"
+              << " (min " << *std::min_element(server_us.begin(), server_us.end())
+              << ", max " << *std::max_element(server_us.begin(), server_us.end()) << ")"
+              << "; round: streaming client " << sum(client_us) << " us, server " << sum(server_us) << " us"
+              << ", batch client " << us(batch_begin, batch_client_end) << " us, server " << us(batch_client_end, batch_end) << " us"
+              << "; end of round: streaming " << us(finalise_begin, finalise_end) << " us"
+              << ", batch " << us(batch_begin, batch_end) << " us"
+              << "; max |bill - expectedBill|: " << max_bill_error
+              << ", max |reward - expectedReward|: " << max_reward_error
+              << ", max |bill - batch bill|: " << max_batch_difference
+              << std::endl;
+}
+
+
+int main(int argc, char* argv[])
+{
+    streaming_experiment(parse_arguments(argc, argv));
+    return 0;
+}
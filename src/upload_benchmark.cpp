@@ -0,0 +1,148 @@
+/**
+ *  Compares the encryptions a client can use for its uploads:
+ *  - public key: pack_and_encrypt, as in client_setup,
+ *  - secret key: the secret-key encryption of OpenFHE,
+ *  - seeded secret key: pack_and_encrypt_seeded, as in client_setup_seeded,
+ *  for encryption time, upload size and precision after decryption. The server
+ *  time to expand a seeded upload is reported too, and the bills computed by
+ *  server_billing from public-key and seeded uploads are compared.
+ */
+
+#include "billing.h"
+#include "seeded_ckks.h"
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <cmath>
+#include <cassert>
+
+
+static const int N_REPETITIONS = 20;
+
+
+std::vector<double> random_vector(std::mt19937_64& rng, int n, double min_value, double max_value)
+{
+    std::uniform_real_distribution<double> dist(min_value, max_value);
+    std::vector<double> v(n);
+    for (double& x : v)
+        x = dist(rng);
+    return v;
+}
+
+// largest |msg[i] - decryption of ctxt[i]|
+double max_error(CryptoContext<DCRTPoly>& cc, const PrivateKey<DCRTPoly>& sk, const Ciphertext<DCRTPoly>& ctxt, const std::vector<double>& msg)
+{
+    Plaintext ptxt;
+    cc->Decrypt(sk, ctxt, &ptxt);
+    ptxt->SetLength(msg.size());
+    std::vector<double> values = ptxt->GetRealPackedValue();
+    double err = 0.0;
+    for (unsigned int i = 0; i < msg.size(); i++)
+        err = std::max(err, std::fabs(values[i] - msg[i]));
+    return err;
+}
+
+void report(const std::string& mode, double encrypt_us, size_t bytes, double err)
+{
+    std::cout << "mode: " << mode
+              << " -> encrypt: " << encrypt_us << " us"
+              << ", upload: " << bytes / 1024.0 << " KiB"
+              << ", max error: " << err
+              << " (" << -std::log2(err) << " bits)"
+              << std::endl;
+}
+
+
+void upload_experiment()
+{
+    CCParams<CryptoContextCKKSRNS> parameters = generate_parameters_ckks(N_TIME_SLOTS);
+    CryptoContext<DCRTPoly> cc = generate_crypto_context_ckks(parameters);
+    auto keys = cc->KeyGen();
+    cc->EvalMultKeyGen(keys.secretKey);
+
+    std::mt19937_64 rng(1);
+    std::vector<double> consumptions = random_vector(rng, TIMESLOTS, 0, 5);
+
+    // public key
+    Ciphertext<DCRTPoly> pk_ctxt;
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < N_REPETITIONS; r++)
+        pk_ctxt = pack_and_encrypt(consumptions, cc, keys.publicKey);
+    auto end = std::chrono::high_resolution_clock::now();
+    report("public key", std::chrono::duration<double, std::micro>(end - begin).count() / N_REPETITIONS,
+           ciphertext_bytes(pk_ctxt, cc), max_error(cc, keys.secretKey, pk_ctxt, consumptions));
+
+    // secret key, with a uniformly random a
+    Ciphertext<DCRTPoly> sk_ctxt;
+    begin = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < N_REPETITIONS; r++)
+        sk_ctxt = cc->Encrypt(keys.secretKey, cc->MakeCKKSPackedPlaintext(consumptions));
+    end = std::chrono::high_resolution_clock::now();
+    report("secret key", std::chrono::duration<double, std::micro>(end - begin).count() / N_REPETITIONS,
+           ciphertext_bytes(sk_ctxt, cc), max_error(cc, keys.secretKey, sk_ctxt, consumptions));
+
+    // secret key, with a expanded from a seed
+    SeededCiphertext upload;
+    begin = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < N_REPETITIONS; r++)
+        upload = pack_and_encrypt_seeded(consumptions, cc, keys.secretKey);
+    end = std::chrono::high_resolution_clock::now();
+    Ciphertext<DCRTPoly> seeded_ctxt;
+    auto expand_begin = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < N_REPETITIONS; r++)
+        seeded_ctxt = expand_ciphertext(upload);
+    auto expand_end = std::chrono::high_resolution_clock::now();
+    report("seeded secret key", std::chrono::duration<double, std::micro>(end - begin).count() / N_REPETITIONS,
+           upload_bytes(upload, cc), max_error(cc, keys.secretKey, seeded_ctxt, consumptions));
+    std::cout << "server expansion: "
+              << std::chrono::duration<double, std::micro>(expand_end - expand_begin).count() / N_REPETITIONS << " us"
+              << std::endl;
+
+    // the server bills seeded uploads like public-key ones
+    std::vector<double> supplies = random_vector(rng, TIMESLOTS, 0, 5);
+    std::vector<double> deviations = random_vector(rng, TIMESLOTS, -1, 1);
+    std::vector<double> accepted(TIMESLOTS);
+    for (int t = 0; t < TIMESLOTS; t++)
+        accepted[t] = (t % 3 != 0);
+    std::vector<double> tradingPrice = random_vector(rng, TIMESLOTS, 0.1, 0.2);
+    std::vector<double> retailPrice = random_vector(rng, TIMESLOTS, 0.2, 0.4);
+    std::vector<double> feedInTarif = random_vector(rng, TIMESLOTS, 0.05, 0.1);
+    std::vector<double> totalConsumers = random_vector(rng, TIMESLOTS, 10, 150);
+    std::vector<double> totalProsumers = random_vector(rng, TIMESLOTS, 10, 150);
+    std::vector<double> totalDeviation = random_vector(rng, TIMESLOTS, -50, 50);
+    auto [maskTotalDevPositive, maskTotalDevZero, maskTotalDevNegative] = server_setup(totalDeviation);
+
+    auto [pk_consumption, pk_supplies, pk_deviations, pk_signs, pk_accepted]
+        = client_setup(cc, keys.publicKey, consumptions, supplies, deviations, accepted);
+    auto [sd_consumption, sd_supplies, sd_deviations, sd_signs, sd_accepted]
+        = client_setup_seeded(cc, keys.secretKey, consumptions, supplies, deviations, accepted);
+
+    auto [pk_bill, pk_reward] = server_billing(cc, keys.publicKey, tradingPrice, retailPrice, feedInTarif, totalConsumers, totalProsumers,
+                                               totalDeviation, maskTotalDevPositive, maskTotalDevZero, maskTotalDevNegative,
+                                               pk_consumption, pk_supplies, pk_deviations, pk_signs, pk_accepted);
+    auto [sd_bill, sd_reward] = server_billing(cc, keys.publicKey, tradingPrice, retailPrice, feedInTarif, totalConsumers, totalProsumers,
+                                               totalDeviation, maskTotalDevPositive, maskTotalDevZero, maskTotalDevNegative,
+                                               expand_ciphertext(sd_consumption), expand_ciphertext(sd_supplies),
+                                               expand_ciphertext(sd_deviations), expand_ciphertext(sd_signs),
+                                               expand_ciphertext(sd_accepted));
+
+    Plaintext pk_bill_pt, pk_reward_pt;
+    cc->Decrypt(keys.secretKey, pk_bill, &pk_bill_pt);
+    cc->Decrypt(keys.secretKey, pk_reward, &pk_reward_pt);
+    pk_bill_pt->SetLength(TIMESLOTS);
+    pk_reward_pt->SetLength(TIMESLOTS);
+    double bill_err = max_error(cc, keys.secretKey, sd_bill, pk_bill_pt->GetRealPackedValue());
+    double reward_err = max_error(cc, keys.secretKey, sd_reward, pk_reward_pt->GetRealPackedValue());
+    std::cout << "max |bill(seeded) - bill(public key)|: " << bill_err
+              << ", max |reward(seeded) - reward(public key)|: " << reward_err
+              << std::endl;
+    assert(bill_err < 1e-3 && reward_err < 1e-3);
+}
+
+
+int main()
+{
+    upload_experiment();
+    return 0;
+}
@@ -0,0 +1,83 @@
+#include "utils_bfv.h"
+#include "openfhe.h"
+
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+using namespace lbcrypto;
+using namespace std;
+
+
+uint64_t plaintext_modulus_for(double max_abs){
+	// FirstPrime returns the first prime = 1 mod m above 2^n_bits
+	uint32_t n_bits = (uint32_t) ceil(log2(2 * max_abs + 1));
+	NativeInteger t = FirstPrime<NativeInteger>(n_bits, 2 * BFV_MAX_RING_DIM);
+	return t.ConvertToInt();
+}
+
+CCParams<CryptoContextBFVRNS> generate_parameters_bfv(uint64_t plaintext_modulus, int multiplicative_depth){
+	CCParams<CryptoContextBFVRNS> parameters;
+	parameters.SetPlaintextModulus(plaintext_modulus);
+	parameters.SetMultiplicativeDepth(multiplicative_depth);
+	parameters.SetSecurityLevel(HEStd_128_classic); // 128 bits of security; the ring dimension is the smallest that allows it
+	return parameters;
+}
+
+CryptoContext<DCRTPoly> generate_crypto_context_bfv(CCParams<CryptoContextBFVRNS>& parameters){
+	CryptoContext<DCRTPoly> cc = GenCryptoContext(parameters);
+
+	cc->Enable(PKE);
+	cc->Enable(KEYSWITCH);
+	cc->Enable(LEVELEDSHE);
+
+	return cc;
+}
+
+
+Plaintext pack_integers(
+							const vector<double>& msg,
+							double scale,
+							CryptoContext<DCRTPoly>& cc
+						)
+{
+	int64_t half_t = cc->GetEncodingParams()->GetPlaintextModulus() / 2;
+	vector<int64_t> values(msg.size());
+	for (unsigned int i = 0; i < msg.size(); i++)
+	{
+		double x = nearbyint(msg[i] * scale);
+		if (!(fabs(x) <= half_t))
+			throw std::overflow_error("Value out of the range of the plaintext modulus (|v| <= " + to_string(half_t / scale) + ").");
+		values[i] = (int64_t) x;
+	}
+	return cc->MakePackedPlaintext(values); // pack
+}
+
+Ciphertext<DCRTPoly> pack_and_encrypt_integers(
+										const vector<double>& msg,
+										double scale,
+										CryptoContext<DCRTPoly>& cc,
+										const PublicKey<DCRTPoly>& pk
+									 )
+{
+	Plaintext ptxt_msg = pack_integers(msg, scale, cc); // pack
+	return cc->Encrypt(pk, ptxt_msg); // encrypt
+}
+
+vector<double> decrypt_integers(
+										const Ciphertext<DCRTPoly>& ctxt,
+										double scale,
+										int n_values,
+										CryptoContext<DCRTPoly>& cc,
+										const PrivateKey<DCRTPoly>& sk
+									 )
+{
+	Plaintext ptxt;
+	cc->Decrypt(sk, ctxt, &ptxt);
+	ptxt->SetLength(n_values);
+	const vector<int64_t>& values = ptxt->GetPackedValue();
+	vector<double> res(n_values);
+	for (int i = 0; i < n_values; i++)
+		res[i] = values[i] / scale;
+	return res;
+}
@@ -0,0 +1,58 @@
+#ifndef __UTILS_BFV
+#define __UTILS_BFV
+
+#include "openfhe.h"
+
+#include<vector>
+
+
+using namespace lbcrypto;
+
+/**
+ * Exact-integer billing with BFV. Real values v are encoded as the integers
+ * round(v * scale) in (-t/2, t/2], where t is the plaintext modulus, so that
+ * sums and products are computed exactly as long as they stay in this range.
+ */
+
+// largest ring dimension the plaintext modulus supports batching for
+static const uint32_t BFV_MAX_RING_DIM = 1 << 16;
+
+/**
+ * Smallest prime t = 1 mod 2 * BFV_MAX_RING_DIM (so that the slots can be
+ * batched) with t > 2 * max_abs, i.e., that represents all the integers of
+ * absolute value at most max_abs.
+ */
+uint64_t plaintext_modulus_for(double max_abs);
+
+CCParams<CryptoContextBFVRNS> generate_parameters_bfv(uint64_t plaintext_modulus, int multiplicative_depth);
+
+CryptoContext<DCRTPoly> generate_crypto_context_bfv(CCParams<CryptoContextBFVRNS>& parameters);
+
+
+/**
+ * Packs round(msg[i] * scale). Throws std::overflow_error if one of them does
+ * not fit in (-t/2, t/2].
+ */
+Plaintext pack_integers(
+							const std::vector<double>& msg,
+							double scale,
+							CryptoContext<DCRTPoly>& cc
+						);
+
+Ciphertext<DCRTPoly> pack_and_encrypt_integers(
+										const std::vector<double>& msg,
+										double scale,
+										CryptoContext<DCRTPoly>& cc,
+										const PublicKey<DCRTPoly>& pk
+									 );
+
+// the first n_values slots of ctxt, divided by scale
+std::vector<double> decrypt_integers(
+										const Ciphertext<DCRTPoly>& ctxt,
+										double scale,
+										int n_values,
+										CryptoContext<DCRTPoly>& cc,
+										const PrivateKey<DCRTPoly>& sk
+									 );
+
+#endif
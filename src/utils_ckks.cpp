@@ -1,6 +1,7 @@
 
 #include "utils_ckks.h"
 #include "openfhe.h"
+#include <cstring>
 
 using namespace lbcrypto;
 using namespace std;
@@ -120,3 +121,180 @@ Ciphertext<DCRTPoly> negate_all_slots(
 	return cc->EvalSub(ptxt_ones, ctxt);
 }
 
+
+
+size_t ciphertext_bytes(const Ciphertext<DCRTPoly>& ctxt, const CryptoContext<DCRTPoly>& cc)
+{
+	size_t bytes = 0;
+	for (const DCRTPoly& poly : ctxt->GetElements())
+		bytes += (size_t) poly.GetNumOfElements() * cc->GetRingDimension() * sizeof(uint64_t);
+	return bytes;
+}
+
+// bytes of the towers of poly
+static size_t poly_bytes(const DCRTPoly& poly)
+{
+	return (size_t) poly.GetNumOfElements() * poly.GetRingDimension() * sizeof(uint64_t);
+}
+
+size_t plaintext_bytes(const Plaintext& ptxt)
+{
+	return poly_bytes(ptxt->GetElement<DCRTPoly>());
+}
+
+size_t fresh_plaintext_bytes(const CryptoContext<DCRTPoly>& cc)
+{
+	return cc->GetElementParams()->GetParams().size() * cc->GetRingDimension() * sizeof(uint64_t);
+}
+
+size_t fresh_ciphertext_bytes(const CryptoContext<DCRTPoly>& cc)
+{
+	return 2 * fresh_plaintext_bytes(cc);
+}
+
+size_t key_bytes(const KeyPair<DCRTPoly>& keys)
+{
+	size_t bytes = poly_bytes(keys.secretKey->GetPrivateElement());
+	for (const DCRTPoly& poly : keys.publicKey->GetPublicElements())
+		bytes += poly_bytes(poly);
+
+	// the relinearization keys are stored by the crypto context, by key tag
+	const auto& eval_mult_keys = CryptoContextImpl<DCRTPoly>::GetAllEvalMultKeys();
+	auto it = eval_mult_keys.find(keys.secretKey->GetKeyTag());
+	if (it != eval_mult_keys.end())
+		for (const EvalKey<DCRTPoly>& key : it->second)
+		{
+			for (const DCRTPoly& poly : key->GetAVector())
+				bytes += poly_bytes(poly);
+			for (const DCRTPoly& poly : key->GetBVector())
+				bytes += poly_bytes(poly);
+		}
+	return bytes;
+}
+
+
+// header of a ciphertext record; 8-byte aligned, like the words after it
+struct CiphertextRecordHeader
+{
+	uint32_t n_elements;
+	uint32_t n_towers;
+	uint32_t ring_dim;
+	uint32_t format;
+	uint32_t encoding;
+	uint32_t noise_scale_deg;
+	uint32_t level;
+	uint32_t slots;
+	double scaling_factor;
+};
+
+void append_ciphertext_record(std::vector<uint8_t>& record, const Ciphertext<DCRTPoly>& ctxt)
+{
+	CiphertextRecordHeader header = {};
+	if (nullptr != ctxt)
+	{
+		const DCRTPoly& first = ctxt->GetElements()[0];
+		header.n_elements = ctxt->GetElements().size();
+		header.n_towers = first.GetNumOfElements();
+		header.ring_dim = first.GetRingDimension();
+		header.format = (uint32_t) first.GetFormat();
+		header.encoding = (uint32_t) ctxt->GetEncodingType();
+		header.noise_scale_deg = ctxt->GetNoiseScaleDeg();
+		header.level = ctxt->GetLevel();
+		header.slots = ctxt->GetSlots();
+		header.scaling_factor = ctxt->GetScalingFactor();
+	}
+	size_t at = record.size();
+	record.resize(at + sizeof(header) + (size_t) header.n_elements * header.n_towers * header.ring_dim * sizeof(uint64_t));
+	memcpy(record.data() + at, &header, sizeof(header));
+	if (nullptr == ctxt)
+		return;
+
+	uint64_t* words = (uint64_t*) (record.data() + at + sizeof(header));
+	for (const DCRTPoly& poly : ctxt->GetElements())
+		for (uint32_t i = 0; i < header.n_towers; i++)
+		{
+			const NativeVector& values = poly.GetElementAtIndex(i).GetValues();
+			for (uint32_t j = 0; j < header.ring_dim; j++)
+				*words++ = values[j].ConvertToInt();
+		}
+}
+
+Ciphertext<DCRTPoly> restore_ciphertext(const CryptoContext<DCRTPoly>& cc, const uint8_t*& data, const std::string& key_tag)
+{
+	CiphertextRecordHeader header;
+	memcpy(&header, data, sizeof(header));
+	const uint64_t* words = (const uint64_t*) (data + sizeof(header));
+	data += sizeof(header) + (size_t) header.n_elements * header.n_towers * header.ring_dim * sizeof(uint64_t);
+	if (0 == header.n_elements)
+		return nullptr;
+
+	// the towers of the level of the ciphertext
+	Format format = (Format) header.format;
+	DCRTPoly zero(cc->GetElementParams(), format, true);
+	if (zero.GetNumOfElements() < header.n_towers || cc->GetRingDimension() != header.ring_dim)
+		throw std::invalid_argument("the ciphertext record does not fit the crypto context");
+	zero.DropLastElements(zero.GetNumOfElements() - header.n_towers);
+	const std::vector<std::shared_ptr<ILNativeParams>>& towers = zero.GetParams()->GetParams();
+
+	std::vector<DCRTPoly> elements(header.n_elements, zero);
+	for (DCRTPoly& poly : elements)
+		for (uint32_t i = 0; i < header.n_towers; i++)
+		{
+			NativeVector values(header.ring_dim, towers[i]->GetModulus());
+			for (uint32_t j = 0; j < header.ring_dim; j++)
+				values[j] = NativeInteger(*words++);
+			DCRTPoly::PolyType tower(towers[i], format);
+			tower.SetValues(std::move(values), format);
+			poly.SetElementAtIndex(i, std::move(tower));
+		}
+
+	Ciphertext<DCRTPoly> ctxt = std::make_shared<CiphertextImpl<DCRTPoly>>(cc);
+	ctxt->SetElements(elements);
+	ctxt->SetEncodingType((PlaintextEncodings) header.encoding);
+	ctxt->SetNoiseScaleDeg(header.noise_scale_deg);
+	ctxt->SetLevel(header.level);
+	ctxt->SetSlots(header.slots);
+	ctxt->SetScalingFactor(header.scaling_factor);
+	ctxt->SetKeyTag(key_tag);
+	return ctxt;
+}
+
+ZeroEncryptionPool::ZeroEncryptionPool(const CryptoContext<DCRTPoly>& cc, const PublicKey<DCRTPoly>& ckks_pk)
+	: cc(cc), ckks_pk(ckks_pk) {}
+
+void ZeroEncryptionPool::refill(size_t n)
+{
+	if (pool.size() >= n)
+		return;
+	unsigned int n_slots = cc->GetEncodingParams()->GetBatchSize();
+	Plaintext ptxt_zero = cc->MakeCKKSPackedPlaintext(vector<double>(n_slots, 0.0));
+	while (pool.size() < n)
+		pool.push_back(cc->Encrypt(ckks_pk, ptxt_zero));
+}
+
+size_t ZeroEncryptionPool::size() const
+{
+	return pool.size();
+}
+
+size_t ZeroEncryptionPool::memory_bytes() const
+{
+	size_t bytes = 0;
+	for (const Ciphertext<DCRTPoly>& ctxt : pool)
+		bytes += ciphertext_bytes(ctxt, cc);
+	return bytes;
+}
+
+Ciphertext<DCRTPoly> ZeroEncryptionPool::encrypt(const vector<double>& msg)
+{
+	if (pool.empty())
+	{
+		n_misses++;
+		return pack_and_encrypt(msg, cc, ckks_pk);
+	}
+	Ciphertext<DCRTPoly> zero = pool.back();
+	pool.pop_back();
+	// encoded at the level and scale of a fresh encryption, like in pack_and_encrypt
+	Plaintext ptxt_msg = cc->MakeCKKSPackedPlaintext(msg);
+	return cc->EvalAdd(zero, ptxt_msg);
+}
@@ -4,6 +4,8 @@
 #include "openfhe.h"
 
 #include<vector>
+#include<string>
+#include<cstdint>
 
 
 using namespace lbcrypto;
@@ -35,6 +37,65 @@ Ciphertext<DCRTPoly> pack_and_mult(
 										CryptoContext<DCRTPoly>& cc
 									 );
 
+// bytes of the towers of the elements of ctxt
+size_t ciphertext_bytes(const Ciphertext<DCRTPoly>& ctxt, const CryptoContext<DCRTPoly>& cc);
+
+// bytes of the towers of the encoding of ptxt
+size_t plaintext_bytes(const Plaintext& ptxt);
+
+// bytes of a fresh ciphertext and of a fresh encoding of cc: two elements, and one, with all
+// the towers; no ciphertext that is not a product, and no plaintext, of cc is larger
+size_t fresh_ciphertext_bytes(const CryptoContext<DCRTPoly>& cc);
+size_t fresh_plaintext_bytes(const CryptoContext<DCRTPoly>& cc);
+
+// bytes of the towers of the public and secret keys, and of the relinearization keys of the secret key
+size_t key_bytes(const KeyPair<DCRTPoly>& keys);
+
+/**
+ * Ciphertext records, e.g. for a result archive: a header with the metadata of
+ * ctxt, then the towers of its elements as 64-bit words. A null ctxt is a record
+ * without elements. restore_ciphertext reads the words in place, e.g. from the
+ * mapping of an ArchiveReader, so the only copy is into the new ciphertext.
+ */
+void append_ciphertext_record(std::vector<uint8_t>& record, const Ciphertext<DCRTPoly>& ctxt);
+
+// data must be 8-byte aligned; it is moved past the record. key_tag: of the key ctxt is encrypted under
+Ciphertext<DCRTPoly> restore_ciphertext(const CryptoContext<DCRTPoly>& cc, const uint8_t*& data, const std::string& key_tag);
+
+
+/**
+ * Offline/online encryption. An encryption of m under the public key is an
+ * encryption of zero plus the encoding of m, so the costly part (sampling and
+ * multiplications by the public key) can be done offline, when the client is
+ * idle, and only the encoding and one addition remain online.
+ *
+ * Every encryption of zero is used once: reusing one for two messages would
+ * reveal their difference.
+ */
+class ZeroEncryptionPool
+{
+	CryptoContext<DCRTPoly> cc;
+	PublicKey<DCRTPoly> ckks_pk;
+	std::vector<Ciphertext<DCRTPoly>> pool;
+
+	public:
+
+		int n_misses = 0; // encryptions made online since the pool was empty
+
+		ZeroEncryptionPool(const CryptoContext<DCRTPoly>& cc, const PublicKey<DCRTPoly>& ckks_pk);
+
+		// offline: adds encryptions of zero until the pool holds n of them
+		void refill(size_t n);
+
+		size_t size() const;
+
+		// bytes of the ciphertexts in the pool
+		size_t memory_bytes() const;
+
+		// online: encrypts msg with an encryption of zero of the pool, or from scratch if the pool is empty
+		Ciphertext<DCRTPoly> encrypt(const std::vector<double>& msg);
+};
+
 Ciphertext<DCRTPoly> negate_all_slots(
 										const Ciphertext<DCRTPoly>& ctxt,
 										CryptoContext<DCRTPoly>& cc
@@ -5,75 +5,230 @@
 #include <vector>
 #include <cmath>
 #include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#if __cplusplus >= 202002L
+#include <span>
+#endif
 
 using namespace std;
 
-template <typename T1, typename T2>
-void operator+=(vector<T1>& u, const vector<T2>& v){
-	if (v.size() != u.size())
-		throw std::invalid_argument("It is impossible to add vectors of different sizes.");
-	unsigned int n = u.size();
-	for (unsigned int i = 0; i < n; i++){
-		u[i] = u[i] + v[i];
-	}
+/**
+ * Entrywise arithmetic on vectors, built on expression templates.
+ *
+ * u + v, u - v, u * v and u / v do not compute anything: they return a small
+ * node that refers to the operands. The whole expression is evaluated in a
+ * single loop, without temporaries, when it is converted to a vector (e.g.,
+ * vector<double> x = ((a - b) / c) * d;) or written into existing storage
+ * with evaluate. The loop is simple enough for the compiler to vectorise it.
+ *
+ * As with the former operators, the entries of u op v have the type of the
+ * entries of u, and operands of different sizes throw std::invalid_argument.
+ *
+ * An expression refers to its vector operands, so it should not outlive
+ * them: do not store it with auto, convert it to a vector instead.
+ */
+namespace vectorutils {
+
+#if __cplusplus >= 202002L
+template <typename T>
+using span = std::span<T>;
+#else
+// the part of std::span (C++20) used by the in-place kernels
+template <typename T>
+class span
+{
+	T* ptr;
+	size_t n;
+
+	public:
+
+		span(T* ptr, size_t n) : ptr(ptr), n(n) {}
+
+		template <typename U, typename A>
+		span(std::vector<U, A>& v) : ptr(v.data()), n(v.size()) {}
+
+		template <typename U, typename A>
+		span(const std::vector<U, A>& v) : ptr(v.data()), n(v.size()) {}
+
+		T* data() const { return ptr; }
+		size_t size() const { return n; }
+		T& operator[](size_t i) const { return ptr[i]; }
+};
+#endif
+
+
+// base of all the expression nodes (CRTP)
+template <typename E>
+struct VecExpr
+{
+	const E& self() const { return static_cast<const E&>(*this); }
+};
+
+// leaf: the entries of a vector or span
+template <typename T>
+class VecView : public VecExpr<VecView<T> >
+{
+	const T* ptr;
+	size_t n;
+
+	public:
+
+		typedef T value_type;
+
+		VecView(const T* ptr, size_t n) : ptr(ptr), n(n) {}
+
+		size_t size() const { return n; }
+		T operator[](size_t i) const { return ptr[i]; }
+};
+
+struct AddOp { template <typename A, typename B> static auto apply(A a, B b) { return a + b; } };
+struct SubOp { template <typename A, typename B> static auto apply(A a, B b) { return a - b; } };
+struct MulOp { template <typename A, typename B> static auto apply(A a, B b) { return a * b; } };
+struct DivOp { template <typename A, typename B> static auto apply(A a, B b) { return a / b; } };
+
+
+// evaluates e[0, ..., n-1] into out, in one pass
+template <typename T, typename E>
+inline void assign_entries(T* out, const E& e, size_t n){
+#pragma GCC ivdep
+	for (size_t i = 0; i < n; i++)
+		out[i] = e[i];
 }
 
-template <typename T1, typename T2>
-void operator-=(vector<T1>& u, const vector<T2>& v){
-	if (v.size() != u.size())
-		throw std::invalid_argument("It is impossible to subtract vectors of different sizes.");
-	unsigned int n = u.size();
-	for (unsigned int i = 0; i < n; i++){
-		u[i] = u[i] - v[i];
-	}
+// entrywise l op r; children are held by value, since views and nodes are small
+template <typename Op, typename L, typename R>
+class VecBinary : public VecExpr<VecBinary<Op, L, R> >
+{
+	L l;
+	R r;
+
+	public:
+
+		typedef typename L::value_type value_type;
+
+		VecBinary(const L& l, const R& r, const char* operation) : l(l), r(r) {
+			if (l.size() != r.size())
+				throw std::invalid_argument(std::string("It is impossible to ") + operation + " vectors of different sizes.");
+		}
+
+		size_t size() const { return l.size(); }
+		value_type operator[](size_t i) const { return (value_type) Op::apply(l[i], r[i]); }
+
+		template <typename T, typename A>
+		operator std::vector<T, A>() const {
+			std::vector<T, A> res(size());
+			assign_entries(res.data(), *this, size());
+			return res;
+		}
+};
+
+
+// maps the operands accepted by the operators (vectors and expressions) to expression nodes
+template <typename X, typename = void>
+struct expr_of {};
+
+template <typename T, typename A>
+struct expr_of<std::vector<T, A>, void>
+{
+	typedef VecView<T> type;
+	static type make(const std::vector<T, A>& v) { return type(v.data(), v.size()); }
+};
+
+template <typename E>
+struct expr_of<E, typename std::enable_if<std::is_base_of<VecExpr<E>, E>::value>::type>
+{
+	typedef E type;
+	static const E& make(const E& e) { return e; }
+};
+
+template <typename X>
+using expr_t = typename expr_of<X>::type;
+
+
+/**
+ * In-place kernels on spans, e.g., on a range of time slots of a larger buffer.
+ * v can be a vector or an expression; all of them check the sizes.
+ */
+
+// out = e
+template <typename T, typename E>
+void evaluate(span<T> out, const E& e){
+	expr_t<E> x = expr_of<E>::make(e);
+	if (out.size() != x.size())
+		throw std::invalid_argument("It is impossible to assign vectors of different sizes.");
+	assign_entries(out.data(), x, out.size());
+}
+
+template <typename T, typename E>
+void add_to(span<T> u, const E& v){
+	evaluate(u, VecBinary<AddOp, VecView<T>, expr_t<E> >(VecView<T>(u.data(), u.size()), expr_of<E>::make(v), "add"));
+}
+
+template <typename T, typename E>
+void subtract_from(span<T> u, const E& v){
+	evaluate(u, VecBinary<SubOp, VecView<T>, expr_t<E> >(VecView<T>(u.data(), u.size()), expr_of<E>::make(v), "subtract"));
 }
 
 // entrywise multiplication
-template <typename T1, typename T2>
-void operator*=(vector<T1>& u, const vector<T2>& v){
-	unsigned int n = u.size();
-	for (unsigned int i = 0; i < n; i++){
-		u[i] *= v[i];
-	}
+template <typename T, typename E>
+void multiply_by(span<T> u, const E& v){
+	evaluate(u, VecBinary<MulOp, VecView<T>, expr_t<E> >(VecView<T>(u.data(), u.size()), expr_of<E>::make(v), "multiply"));
 }
 
 // entrywise division
-template <typename T1, typename T2>
-void operator/=(vector<T1>& u, const vector<T2>& v){
-	unsigned int n = u.size();
-	for (unsigned int i = 0; i < n; i++){
-		u[i] /= v[i];
-	}
+template <typename T, typename E>
+void divide_by(span<T> u, const E& v){
+	evaluate(u, VecBinary<DivOp, VecView<T>, expr_t<E> >(VecView<T>(u.data(), u.size()), expr_of<E>::make(v), "divide"));
+}
+
+} // namespace vectorutils
+
+
+// E must be a vector or an expression (expr_t<E> exists), otherwise the operators drop out of overload resolution
+template <typename T1, typename E, typename = vectorutils::expr_t<E> >
+void operator+=(vector<T1>& u, const E& v){
+	vectorutils::add_to(vectorutils::span<T1>(u), v);
+}
+
+template <typename T1, typename E, typename = vectorutils::expr_t<E> >
+void operator-=(vector<T1>& u, const E& v){
+	vectorutils::subtract_from(vectorutils::span<T1>(u), v);
+}
+
+// entrywise multiplication
+template <typename T1, typename E, typename = vectorutils::expr_t<E> >
+void operator*=(vector<T1>& u, const E& v){
+	vectorutils::multiply_by(vectorutils::span<T1>(u), v);
+}
+
+// entrywise division
+template <typename T1, typename E, typename = vectorutils::expr_t<E> >
+void operator/=(vector<T1>& u, const E& v){
+	vectorutils::divide_by(vectorutils::span<T1>(u), v);
 }
 
-template <typename T1, typename T2>
-vector<T1> operator+(const vector<T1>& u, const vector<T2>& v){
-	vector<T1> vec(u);
-	vec += v;
-	return vec;
+template <typename U, typename V>
+vectorutils::VecBinary<vectorutils::AddOp, vectorutils::expr_t<U>, vectorutils::expr_t<V> > operator+(const U& u, const V& v){
+	return {vectorutils::expr_of<U>::make(u), vectorutils::expr_of<V>::make(v), "add"};
 }
 
-template <typename T1, typename T2>
-vector<T1> operator-(const vector<T1>& u, const vector<T2>& v){
-	vector<T1> vec(u);
-	vec -= v;
-	return vec;
+template <typename U, typename V>
+vectorutils::VecBinary<vectorutils::SubOp, vectorutils::expr_t<U>, vectorutils::expr_t<V> > operator-(const U& u, const V& v){
+	return {vectorutils::expr_of<U>::make(u), vectorutils::expr_of<V>::make(v), "subtract"};
 }
 
 // entrywise multiplication
-template <typename T1, typename T2>
-vector<T1> operator*(const vector<T1>& u, const vector<T2>& v){
-	vector<T1> vec(u);
-	vec *= v;
-	return vec;
+template <typename U, typename V>
+vectorutils::VecBinary<vectorutils::MulOp, vectorutils::expr_t<U>, vectorutils::expr_t<V> > operator*(const U& u, const V& v){
+	return {vectorutils::expr_of<U>::make(u), vectorutils::expr_of<V>::make(v), "multiply"};
 }
 
 // entrywise division
-template <typename T1, typename T2>
-vector<T1> operator/(const vector<T1>& u, const vector<T2>& v){
-	vector<T1> vec(u);
-	vec /= v;
-	return vec;
+template <typename U, typename V>
+vectorutils::VecBinary<vectorutils::DivOp, vectorutils::expr_t<U>, vectorutils::expr_t<V> > operator/(const U& u, const V& v){
+	return {vectorutils::expr_of<U>::make(u), vectorutils::expr_of<V>::make(v), "divide"};
 }
 
 // add all the elements
@@ -0,0 +1,125 @@
+/**
+ *  Microbenchmark of the entrywise vector operators, on the plaintext part of
+ *  server_billing: ((retailPrice - tradingPrice) / totalP2PConsumers) * totalDeviation.
+ *
+ *  Compares the former operators (one new vector and one pass per operator),
+ *  the expression templates of vectorutils.hpp (one allocation and one pass)
+ *  and the in-place kernel (no allocation), for horizons up to a year of
+ *  15-minute time slots.
+ */
+
+#include "vectorutils.hpp"
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cassert>
+#include <cstdlib>
+
+using namespace std;
+
+
+// the operators of vectorutils.hpp before the expression templates
+namespace legacy {
+
+template <typename T1, typename T2>
+vector<T1> sub(const vector<T1>& u, const vector<T2>& v){
+	vector<T1> vec(u);
+	for (unsigned int i = 0; i < vec.size(); i++)
+		vec[i] = vec[i] - v[i];
+	return vec;
+}
+
+template <typename T1, typename T2>
+vector<T1> mul(const vector<T1>& u, const vector<T2>& v){
+	vector<T1> vec(u);
+	for (unsigned int i = 0; i < vec.size(); i++)
+		vec[i] *= v[i];
+	return vec;
+}
+
+template <typename T1, typename T2>
+vector<T1> div(const vector<T1>& u, const vector<T2>& v){
+	vector<T1> vec(u);
+	for (unsigned int i = 0; i < vec.size(); i++)
+		vec[i] /= v[i];
+	return vec;
+}
+
+}
+
+
+vector<double> random_vector(int n, double min_value, double max_value)
+{
+    vector<double> v(n);
+    for (int i = 0; i < n; i++)
+        v[i] = min_value + (max_value - min_value) * rand() / RAND_MAX;
+    return v;
+}
+
+
+void vectorutils_experiment()
+{
+    for (int nr_slots : {24, 96, 8760, 35040})
+    {
+        vector<double> retailPrice = random_vector(nr_slots, 0.2, 0.4);
+        vector<double> tradingPrice = random_vector(nr_slots, 0.1, 0.2);
+        vector<double> totalP2PConsumers = random_vector(nr_slots, 10, 150);
+        vector<double> totalDeviation = random_vector(nr_slots, -50, 50);
+
+        // about 10^8 entries per variant
+        const int nr_repetitions = max(10, 100000000 / nr_slots);
+        double checksum = 0;
+
+        auto legacy_begin = std::chrono::high_resolution_clock::now();
+        for (int r = 0; r < nr_repetitions; r++)
+        {
+            vector<double> billSupplement = legacy::mul(legacy::div(legacy::sub(retailPrice, tradingPrice), totalP2PConsumers), totalDeviation);
+            checksum += billSupplement[r % nr_slots];
+        }
+        auto legacy_end = std::chrono::high_resolution_clock::now();
+
+        auto fused_begin = std::chrono::high_resolution_clock::now();
+        for (int r = 0; r < nr_repetitions; r++)
+        {
+            vector<double> billSupplement = ((retailPrice - tradingPrice) / totalP2PConsumers) * totalDeviation;
+            checksum -= billSupplement[r % nr_slots];
+        }
+        auto fused_end = std::chrono::high_resolution_clock::now();
+
+        vector<double> billSupplement(nr_slots);
+        auto inplace_begin = std::chrono::high_resolution_clock::now();
+        for (int r = 0; r < nr_repetitions; r++)
+        {
+            vectorutils::evaluate(vectorutils::span<double>(billSupplement),
+                                  ((retailPrice - tradingPrice) / totalP2PConsumers) * totalDeviation);
+            checksum += billSupplement[r % nr_slots];
+        }
+        auto inplace_end = std::chrono::high_resolution_clock::now();
+
+        // all the variants compute the same operations in the same order
+        assert(billSupplement == legacy::mul(legacy::div(legacy::sub(retailPrice, tradingPrice), totalP2PConsumers), totalDeviation));
+
+        double legacy_ns = std::chrono::duration<double, std::nano>(legacy_end - legacy_begin).count() / nr_repetitions;
+        double fused_ns = std::chrono::duration<double, std::nano>(fused_end - fused_begin).count() / nr_repetitions;
+        double inplace_ns = std::chrono::duration<double, std::nano>(inplace_end - inplace_begin).count() / nr_repetitions;
+
+        // Display results
+        std::cout << "nr_time_slots: " << nr_slots
+                  << " -> legacy: " << legacy_ns << " ns"
+                  << ", fused: " << fused_ns << " ns"
+                  << ", in place: " << inplace_ns << " ns"
+                  << " (checksum " << checksum << ")"
+                  << std::endl;
+    }
+}
+
+
+int main()
+{
+    srand(time(NULL)); // XXX not secure. Enough for timing experiments.
+
+    vectorutils_experiment();
+
+    return 0;
+}
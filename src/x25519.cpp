@@ -0,0 +1,278 @@
+#include "x25519.h"
+
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+
+typedef unsigned __int128 uint128_t;
+
+// element of GF(2^255 - 19): sum of limb[i] * 2^(51 i)
+typedef uint64_t fe[5];
+
+static const uint64_t MASK51 = (1ull << 51) - 1;
+
+
+static inline uint64_t load64_le(const uint8_t* s){
+    uint64_t x = 0;
+    for (int i = 7; i >= 0; i--)
+        x = (x << 8) | s[i];
+    return x;
+}
+
+static inline void store64_le(uint8_t* s, uint64_t x){
+    for (int i = 0; i < 8; i++)
+        s[i] = (uint8_t) (x >> (8*i));
+}
+
+static void fe_frombytes(fe h, const uint8_t s[32]){
+    // the most significant bit is ignored
+    h[0] = load64_le(s) & MASK51;
+    h[1] = (load64_le(s + 6) >> 3) & MASK51;
+    h[2] = (load64_le(s + 12) >> 6) & MASK51;
+    h[3] = (load64_le(s + 19) >> 1) & MASK51;
+    h[4] = (load64_le(s + 24) >> 12) & MASK51;
+}
+
+static inline void fe_carry(fe h){
+    h[1] += h[0] >> 51; h[0] &= MASK51;
+    h[2] += h[1] >> 51; h[1] &= MASK51;
+    h[3] += h[2] >> 51; h[2] &= MASK51;
+    h[4] += h[3] >> 51; h[3] &= MASK51;
+    h[0] += 19 * (h[4] >> 51); h[4] &= MASK51;
+}
+
+// writes the unique representative in {0, ..., p-1}
+static void fe_tobytes(uint8_t s[32], const fe f){
+    fe t;
+    memcpy(t, f, sizeof(fe));
+    fe_carry(t);
+    fe_carry(t);
+
+    // t < 2^255 now; add 19 and carry, so that t >= p becomes t + 19 >= 2^255
+    t[0] += 19;
+    fe_carry(t);
+    // add 2^255 - 19 and drop the 2^255: gives t - p if t >= p and t otherwise
+    t[0] += (1ull << 51) - 19;
+    t[1] += (1ull << 51) - 1;
+    t[2] += (1ull << 51) - 1;
+    t[3] += (1ull << 51) - 1;
+    t[4] += (1ull << 51) - 1;
+    t[1] += t[0] >> 51; t[0] &= MASK51;
+    t[2] += t[1] >> 51; t[1] &= MASK51;
+    t[3] += t[2] >> 51; t[2] &= MASK51;
+    t[4] += t[3] >> 51; t[3] &= MASK51;
+    t[4] &= MASK51;
+
+    store64_le(s, t[0] | (t[1] << 51));
+    store64_le(s + 8, (t[1] >> 13) | (t[2] << 38));
+    store64_le(s + 16, (t[2] >> 26) | (t[3] << 25));
+    store64_le(s + 24, (t[3] >> 39) | (t[4] << 12));
+}
+
+static inline void fe_add(fe h, const fe f, const fe g){
+    for (int i = 0; i < 5; i++)
+        h[i] = f[i] + g[i];
+}
+
+// h = f - g + 4p, which stays positive for carried inputs
+static inline void fe_sub(fe h, const fe f, const fe g){
+    h[0] = f[0] + 0x1FFFFFFFFFFFB4ull - g[0];
+    for (int i = 1; i < 5; i++)
+        h[i] = f[i] + 0x1FFFFFFFFFFFFCull - g[i];
+    fe_carry(h);
+}
+
+static void fe_mul(fe h, const fe f, const fe g){
+    uint64_t g1_19 = 19 * g[1], g2_19 = 19 * g[2], g3_19 = 19 * g[3], g4_19 = 19 * g[4];
+    uint128_t r0 = (uint128_t) f[0] * g[0] + (uint128_t) f[1] * g4_19 + (uint128_t) f[2] * g3_19 + (uint128_t) f[3] * g2_19 + (uint128_t) f[4] * g1_19;
+    uint128_t r1 = (uint128_t) f[0] * g[1] + (uint128_t) f[1] * g[0] + (uint128_t) f[2] * g4_19 + (uint128_t) f[3] * g3_19 + (uint128_t) f[4] * g2_19;
+    uint128_t r2 = (uint128_t) f[0] * g[2] + (uint128_t) f[1] * g[1] + (uint128_t) f[2] * g[0] + (uint128_t) f[3] * g4_19 + (uint128_t) f[4] * g3_19;
+    uint128_t r3 = (uint128_t) f[0] * g[3] + (uint128_t) f[1] * g[2] + (uint128_t) f[2] * g[1] + (uint128_t) f[3] * g[0] + (uint128_t) f[4] * g4_19;
+    uint128_t r4 = (uint128_t) f[0] * g[4] + (uint128_t) f[1] * g[3] + (uint128_t) f[2] * g[2] + (uint128_t) f[3] * g[1] + (uint128_t) f[4] * g[0];
+
+    r1 += (uint64_t) (r0 >> 51);
+    r2 += (uint64_t) (r1 >> 51);
+    r3 += (uint64_t) (r2 >> 51);
+    r4 += (uint64_t) (r3 >> 51);
+    h[0] = ((uint64_t) r0 & MASK51) + 19 * (uint64_t) (r4 >> 51);
+    h[1] = (uint64_t) r1 & MASK51;
+    h[2] = (uint64_t) r2 & MASK51;
+    h[3] = (uint64_t) r3 & MASK51;
+    h[4] = (uint64_t) r4 & MASK51;
+    h[1] += h[0] >> 51; h[0] &= MASK51;
+}
+
+static inline void fe_sq(fe h, const fe f){
+    fe_mul(h, f, f);
+}
+
+static void fe_mul_small(fe h, const fe f, uint64_t c){
+    uint128_t carry = 0;
+    for (int i = 0; i < 5; i++){
+        carry += (uint128_t) f[i] * c;
+        h[i] = (uint64_t) carry & MASK51;
+        carry >>= 51;
+    }
+    h[0] += 19 * (uint64_t) carry;
+    h[1] += h[0] >> 51; h[0] &= MASK51;
+}
+
+// h = f^(2^n)
+static void fe_sq_n(fe h, const fe f, int n){
+    fe_sq(h, f);
+    for (int i = 1; i < n; i++)
+        fe_sq(h, h);
+}
+
+// h = z^(p-2) = 1/z, with the addition chain of the reference implementation
+static void fe_invert(fe h, const fe z){
+    fe z2, z9, z11, z2_5_0, z2_10_0, z2_20_0, z2_50_0, z2_100_0, t;
+    fe_sq(z2, z);                       // 2
+    fe_sq_n(t, z2, 2);                  // 8
+    fe_mul(z9, t, z);                   // 9
+    fe_mul(z11, z9, z2);                // 11
+    fe_sq(t, z11);                      // 22
+    fe_mul(z2_5_0, t, z9);              // 2^5 - 1
+    fe_sq_n(t, z2_5_0, 5);
+    fe_mul(z2_10_0, t, z2_5_0);         // 2^10 - 1
+    fe_sq_n(t, z2_10_0, 10);
+    fe_mul(z2_20_0, t, z2_10_0);        // 2^20 - 1
+    fe_sq_n(t, z2_20_0, 20);
+    fe_mul(t, t, z2_20_0);              // 2^40 - 1
+    fe_sq_n(t, t, 10);
+    fe_mul(z2_50_0, t, z2_10_0);        // 2^50 - 1
+    fe_sq_n(t, z2_50_0, 50);
+    fe_mul(z2_100_0, t, z2_50_0);       // 2^100 - 1
+    fe_sq_n(t, z2_100_0, 100);
+    fe_mul(t, t, z2_100_0);             // 2^200 - 1
+    fe_sq_n(t, t, 50);
+    fe_mul(t, t, z2_50_0);              // 2^250 - 1
+    fe_sq_n(t, t, 5);
+    fe_mul(h, t, z11);                  // 2^255 - 21 = p - 2
+}
+
+// swaps f and g if swap == 1, in constant time
+static inline void fe_cswap(fe f, fe g, uint64_t swap){
+    uint64_t mask = 0 - swap;
+    for (int i = 0; i < 5; i++){
+        uint64_t x = mask & (f[i] ^ g[i]);
+        f[i] ^= x;
+        g[i] ^= x;
+    }
+}
+
+static bool fe_is_zero(const fe f){
+    uint8_t s[32];
+    fe_tobytes(s, f);
+    uint8_t acc = 0;
+    for (int i = 0; i < 32; i++)
+        acc |= s[i];
+    return 0 == acc;
+}
+
+
+/**
+ *  Montgomery ladder of RFC 7748, Section 5: (x2 : z2) = k * u in projective
+ *  coordinates. The scalar is clamped here.
+ */
+static void ladder(fe x2, fe z2, const uint8_t private_key[32], const uint8_t u[32]){
+    uint8_t k[32];
+    memcpy(k, private_key, 32);
+    x25519_clamp(k);
+
+    fe x1, x3, z3;
+    fe_frombytes(x1, u);
+    memset(x2, 0, sizeof(fe)); x2[0] = 1;
+    memset(z2, 0, sizeof(fe));
+    memcpy(x3, x1, sizeof(fe));
+    memset(z3, 0, sizeof(fe)); z3[0] = 1;
+
+    uint64_t swap = 0;
+    fe a, aa, b, bb, e, c, d, da, cb, t;
+    for (int pos = 254; pos >= 0; pos--){
+        uint64_t bit = (k[pos / 8] >> (pos & 7)) & 1;
+        swap ^= bit;
+        fe_cswap(x2, x3, swap);
+        fe_cswap(z2, z3, swap);
+        swap = bit;
+
+        fe_add(a, x2, z2);
+        fe_sq(aa, a);
+        fe_sub(b, x2, z2);
+        fe_sq(bb, b);
+        fe_sub(e, aa, bb);
+        fe_add(c, x3, z3);
+        fe_sub(d, x3, z3);
+        fe_mul(da, d, a);
+        fe_mul(cb, c, b);
+
+        fe_add(t, da, cb);
+        fe_sq(x3, t);
+        fe_sub(t, da, cb);
+        fe_sq(t, t);
+        fe_mul(z3, x1, t);
+        fe_mul(x2, aa, bb);
+        fe_mul_small(t, e, 121665);
+        fe_add(t, aa, t);
+        fe_mul(z2, e, t);
+    }
+    fe_cswap(x2, x3, swap);
+    fe_cswap(z2, z3, swap);
+}
+
+
+void x25519_clamp(uint8_t private_key[X25519_BYTES]){
+    private_key[0] &= 248;
+    private_key[31] &= 127;
+    private_key[31] |= 64;
+}
+
+void x25519(uint8_t shared[X25519_BYTES], const uint8_t private_key[X25519_BYTES], const uint8_t peer_public_key[X25519_BYTES]){
+    fe x2, z2, z_inv;
+    ladder(x2, z2, private_key, peer_public_key);
+    fe_invert(z_inv, z2);
+    fe_mul(x2, x2, z_inv);
+    fe_tobytes(shared, x2);
+}
+
+void x25519_public_key(uint8_t public_key[X25519_BYTES], const uint8_t private_key[X25519_BYTES]){
+    uint8_t base[32] = {9};
+    x25519(public_key, private_key, base);
+}
+
+void x25519_batch(uint8_t* shared, const uint8_t private_key[X25519_BYTES], const uint8_t* peer_public_keys, int n_peers){
+    if (n_peers <= 0)
+        return;
+    // the field elements of peer i are at 5*i, ..., 5*i + 4
+    vector<uint64_t> x(5 * n_peers), z(5 * n_peers), prefix(5 * n_peers);
+    for (int i = 0; i < n_peers; i++){
+        uint64_t* xi = x.data() + 5*i;
+        uint64_t* zi = z.data() + 5*i;
+        ladder(xi, zi, private_key, peer_public_keys + (size_t) i * X25519_BYTES);
+        // low-order public keys give z = 0, i.e., the all-zero output; keep the product invertible
+        if (fe_is_zero(zi)){
+            memset(xi, 0, sizeof(fe));
+            memset(zi, 0, sizeof(fe)); zi[0] = 1;
+        }
+    }
+
+    // prefix[i] = z[0] * ... * z[i]; one inversion of prefix[n-1] gives all the 1/z[i]
+    memcpy(prefix.data(), z.data(), sizeof(fe));
+    for (int i = 1; i < n_peers; i++)
+        fe_mul(prefix.data() + 5*i, prefix.data() + 5*(i-1), z.data() + 5*i);
+    fe inv;
+    fe_invert(inv, prefix.data() + 5*(n_peers - 1));
+    for (int i = n_peers - 1; i >= 0; i--){
+        fe z_inv;
+        if (i > 0){
+            fe_mul(z_inv, inv, prefix.data() + 5*(i-1));
+            fe_mul(inv, inv, z.data() + 5*i);
+        } else {
+            memcpy(z_inv, inv, sizeof(fe));
+        }
+        fe_mul(x.data() + 5*i, x.data() + 5*i, z_inv);
+        fe_tobytes(shared + (size_t) i * X25519_BYTES, x.data() + 5*i);
+    }
+}
@@ -0,0 +1,35 @@
+/**
+ *  X25519 key agreement (RFC 7748), used by the users to agree on the seed of
+ *  every pairwise CSPRNG instead of receiving it from a central party.
+ *
+ *  Field elements of GF(2^255 - 19) are kept in 5 limbs of 51 bits and
+ *  multiplied with 128-bit products. The scalar multiplication is the constant-time
+ *  Montgomery ladder. A user agreeing with many peers can use x25519_batch, which
+ *  runs one ladder per peer but shares a single field inversion among all of them.
+ */
+
+#ifndef __X25519
+#define __X25519
+
+#include <cstdint>
+
+
+static const int X25519_BYTES = 32;
+
+// Clamps a random 32-byte string into an X25519 private key (RFC 7748, Section 5)
+void x25519_clamp(uint8_t private_key[X25519_BYTES]);
+
+// public_key = private_key * 9, the base point
+void x25519_public_key(uint8_t public_key[X25519_BYTES], const uint8_t private_key[X25519_BYTES]);
+
+// shared = private_key * peer_public_key (the u-coordinate)
+void x25519(uint8_t shared[X25519_BYTES], const uint8_t private_key[X25519_BYTES], const uint8_t peer_public_key[X25519_BYTES]);
+
+/**
+ *  shared[i*32, ..., (i+1)*32 - 1] = private_key * peer_public_keys[i*32, ..., (i+1)*32 - 1]
+ *  for i < n_peers. Same output as n_peers calls to x25519, with one field
+ *  inversion (Montgomery's trick) instead of n_peers.
+ */
+void x25519_batch(uint8_t* shared, const uint8_t private_key[X25519_BYTES], const uint8_t* peer_public_keys, int n_peers);
+
+#endif